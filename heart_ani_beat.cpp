@@ -10,6 +10,7 @@
 #include "heart_ani_beat.h"
 #include "heart_isr.h"
 #include "heart_delay.h"
+#include "heart_audio.h"
 
 /**
  * Let the heart 'beat'
@@ -40,20 +41,23 @@ void animate_beat(uint8_t num_beats = 2, uint16_t beat_interval_ms = 400, uint16
 
   // Setup phase: mark all LEDs active and fade to the lower bound
   for(int8_t l=0; l < NUM_LEDS; l++) {
-    fader[l].active = 0;
-    fader[l].lower  = fade_lower;
-    fader[l].upper  = fade_upper;
-    fader[l].delta  = fade_delta;
-    fader[l].reload = NONE;
+    FADER_STOP(l);
+    fader_lower[l]  = fade_lower;
+    fader_upper[l]  = fade_upper;
+    fader_delta[l]  = fade_delta;
+    fader_reload[l] = NONE;
     // Configure the faders to fade to the target intensity regardless of current state
-    //setup_fade_to_lower(&fader[l], &GET_LED_BRIGHTNESS(l));
+    //setup_fade_to_lower(l);
   }
 
   while(1) {
   //for(uint8_t ii = 0; ii < 5; ii++) {
     if(state == BEAT_FADEIN) {
+      // With music playing, the loudness sets how bright the beat gets
+      const uint8_t upper = audio_active() ? fade_lower + (uint16_t)(fade_upper - fade_lower) * audio_intensity() / 255 : fade_upper;
       for(int i=0; i<NUM_LEDS; i++) {
-        fader[i].delta = fadein_delta;
+        fader_upper[i] = upper;
+        fader_delta[i] = fadein_delta;
       }
       delay_ms = delay_fadein_ms;
       
@@ -61,12 +65,13 @@ void animate_beat(uint8_t num_beats = 2, uint16_t beat_interval_ms = 400, uint16
       state = BEAT_FADEOUT;
     } else if(state == BEAT_FADEOUT) {
       for(int i=0; i<NUM_LEDS; i++) {
-        fader[i].delta = -fadeout_delta;
+        fader_delta[i] = -fadeout_delta;
       }
-      delay_ms = beat_interval_ms - delay_fadein_ms;
+      // With music playing, wait for the next beat right away
+      delay_ms = audio_active() ? 0 : beat_interval_ms - delay_fadein_ms;
       
-      // Next state
-      if(++beat_cnt < num_beats)
+      // Next state; with music playing every beat is started by the music
+      if(++beat_cnt < num_beats && !audio_active())
         state = BEAT_FADEIN;
       else
         state = BEAT_WAIT;
@@ -75,15 +80,24 @@ void animate_beat(uint8_t num_beats = 2, uint16_t beat_interval_ms = 400, uint16
       delay_ms = beat_gap_ms;
       beat_cnt = 0;
       state = BEAT_FADEIN;
+
+      // With music playing, wait for a beat in the music instead; the fade out continues meanwhile
+      if(audio_active()) {
+        while(!audio_beat() && audio_active()) {
+          if(heart_delay(AUDIO_BLOCK_MS))
+            return; // Abort animation when requested
+        }
+        // The beat starts now, time the next steps from here
+        heart_delay_resync();
+        continue;
+      }
     }
 
     barrier();
     // Activate all animations
-    for(int i=0; i<NUM_LEDS; i++) {
-      fader[i].active = 1;
-    }
+    FADER_START_MASK(FADER_ALL);
 
-    if(heart_delay(delay_ms))
+    if(heart_delay_next(delay_ms))
       return; // Abort animation when requested
   }
 
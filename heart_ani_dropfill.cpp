@@ -53,13 +53,13 @@ void animate_dropfill(const int8_t setup = 1) {
   // Setup phase: mark all LEDs active and fade to the lower bound
   if(setup) {
     for(int8_t l=0; l < NUM_LEDS; l++) {
-      fader[l].active = 0;
-      fader[l].lower  = fade_lower;
-      fader[l].upper  = fade_upper;
-      fader[l].delta  = fade_speed_major << 8;
-      fader[l].reload = NONE;
+      FADER_STOP(l);
+      fader_lower[l]  = fade_lower;
+      fader_upper[l]  = fade_upper;
+      fader_delta[l]  = fade_speed_major << 8;
+      fader_reload[l] = NONE;
       // Configure the faders to fade to the target intensity regardless of current state
-      setup_fade_to_lower(&fader[l], &GET_LED_BRIGHTNESS(l));
+      setup_fade_to_lower(l);
     }
   }
 
@@ -106,17 +106,13 @@ void animate_dropfill(const int8_t setup = 1) {
       case DROP:
         // At the start of the drop, disable the 'top fill' LEDs
         if(cnt == 0) {
-          fader[LED_LAYER0].active = 0;
-          fader[LED_LAYER1[0]].active = 0;
-          fader[LED_LAYER1[1]].active = 0;
+          FADER_STOP_MASK(FADER_BIT(LED_LAYER0) | FADER_BIT(LED_LAYER1[0]) | FADER_BIT(LED_LAYER1[1]));
           barrier();
-          fader[LED_LAYER0].delta    = -fade_speed_major << 8;
-          fader[LED_LAYER1[0]].delta = -fade_speed_major << 8;
-          fader[LED_LAYER1[1]].delta = -fade_speed_major << 8;
+          fader_delta[LED_LAYER0]    = -fade_speed_major << 8;
+          fader_delta[LED_LAYER1[0]] = -fade_speed_major << 8;
+          fader_delta[LED_LAYER1[1]] = -fade_speed_major << 8;
           barrier();
-          fader[LED_LAYER0].active    = 1;
-          fader[LED_LAYER1[0]].active = 1;
-          fader[LED_LAYER1[1]].active = 1;
+          FADER_START_MASK(FADER_BIT(LED_LAYER0) | FADER_BIT(LED_LAYER1[0]) | FADER_BIT(LED_LAYER1[1]));
         }
         
         cnt++;
@@ -134,8 +130,8 @@ void animate_dropfill(const int8_t setup = 1) {
               // See if the bucket is full now, if so, change the lower boundary so it stays 'on'
               if(fill[3] == fill_max) {
                 // Note: these faders are enabled when the drop reaches the next layer
-                fader[3].lower = fade_filled_low;
-                fader[7].lower = fade_filled_low;
+                fader_lower[3] = fade_filled_low;
+                fader_lower[7] = fade_filled_low;
               } 
             }
           }
@@ -145,14 +141,12 @@ void animate_dropfill(const int8_t setup = 1) {
           SET_LED_BRIGHTNESS_MAJOR(8, fade_upper);
           if(cnt == dur_drop_step * 2) {
             // Turn off previous layer on the switch point
-            fader[3].active = 0;
-            fader[7].active = 0;
+            FADER_STOP_MASK(FADER_BIT(3) | FADER_BIT(7));
             barrier();
-            fader[3].delta = -fade_speed_major << 8;
-            fader[7].delta = -fade_speed_major << 8;
+            fader_delta[3] = -fade_speed_major << 8;
+            fader_delta[7] = -fade_speed_major << 8;
             barrier();
-            fader[3].active = 1;
-            fader[7].active = 1;
+            FADER_START_MASK(FADER_BIT(3) | FADER_BIT(7));
             
             // Fill counter if bin 2 is not full yet
             if(fill[1] >= fill_max && fill[2] < fill_max) {
@@ -161,8 +155,8 @@ void animate_dropfill(const int8_t setup = 1) {
               // See if the bucket is full now, if so, change the lower boundary so it stays 'on'
               if(fill[2] == fill_max) {
                 // Note: these faders are enabled when the drop reaches the next layer
-                fader[2].lower = fade_filled_low;
-                fader[8].lower = fade_filled_low;
+                fader_lower[2] = fade_filled_low;
+                fader_lower[8] = fade_filled_low;
               } 
             }
           }
@@ -172,14 +166,12 @@ void animate_dropfill(const int8_t setup = 1) {
           SET_LED_BRIGHTNESS_MAJOR(9, fade_upper);
           if(cnt == dur_drop_step * 3) {
             // Turn off previous layer on the switch point
-            fader[2].active = 0;
-            fader[8].active = 0;
+            FADER_STOP_MASK(FADER_BIT(2) | FADER_BIT(8));
             barrier();
-            fader[2].delta = -fade_speed_major << 8;
-            fader[8].delta = -fade_speed_major << 8;
+            fader_delta[2] = -fade_speed_major << 8;
+            fader_delta[8] = -fade_speed_major << 8;
             barrier();
-            fader[2].active = 1;
-            fader[8].active = 1;
+            FADER_START_MASK(FADER_BIT(2) | FADER_BIT(8));
             
             // Fill counter if bin 1 is not full yet
             if(fill[0] >= fill_max && fill[1] < fill_max) {
@@ -188,8 +180,8 @@ void animate_dropfill(const int8_t setup = 1) {
               // See if the bucket is full now, if so, change the lower boundary so it stays 'on'
               if(fill[1] == fill_max) {
                 // Note: these faders are enabled when the drop reaches the next layer
-                fader[1].lower = fade_filled_low;
-                fader[9].lower = fade_filled_low;
+                fader_lower[1] = fade_filled_low;
+                fader_lower[9] = fade_filled_low;
               } 
             }
           }
@@ -198,14 +190,12 @@ void animate_dropfill(const int8_t setup = 1) {
           SET_LED_BRIGHTNESS_MAJOR(0, fade_upper);
           if(cnt == dur_drop_step * 4) {
             // Turn off previous layer on the switch point
-            fader[1].active = 0;
-            fader[9].active = 0;
+            FADER_STOP_MASK(FADER_BIT(1) | FADER_BIT(9));
             barrier();
-            fader[1].delta = -fade_speed_major << 8;
-            fader[9].delta = -fade_speed_major << 8;
+            fader_delta[1] = -fade_speed_major << 8;
+            fader_delta[9] = -fade_speed_major << 8;
             barrier();
-            fader[1].active = 1;
-            fader[9].active = 1;
+            FADER_START_MASK(FADER_BIT(1) | FADER_BIT(9));
             
             // Fill counter if bin 0 is not full yet
             if(fill[0] < fill_max) {
@@ -214,7 +204,7 @@ void animate_dropfill(const int8_t setup = 1) {
               // See if the bucket is full now, if so, change the lower boundary so it stays 'on'
               if(fill[0] == fill_max) {
                 // Note: this fader is enabled when entering splash
-                fader[0].lower = fade_filled_low;
+                fader_lower[0] = fade_filled_low;
               } 
             }
           }
@@ -227,11 +217,11 @@ void animate_dropfill(const int8_t setup = 1) {
           state = SPLASH_END;
           
           // Turn on the fader for the last LED
-          fader[0].active = 0;
+          FADER_STOP(0);
           barrier();
-          fader[0].delta = -fade_speed_major << 8;
+          fader_delta[0] = -fade_speed_major << 8;
           barrier();
-          fader[0].active = 1;
+          FADER_START(0);
         }
         break;
       case SPLASH_END:
@@ -242,26 +232,26 @@ void animate_dropfill(const int8_t setup = 1) {
           if(cnt == dur_splash / 2) {
             // Splash ending complete, fade whole heart in
             for(int8_t l=0; l < NUM_LEDS; l++) {
-              fader[l].active = 0;
+              FADER_STOP(l);
               barrier();
-              fader[l].lower  = fade_lower;
-              fader[l].upper  = fade_upper;
-              fader[l].delta  = fade_speed_major << 8;
-              fader[l].reload = NONE;
+              fader_lower[l]  = fade_lower;
+              fader_upper[l]  = fade_upper;
+              fader_delta[l]  = fade_speed_major << 8;
+              fader_reload[l] = NONE;
               barrier();
-              fader[l].active = 1;
+              FADER_START(l);
             }
           } else if(cnt >= dur_splash) {
             // Fade out and go to IDLE
             for(int8_t l=0; l < NUM_LEDS; l++) {
-              fader[l].active = 0;
+              FADER_STOP(l);
               barrier();
-              fader[l].lower  = fade_lower;
-              fader[l].upper  = fade_upper;
-              fader[l].delta  = -fade_speed_major << 8;
-              fader[l].reload = NONE;
+              fader_lower[l]  = fade_lower;
+              fader_upper[l]  = fade_upper;
+              fader_delta[l]  = -fade_speed_major << 8;
+              fader_reload[l] = NONE;
               barrier();
-              fader[l].active = 1;
+              FADER_START(l);
             }
             
             // After fading out the heart, clear the bins
@@ -277,8 +267,8 @@ void animate_dropfill(const int8_t setup = 1) {
         break;
     }
     
-    // Delay between steps of the animation
-    if(heart_delay(ani_delay_ms))
+    // Wait for the next step of the animation
+    if(heart_delay_next(ani_delay_ms))
       return; // When 1, the delay is aborted and this animation will end
   }
 }
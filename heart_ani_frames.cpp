@@ -0,0 +1,57 @@
+/**
+ * heart_ani_frames.cpp - Heart PCB Project - Animation playing the recorded frame sequences
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.11
+ * @license GNUGPLv3
+ */
+
+#include "heart_ani_frames.h"
+#include "heart_frames.h"
+#include "heart_frames_data.h"
+#include "heart_isr.h"
+#include "heart_delay.h"
+
+static const uint8_t * const frames_table [FRAMES_NUM_SEQUENCES] PROGMEM = FRAMES_SEQUENCES;
+
+/**
+ * Number of recorded sequences in heart_frames_data.h
+ */
+uint8_t frames_sequences() {
+  return FRAMES_NUM_SEQUENCES;
+}
+
+/**
+ * Play a recorded sequence, over and over until the time is up
+ * @param seq     Sequence number, 0 to frames_sequences() - 1
+ * @param seconds Time to play, 0 to keep going until aborted
+ * @return 1 when the animation was aborted, 0 when it completed
+ */
+int8_t animate_frames(uint8_t seq, uint16_t seconds) {
+  // Enable the delay function if it was turned off by button press to abort the previous animation
+  enable_heart_delay();
+
+  if(seq >= FRAMES_NUM_SEQUENCES) { _err = ERR_GENERIC; return 1; }
+  const uint8_t *data = (const uint8_t *)pgm_read_word(&frames_table[seq]);
+
+  // The sequence sets the brightness directly, stop the faders; channels the sequence does not have stay off
+  FADER_STOP_MASK(FADER_ALL);
+  for(uint8_t l=0; l < NUM_LEDS; l++) SET_LED_BRIGHTNESS(l, 0, 0);
+
+  uint32_t left_ms = seconds * 1000UL;
+  while(seconds == 0 || left_ms > 0) {
+    // Start over at the key frame at the end of the sequence
+    if(!frames_start(data)) { _err = ERR_GENERIC; return 1; }
+    while(frames_next()) {
+      const uint8_t ms = frames_interval_ms();
+      if(heart_delay_next(ms))
+        return 1; // When the delay aborts, stop the animation
+      if(seconds != 0) {
+        if(left_ms <= ms) return 0;
+        left_ms -= ms;
+      }
+    }
+  }
+  return 0;
+}
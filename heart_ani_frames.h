@@ -0,0 +1,29 @@
+/**
+ * heart_ani_frames.h - Heart PCB Project - Animation playing the recorded frame sequences
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.11
+ * @license GNUGPLv3
+ */
+
+#ifndef _HEART_ANI_FRAMES_H_
+#define _HEART_ANI_FRAMES_H_
+
+#include "heart_settings.h"
+#include "Arduino.h"
+
+/**
+ * Number of recorded sequences in heart_frames_data.h
+ */
+uint8_t frames_sequences();
+
+/**
+ * Play a recorded sequence, over and over until the time is up
+ * @param seq     Sequence number, 0 to frames_sequences() - 1
+ * @param seconds Time to play, 0 to keep going until aborted
+ * @return 1 when the animation was aborted, 0 when it completed
+ */
+int8_t animate_frames(uint8_t seq, uint16_t seconds = 0);
+
+#endif
\ No newline at end of file
@@ -11,7 +11,7 @@
 #include "heart_isr.h"
 #include "heart_delay.h"
 
-static run_around_setting_struct_t run_around_default = {
+run_around_setting_struct_t run_around_default = {
   .fade_speed_major = 25,
   .fade_lower = 20,
   .fade_upper = 255,
@@ -63,12 +63,12 @@ int8_t animate_run_around(const int8_t setup = 1, const int8_t auto_loop = 1, co
   // Setup phase: mark all LEDs active and fade to the lower bound
   if(setup) {
     for(int8_t l=0; l < NUM_LEDS; l++) {
-      fader[l].active = 0;
-      fader[l].lower  = fade_lower;
-      fader[l].upper  = fade_upper;
-      fader[l].delta  = fade_speed_major << 8;
+      FADER_STOP(l);
+      fader_lower[l]  = fade_lower;
+      fader_upper[l]  = fade_upper;
+      fader_delta[l]  = fade_speed_major << 8;
       // Configure the faders to fade to the target intensity regardless of current state
-      setup_fade_to_lower(&fader[l], &GET_LED_BRIGHTNESS(l));
+      setup_fade_to_lower(l);
     }
 
     s->delay_current_ms = delay_base_ms;
@@ -85,27 +85,27 @@ int8_t animate_run_around(const int8_t setup = 1, const int8_t auto_loop = 1, co
         // Apply the current status before moving the runner
         if(erasers && odd) {
           // Eraser runner, fade the current LED out (if it wasn't off before)
-          fader[led].active = 0;
+          FADER_STOP(led);
           barrier(); // Barrier after disabling the fader; makes sure the fader is inactive while settings change
           SET_LED_BRIGHTNESS(led, fade_lower, 0);
         } else {
           // Normal runner, fade current LED in
-          fader[led].active = 0;
+          FADER_STOP(led);
           barrier(); // Barrier after disabling the fader; makes sure the fader is inactive while settings change
           if(fade_up_start == fade_upper) {
             // Hard-start; fade out from the start
-            fader[led].reload = NONE;
+            fader_reload[led] = NONE;
           } else {
             // Soft-start: fade in a bit before fading out again, for the twinkly feeling
-            fader[led].reload = UPPER_INVERT;
+            fader_reload[led] = UPPER_INVERT;
           }
           // Compute the 16-bit delta
-          fader[led].delta = fade_speed_major << 8;
+          fader_delta[led] = fade_speed_major << 8;
           // Set the LED brightness
           SET_LED_BRIGHTNESS(led, fade_up_start, 0);
           barrier(); // Barrier after configuring the fader; makes sure the fader settings are committed before animating it again
           // Mark the fader active again
-          fader[led].active = 1;
+          FADER_START(led);
         }
 
         // Move the current runner
@@ -120,9 +120,9 @@ int8_t animate_run_around(const int8_t setup = 1, const int8_t auto_loop = 1, co
         if(li[r] == 255) li[r] = NUM_LEDS - 1;
       }
 
-      // Animation step complete, do delay
+      // Animation step complete, wait for the next one; the time spent on the runners is part of the step
       //delay(s->delay_current_ms);
-      if(heart_delay(s->delay_current_ms))
+      if(heart_delay_next(s->delay_current_ms))
         return 1; // When the delay aborts, stop the animation
       
       // Update delay amount if requested
@@ -13,7 +13,7 @@
 #include "Arduino.h"
 
 typedef struct {
-  const uint8_t  fade_speed_major;    // Speed of the fade up and fade down
+        uint8_t  fade_speed_major;    // Speed of the fade up and fade down
   const uint8_t  fade_lower;          // Lower boundary for dimmed LEDs
   const uint8_t  fade_upper;          // Upper boundary for bright LEDs
   const uint8_t  fade_up_start;       // Runners set this goal for their LED, causing a soft-start, set to fade_upper to do a hard start
@@ -25,6 +25,9 @@ typedef struct {
                                       // track what the animation step delay was when the animation function returns
 } run_around_setting_struct_t;
 
+// Settings used when animate_run_around() is called without settings
+extern run_around_setting_struct_t run_around_default;
+
 /**
  * Running animation: one or more 'runners' run around the heart turning on LEDs as they go.
  * @param setup When non-zero, fade all LEDs to the lower brightness bound for this animation, useful for an animation transition
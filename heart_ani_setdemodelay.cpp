@@ -10,11 +10,12 @@
 #include "heart_ani_setdemodelay.h"
 #include "heart_isr.h"
 #include "heart_delay.h"
+#include "heart_event.h"
 
 void inline configure_LEDs(int8_t level, uint8_t off = 0) {
   // Setup phase: mark all LEDs active and fade to the lower bound
   for(int8_t l=0; l < NUM_LEDS; l++) {
-    fader[l].active = 0;
+    FADER_STOP(l);
     // Drive LED intensity directly to full off or on
     if(!off && l < level) {
       SET_LED_BRIGHTNESS(l, 255, 0);
@@ -31,9 +32,8 @@ void inline configure_LEDs(int8_t level, uint8_t off = 0) {
  */
 void animate_setdemodelay() {
   const uint8_t polling_interval_ms = 50; // Delay per loop iteration, checks if the button is still held down
-  const uint8_t cnt_max = 50;             // After this many iterations, step to the next setting
-  uint8_t cnt = 0;                        // Counter to create a delay before switching to the next multiplier
-  uint8_t num_demo_multi = demo_mode;     // Start from whatever the demo mode multiplier currently is
+  uint8_t start_demo_multi = demo_mode;   // Start from whatever the demo mode multiplier currently is
+  uint8_t num_demo_multi;
   const uint8_t blink_max = 5;            // Blink counter maximum, when this is reached, the LEDs turn on or off
   uint8_t blink_cnt = 0;
   uint8_t off = 0;
@@ -43,7 +43,8 @@ void animate_setdemodelay() {
   barrier();
   
   // Sanity
-  if(num_demo_multi > 5) num_demo_multi = 5;
+  if(start_demo_multi > 5) start_demo_multi = 5;
+  num_demo_multi = start_demo_multi;
   
   // Enable the delay function if it was turned off by button press to abort the previous animation
   enable_heart_delay();
@@ -53,13 +54,11 @@ void animate_setdemodelay() {
 
   while(btn0_hold) {
    
-    cnt++;
     blink_cnt++;
     
-    // See if we counted long enough to switch to the next level
-    if(cnt >= cnt_max) {
-      num_demo_multi = ( num_demo_multi + 1 ) % 6;
-      cnt = 0;
+    // Every hold level of the button (one per BUTTON_HOLD_STEP_MS) steps to the next setting
+    if(button_hold_level > 0) {
+      num_demo_multi = ( start_demo_multi + button_hold_level - 1 ) % 6;
     }
     
     if(blink_cnt == blink_max) {
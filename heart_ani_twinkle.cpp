@@ -28,12 +28,12 @@ void animate_twinkle(uint8_t setup = 1) {
   // Setup phase: mark all LEDs active and fade to the lower bound
   if(setup) {
     for(int8_t l=0; l < NUM_LEDS; l++) {
-      fader[l].active = 0;
-      fader[l].lower  = fade_lower;
-      fader[l].upper  = fade_upper;
-      fader[l].delta  = fade_delta;
+      FADER_STOP(l);
+      fader_lower[l]  = fade_lower;
+      fader_upper[l]  = fade_upper;
+      fader_delta[l]  = fade_delta;
       // Configure the faders to fade to the target intensity regardless of current state
-      setup_fade_to_lower(&fader[l], &GET_LED_BRIGHTNESS(l));
+      setup_fade_to_lower(l);
     }
   }
 
@@ -43,17 +43,17 @@ void animate_twinkle(uint8_t setup = 1) {
       // Only turn a LED on with a 10% chance
       turnOn = (turnOn == 0);
 
-      if(turnOn && fader[i].active == 0) {
+      if(turnOn && !FADER_ACTIVE(i)) {
         // idle LED, fade it in
-        fader[i].upper  = random(fade_twinkle_lower, fade_upper);
-        fader[i].delta  = fade_delta;
-        fader[i].reload = UPPER_INVERT;
+        fader_upper[i]  = random(fade_twinkle_lower, fade_upper);
+        fader_delta[i]  = fade_delta;
+        fader_reload[i] = UPPER_INVERT;
         barrier();
-        fader[i].active = 1;
+        FADER_START(i);
       }
     }
 
-    if(heart_delay(delay_ms))
+    if(heart_delay_next(delay_ms))
       return; // Abort animation when requested
   }
 
@@ -0,0 +1,49 @@
+/**
+ * heart_ani_wave.cpp - Heart PCB Project - Animations with waves running over the geometry of the heart
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.08
+ * @license GNUGPLv3
+ */
+
+#include "heart_ani_wave.h"
+#include "heart_wave.h"
+#include "heart_isr.h"
+#include "heart_delay.h"
+
+static const wave_t wave_effects [WAVE_NUM_EFFECTS] PROGMEM = {
+  // Vertical fill: half a period from bottom to top, so the heart fills up and drains again
+  { .step = WAVE_STEP(400), .kx = 0, .ky = -32, .kr = 0, .kring = 0, .lower = 0, .upper = 255 },
+  // Ripple: about three quarters of a period (127 * 96 / 64 = 190 of 256) from the centre to the outside, moving out
+  { .step = WAVE_STEP(700), .kx = 0, .ky = 0, .kr = -96, .kring = 0, .lower = 5, .upper = 255 },
+  // Rotating gradient: one period along the outline
+  { .step = WAVE_STEP(250), .kx = 0, .ky = 0, .kr = 0, .kring = 64, .lower = 5, .upper = 255 },
+};
+
+/**
+ * Show a wave effect for a number of frames of WAVE_FRAME_MS
+ * @param effect One of WAVE_EFFECT_*
+ * @param frames Number of frames to show, 0 to keep going until aborted
+ * @return 1 when the animation was aborted, 0 when it completed
+ */
+int8_t animate_wave(uint8_t effect, uint16_t frames) {
+  wave_t w;
+
+  // Enable the delay function if it was turned off by button press to abort the previous animation
+  enable_heart_delay();
+
+  if(effect >= WAVE_NUM_EFFECTS) { _err = ERR_GENERIC; return 1; }
+  memcpy_P(&w, &wave_effects[effect], sizeof(wave_t));
+
+  // The wave sets the brightness directly, stop the faders
+  FADER_STOP_MASK(FADER_ALL);
+  wave_start(&w);
+
+  for(uint16_t f=0; frames == 0 || f < frames; f++) {
+    wave_render();
+    if(heart_delay_next(WAVE_FRAME_MS))
+      return 1; // When the delay aborts, stop the animation
+  }
+  return 0;
+}
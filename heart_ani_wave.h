@@ -0,0 +1,30 @@
+/**
+ * heart_ani_wave.h - Heart PCB Project - Animations with waves running over the geometry of the heart
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.08
+ * @license GNUGPLv3
+ */
+
+#ifndef _HEART_ANI_WAVE_H_
+#define _HEART_ANI_WAVE_H_
+
+#include "heart_settings.h"
+#include "Arduino.h"
+
+// Wave effects: vertical fill, ripple from the centre, gradient rotating along the outline
+#define WAVE_EFFECT_FILL   0
+#define WAVE_EFFECT_RIPPLE 1
+#define WAVE_EFFECT_ROTATE 2
+#define WAVE_NUM_EFFECTS   3
+
+/**
+ * Show a wave effect for a number of frames of WAVE_FRAME_MS
+ * @param effect One of WAVE_EFFECT_*
+ * @param frames Number of frames to show, 0 to keep going until aborted
+ * @return 1 when the animation was aborted, 0 when it completed
+ */
+int8_t animate_wave(uint8_t effect, uint16_t frames = 0);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+ * heart_audio.cpp - Heart PCB Project - Microphone sampling and beat events for the animations
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.15
+ * @license GNUGPLv3
+ */
+
+#include "heart_audio.h"
+
+volatile uint8_t audio_overruns = 0;
+uint16_t audio_beats = 0;
+uint16_t audio_cycles_per_sample = 0;
+uint16_t audio_cycles_goertzel = 0;
+
+#ifdef SUPPORT_AUDIO
+#include "Arduino.h"
+#include "heart_audio_detect.h"
+#include "heart_clock.h"
+#include "heart_time.h"
+
+// Ring buffer between the ADC interrupt (writes the head) and the main loop (reads from the tail)
+volatile uint16_t _audio_buf [AUDIO_BUFFER_SAMPLES];
+volatile uint8_t  _audio_head = 0;
+uint8_t           _audio_tail = 0;
+
+// Sum of the readings for the current sample and the number of readings left for it; only used by the ADC interrupt
+uint16_t _audio_acc = 0;
+uint8_t  _audio_dec = AUDIO_DECIMATION;
+
+audio_detect_t audio_det;
+uint8_t  audio_beat_pending = 0; // Set by the detector, cleared when an animation takes the beat
+uint32_t audio_busy_us = 0;      // Time spent in the detector for the cycles per sample statistic
+uint16_t audio_samples = 0;
+
+/**
+ * One sample through the detector, to measure its cost
+ */
+static void audio_measure_sample() {
+  audio_detect_sample(&audio_det, 128 << AUDIO_SAMPLE_SHIFT);
+}
+
+/**
+ * Configure the ADC and start sampling the microphone; call this after the PWM timer is running
+ */
+void audio_init() {
+  // Cost of a sample which does not complete a block (the Goertzel step and the loudness), before the ADC interrupt
+  // runs; the detector starts over afterwards
+  audio_cycles_goertzel = time_cycles(audio_measure_sample);
+  audio_detect_init(&audio_det);
+
+  // AVcc reference, left adjusted so the 8 most significant bits are read from ADCH
+  ADMUX  = _BV(REFS0) | _BV(ADLAR) | (AUDIO_ADC_CHANNEL & 0x07);
+  // Free running mode
+  ADCSRB = 0;
+  // The digital input buffer only adds noise and current on an analog input
+  if(AUDIO_ADC_CHANNEL < 6) DIDR0 |= _BV(AUDIO_ADC_CHANNEL);
+  // Enable, start, auto trigger and interrupt with a prescaler of 128: 125 kHz ADC clock, 13 clocks per conversion
+  ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+/**
+ * ADC conversion complete: sum the readings into a sample and queue it for the detector. Interrupts are enabled right
+ * away so the PWM interrupt is not delayed; the next conversion only completes 104 us later so this can not nest.
+ */
+ISR(ADC_vect, ISR_NOBLOCK) {
+  _audio_acc += ADCH;
+  if(--_audio_dec) return;
+
+  const uint8_t head = _audio_head;
+  const uint8_t next = (head + 1) & (AUDIO_BUFFER_SAMPLES - 1);
+  if(next != _audio_tail) {
+    _audio_buf[head] = _audio_acc;
+    _audio_head = next;
+  } else if(audio_overruns < 0xFF) {
+    audio_overruns++;
+  }
+  _audio_acc = 0;
+  _audio_dec = AUDIO_DECIMATION;
+}
+
+/**
+ * Background task for the main loop: runs the detector on the samples received from the ADC interrupt.
+ */
+void audio_service() {
+  const uint32_t start = heart_micros();
+  uint8_t n = 0;
+
+  while(_audio_tail != _audio_head) {
+    if(audio_detect_sample(&audio_det, _audio_buf[_audio_tail]) && audio_det.beat) {
+      audio_beat_pending = 1;
+      audio_beats++;
+    }
+    _audio_tail = (_audio_tail + 1) & (AUDIO_BUFFER_SAMPLES - 1);
+    n++;
+  }
+  if(n == 0) return;
+
+  // Measure the cost of the detector; micros() has a resolution of 4 us (more at a lower clock) so average over 256 samples
+  audio_busy_us += heart_micros() - start;
+  audio_samples += n;
+  if(audio_samples >= 256) {
+    audio_cycles_per_sample = audio_busy_us * ((F_CPU / 1000000) >> clock_shift) / audio_samples;
+    audio_busy_us = 0;
+    audio_samples = 0;
+  }
+}
+
+/**
+ * Check for a beat in the music; every detected beat is reported once.
+ * @return 1 when a beat was detected since the last call
+ */
+uint8_t audio_beat() {
+  const uint8_t beat = audio_beat_pending;
+  audio_beat_pending = 0;
+  return beat;
+}
+
+/**
+ * Loudness of the music in the last block, relative to the recent peak
+ * @return 0 (silent) to 255 (as loud as it gets)
+ */
+uint8_t audio_intensity() {
+  return audio_det.intensity;
+}
+
+/**
+ * Check if music is playing; animations should use their own timing when it is not.
+ * @return 1 when the microphone picked up sound within the last second
+ */
+uint8_t audio_active() {
+  return audio_det.active != 0;
+}
+
+#else
+// *** No audio support ***
+
+/**
+ * Configure the ADC and start sampling the microphone; call this after the PWM timer is running
+ */
+void audio_init() {}
+
+/**
+ * Background task for the main loop: runs the detector on the samples received from the ADC interrupt.
+ */
+void audio_service() {}
+
+/**
+ * Check for a beat in the music: without audio support there is none
+ */
+uint8_t audio_beat() { return 0; }
+
+/**
+ * Loudness of the music: without audio support it is silent
+ */
+uint8_t audio_intensity() { return 0; }
+
+/**
+ * Check if music is playing: without audio support it never is
+ */
+uint8_t audio_active() { return 0; }
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * heart_audio.h - Heart PCB Project - Microphone sampling and beat events for the animations
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.15
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_AUDIO_H_
+#define _HEART_AUDIO_H_
+
+#include "heart_settings.h"
+
+/**
+ * The ADC converts the microphone input continuously (free running mode). The ADC interrupt only sums the readings and
+ * hands every AUDIO_DECIMATION-th sum to the main loop through a small ring buffer; it does not block interrupts, so the
+ * PWM interrupt keeps its timing. audio_service() runs the detector (see heart_audio_detect.h) on the buffered samples
+ * and turns the results into events for the animations.
+ */
+
+// Statistics: samples lost because the main loop did not empty the buffer in time (saturating), number of detected
+// beats and the time spent in the detector per sample in CPU cycles (interrupts included)
+extern volatile uint8_t audio_overruns;
+extern uint16_t audio_beats;
+extern uint16_t audio_cycles_per_sample;
+
+// CPU cycles of one sample through the Goertzel filter (AUDIO_GOERTZEL_COEFF) and the loudness sum, without
+// interrupts; measured with Timer1 by audio_init() and printed by the 'c' command as audio_cyc_goertzel.
+extern uint16_t audio_cycles_goertzel;
+
+/**
+ * Configure the ADC and start sampling the microphone; call this after the PWM timer is running
+ */
+void audio_init();
+
+/**
+ * Background task for the main loop: runs the detector on the samples received from the ADC interrupt.
+ */
+void audio_service();
+
+/**
+ * Check for a beat in the music; every detected beat is reported once.
+ * @return 1 when a beat was detected since the last call
+ */
+uint8_t audio_beat();
+
+/**
+ * Loudness of the music in the last block, relative to the recent peak
+ * @return 0 (silent) to 255 (as loud as it gets)
+ */
+uint8_t audio_intensity();
+
+/**
+ * Check if music is playing; animations should use their own timing when it is not.
+ * @return 1 when the microphone picked up sound within the last second
+ */
+uint8_t audio_active();
+
+#endif
\ No newline at end of file
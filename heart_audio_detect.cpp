@@ -0,0 +1,86 @@
+/**
+ * heart_audio_detect.cpp - Heart PCB Project - Fixed-point beat and loudness detection on audio samples
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.15
+ * @license GNUGPLv3
+ */
+
+#include "heart_audio_detect.h"
+
+#ifdef SUPPORT_AUDIO
+
+/**
+ * Reset the detector state
+ */
+void audio_detect_init(audio_detect_t *d) {
+  d->s1 = 0;
+  d->s2 = 0;
+  d->sum = 0;
+  d->sum_abs = 0;
+  d->n = 0;
+  d->mean = 128 << AUDIO_SAMPLE_SHIFT; // Microphone amplifiers are biased at half the supply
+  d->power_avg = 0;
+  d->level_peak = AUDIO_LEVEL_FLOOR;
+  d->holdoff = AUDIO_ACTIVE_BLOCKS; // Let the averages settle before reporting beats
+  d->active = 0;
+  d->power = 0;
+  d->level = 0;
+  d->intensity = 0;
+  d->beat = 0;
+}
+
+/**
+ * Feed one sample to the detector
+ * @param sample Sum of AUDIO_DECIMATION 8 bit ADC readings
+ * @return 1 when the sample completed a block: the results in the detector state are updated
+ */
+uint8_t audio_detect_sample(audio_detect_t *d, uint16_t sample) {
+  // Remove the bias and scale to 8 bits: |x| <= 255 so the Goertzel state stays well within 16 bits
+  const int16_t x = ((int16_t)sample - (int16_t)d->mean) >> AUDIO_SAMPLE_SHIFT;
+  const int16_t s0 = x + (int16_t)(((int32_t)AUDIO_GOERTZEL_COEFF * d->s1) >> 14) - d->s2;
+
+  d->s2 = d->s1;
+  d->s1 = s0;
+  d->sum += sample;
+  d->sum_abs += (x < 0) ? -x : x;
+  if(++d->n < AUDIO_BLOCK_SAMPLES) return 0;
+
+  // End of the block: power in the beat bin, |X[k]|^2 = s1^2 + s2^2 - coeff * s1 * s2
+  int32_t p = (int32_t)d->s1 * d->s1 + (int32_t)d->s2 * d->s2 -
+              (((int32_t)AUDIO_GOERTZEL_COEFF * d->s1) >> 14) * d->s2;
+  d->power = (p > 0) ? p : 0;
+  d->level = d->sum_abs;
+
+  // A beat is a jump in the bass power well above its average; the hold-off keeps one kick from counting twice
+  d->beat = 0;
+  if(d->holdoff) {
+    d->holdoff--;
+  } else if(d->power > AUDIO_BEAT_FLOOR && d->power > (d->power_avg >> 4) * AUDIO_BEAT_RATIO_Q4) {
+    d->beat = 1;
+    d->holdoff = AUDIO_BEAT_HOLDOFF_BLOCKS;
+  }
+  if(d->power > d->power_avg) d->power_avg += (d->power - d->power_avg) >> 5;
+  else                        d->power_avg -= (d->power_avg - d->power) >> 5;
+
+  // Intensity relative to a decaying peak: follows the volume of the music within a few seconds
+  if(d->level > d->level_peak) d->level_peak = d->level;
+  else if(d->level_peak > AUDIO_LEVEL_FLOOR) d->level_peak -= d->level_peak >> 6;
+  const uint16_t intensity = ((uint32_t)d->level * 255) / d->level_peak;
+  d->intensity = (intensity > 255) ? 255 : intensity;
+
+  if(d->level > AUDIO_LEVEL_FLOOR) d->active = AUDIO_ACTIVE_BLOCKS;
+  else if(d->active) d->active--;
+
+  // Start the next block
+  d->mean = d->sum / AUDIO_BLOCK_SAMPLES;
+  d->s1 = 0;
+  d->s2 = 0;
+  d->sum = 0;
+  d->sum_abs = 0;
+  d->n = 0;
+  return 1;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+/**
+ * heart_audio_detect.h - Heart PCB Project - Fixed-point beat and loudness detection on audio samples
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.15
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_AUDIO_DETECT_H_
+#define _HEART_AUDIO_DETECT_H_
+
+#include "heart_settings.h"
+#include <math.h>
+
+/**
+ * The detector works on blocks of AUDIO_BLOCK_SAMPLES samples. For every sample it runs one step of a Goertzel filter
+ * tuned to bin AUDIO_BEAT_BIN (the bass drum) and sums the absolute deviation from the mean (the loudness). At the end
+ * of a block, a beat is detected when the power in the bin is AUDIO_BEAT_RATIO_Q4 / 16 times its slow average; the
+ * intensity is the loudness relative to its decaying peak, so it adapts to the volume of the music.
+ *
+ * It only uses integer math and has no dependencies on the hardware so it can be tested on a PC as well, see
+ * tools/audio_host.cpp.
+ */
+
+// Goertzel coefficient 2 * cos(2 * pi * k / N) in Q14; folded to a constant by the compiler
+#define AUDIO_GOERTZEL_COEFF ((int16_t)(2 * 16384 * cos(2 * M_PI * AUDIO_BEAT_BIN / AUDIO_BLOCK_SAMPLES) + 0.5))
+
+// Samples are the sum of AUDIO_DECIMATION 8 bit ADC readings; they are scaled to 8 bits for the filter
+#define AUDIO_SAMPLE_SHIFT ((AUDIO_DECIMATION >= 2) + (AUDIO_DECIMATION >= 4) + (AUDIO_DECIMATION >= 8))
+
+typedef struct {
+  // Per block state
+  int16_t  s1;         // Goertzel filter state
+  int16_t  s2;
+  uint16_t sum;        // Sum of the samples, the mean is subtracted from the samples of the next block
+  uint16_t sum_abs;    // Sum of the absolute deviation from the mean
+  uint8_t  n;          // Number of samples in the current block
+  uint16_t mean;       // Mean of the previous block
+  // Slow state
+  uint32_t power_avg;  // Average power in the beat bin
+  uint16_t level_peak; // Decaying peak of the loudness, used as the reference for the intensity
+  uint8_t  holdoff;    // Blocks left before the next beat can be detected
+  uint8_t  active;     // Blocks left before the music is considered stopped
+  // Results of the last block
+  uint32_t power;      // Power in the beat bin
+  uint16_t level;      // Loudness: sum of the absolute deviation
+  uint8_t  intensity;  // Loudness scaled to 0-255
+  uint8_t  beat;       // 1 when a beat started in this block
+} audio_detect_t;
+
+/**
+ * Reset the detector state
+ */
+void audio_detect_init(audio_detect_t *d);
+
+/**
+ * Feed one sample to the detector
+ * @param sample Sum of AUDIO_DECIMATION 8 bit ADC readings
+ * @return 1 when the sample completed a block: the results in the detector state are updated
+ */
+uint8_t audio_detect_sample(audio_detect_t *d, uint16_t sample);
+
+#endif
\ No newline at end of file
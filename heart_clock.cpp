@@ -0,0 +1,195 @@
+/**
+ * heart_clock.cpp - Heart PCB Project - CPU clock scaling to save power when the work allows it
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.22
+ * @license GNUGPLv3
+ */
+
+#include "heart_clock.h"
+#include "heart_isr.h"
+#include "heart_time.h"
+#include "Arduino.h"
+
+uint8_t  clock_shift = 0;
+uint32_t clock_time_ms [3] = { 0, 0, 0 };
+
+volatile uint32_t _clock_busy = 0;
+volatile uint16_t _clock_peak = 0;
+
+static const uint8_t clock_mcu_ma_table [3] = CLOCK_MCU_MA;
+
+/**
+ * Estimated current drawn by the CPU in mA at the current clock
+ */
+uint8_t clock_mcu_ma() {
+  return clock_mcu_ma_table[clock_shift];
+}
+
+/**
+ * Current saved by the CPU in mA compared to running at F_CPU, to correct POWER_BASE_MA
+ */
+uint8_t clock_saved_ma() {
+  return clock_mcu_ma_table[0] - clock_mcu_ma_table[clock_shift];
+}
+
+#ifdef SUPPORT_CLOCK_SCALING
+#include <avr/power.h>
+
+// After raising the clock, wait this many decisions before lowering it again; an overload shows up only after the fact
+#define CLOCK_HOLD_UPDATES 20
+
+// Real time at the last clock change (or fold), and the value of micros() / millis() at that moment
+uint32_t clock_us     = 0;
+uint32_t clock_us_raw = 0;
+uint32_t clock_ms     = 0;
+uint32_t clock_ms_raw = 0;
+
+uint8_t  clock_hold     = 0; // Decisions left before the clock may be lowered again
+uint32_t clock_last_ms  = 0; // Time of the last decision
+uint32_t clock_yield_ms = 0; // Time of the last call, to find the longest wait of the main loop
+uint16_t clock_gap_ms   = 0; // Longest wait of the main loop since the last decision
+uint16_t clock_missed   = 0; // Missed ticks at the last decision
+
+/**
+ * Time in us since boot, corrected for the clock changes
+ */
+uint32_t clock_micros() {
+  return clock_us + ((micros() - clock_us_raw) << clock_shift);
+}
+
+/**
+ * Time in ms since boot, corrected for the clock changes
+ */
+uint32_t clock_millis() {
+  return clock_ms + ((millis() - clock_ms_raw) << clock_shift);
+}
+
+/**
+ * Move the reference points of clock_micros() and clock_millis() to now, so the scaled part stays short
+ */
+static void clock_fold() {
+  const uint32_t us = micros();
+  const uint32_t ms = millis();
+  clock_us += (us - clock_us_raw) << clock_shift;
+  clock_us_raw = us;
+  clock_ms += (ms - clock_ms_raw) << clock_shift;
+  clock_ms_raw = ms;
+}
+
+/**
+ * Switch the CPU clock and adjust everything which runs on it
+ * @return 1 when the clock was changed, 0 when it has to be retried later
+ */
+static uint8_t clock_set(uint8_t shift) {
+  // Bits which are on the wire would change speed halfway: wait until everything was sent
+  if(Serial.availableForWrite() < SERIAL_TX_BUFFER_SIZE - 1) return 0;
+  Serial.flush();
+
+  const uint8_t sreg = SREG;
+  cli();
+  if(_pwm_tail_long) {
+    // The timer runs a long tick for the tail of a PWM period, changing ICR1 now would cut it short
+    SREG = sreg;
+    return 0;
+  }
+  clock_fold();
+  clock_prescale_set((clock_div_t)shift);
+  clock_shift = shift;
+
+  // Same tick length: Timer1 runs at the CPU clock, TimerOne set TOP to F_CPU / 2000000 counts per us. Restart the tick
+  // so the counter is not above the new TOP.
+  ICR1 = ((uint16_t)(F_CPU / 2000000) * TIMER_INTERVAL_US) >> shift;
+  TCNT1 = 0;
+  #ifdef SUPPORT_TICK_TIME
+    // The tick which was cut short counts as a full one: the time base jumps ahead a bit instead of going back
+    _time_ticks++;
+  #endif
+
+  // Same baud rate, using the formula of Serial.begin()
+  if(UCSR0A & _BV(U2X0)) UBRR0 = ((F_CPU >> shift) / 4 / SERIAL_BAUD - 1) / 2;
+  else                   UBRR0 = ((F_CPU >> shift) / 8 / SERIAL_BAUD - 1) / 2;
+
+  #ifdef SUPPORT_AUDIO
+    // Same ADC clock (125 kHz) and sample rate: prescaler 128, 64 or 32
+    ADCSRA = (ADCSRA & ~0x07) | (0x07 - shift);
+  #endif
+
+  // Start a new measurement at the new clock
+  _clock_busy = 0;
+  _clock_peak = 0;
+  SREG = sreg;
+  return 1;
+}
+
+/**
+ * Background task for the main loop: measures the load and changes the clock every CLOCK_UPDATE_MS.
+ */
+void clock_service() {
+  const uint32_t now = heart_millis();
+  const uint32_t dt = now - clock_last_ms;
+  const uint16_t gap = clock_yield_ms ? now - clock_yield_ms : 0; // The first call follows setup(), not a wait
+  uint32_t busy;
+  uint16_t peak, period, missed, load_pct, peak_pct;
+  uint8_t  sreg, shift = clock_shift;
+
+  clock_yield_ms = now;
+  if(gap > clock_gap_ms) clock_gap_ms = gap;
+  if(dt < CLOCK_UPDATE_MS) return;
+  clock_last_ms = now;
+  clock_time_ms[shift] += dt;
+  clock_fold();
+
+  sreg = SREG;
+  cli();
+  busy = _clock_busy;
+  peak = _clock_peak;
+  _clock_busy = 0;
+  _clock_peak = 0;
+  missed = _isr_missed;
+  period = 2 * (_pwm_tail_long ? _pwm_base_icr : ICR1);
+  SREG = sreg;
+
+  // Never touch the clock in error mode, the timer might have been set to the error interval on purpose
+  if(_err) return;
+
+  // ISR load in percent of the CPU time and the longest tick in percent of the tick interval
+  load_pct = (busy / ((F_CPU / 1000000UL) >> shift)) * 100 / (dt * 1000);
+  peak_pct = (uint32_t)peak * 100 / period;
+
+  if(missed != clock_missed || load_pct > CLOCK_MAX_LOAD_PCT || peak_pct > CLOCK_MAX_PEAK_PCT ||
+     clock_gap_ms > CLOCK_MAX_GAP_MS) {
+    // Overloaded: raise the clock
+    if(shift > 0) clock_set(shift - 1);
+    clock_hold = CLOCK_HOLD_UPDATES;
+  } else if(clock_hold) {
+    clock_hold--;
+  } else if((1 << shift) < CLOCK_MAX_DIVIDER && 2 * load_pct <= CLOCK_MAX_LOAD_PCT && 2 * peak_pct <= CLOCK_MAX_PEAK_PCT) {
+    // At half the clock every tick takes twice as long, which still fits: lower the clock
+    clock_set(shift + 1);
+  }
+
+  clock_missed = missed;
+  clock_gap_ms = 0;
+}
+
+#else
+// *** No clock scaling support ***
+
+/**
+ * Time in us since boot: without clock scaling this is micros()
+ */
+uint32_t clock_micros() { return micros(); }
+
+/**
+ * Time in ms since boot: without clock scaling this is millis()
+ */
+uint32_t clock_millis() { return millis(); }
+
+/**
+ * Background task for the main loop: measures the load and changes the clock every CLOCK_UPDATE_MS.
+ */
+void clock_service() {}
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * heart_clock.h - Heart PCB Project - CPU clock scaling to save power when the work allows it
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.22
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_CLOCK_H_
+#define _HEART_CLOCK_H_
+
+#include "heart_settings.h"
+
+/**
+ * The CPU clock is F_CPU >> clock_shift. Every CLOCK_UPDATE_MS the ISR load and the longest ISR tick of the last window
+ * are compared with the limits: a tick takes the same number of cycles at any clock, so both double when the clock is
+ * halved. The clock is halved when they would stay within the limits, and doubled as soon as a limit is exceeded, a
+ * tick is missed or the main loop waits too long.
+ *
+ * Changing the clock also changes the timers: Timer1 gets a lower TOP so the PWM ticks keep their length, and as
+ * millis() and micros() (Timer0) slow down, clock_millis() and clock_micros() scale them back to real time. These are
+ * used by heart_millis() and heart_micros() (see heart_time.h).
+ */
+
+// CPU clock divider as a power of 2: 0 is F_CPU, 1 is F_CPU / 2, 2 is F_CPU / 4
+extern uint8_t clock_shift;
+
+// Time spent in every clock mode since boot in ms
+extern uint32_t clock_time_ms [3];
+
+// Time spent in the ISR in Timer1 counts (CPU cycles) and the longest tick since the last clock decision
+extern volatile uint32_t _clock_busy;
+extern volatile uint16_t _clock_peak;
+
+/**
+ * Time in us since boot, corrected for the clock changes
+ */
+uint32_t clock_micros();
+
+/**
+ * Time in ms since boot, corrected for the clock changes
+ */
+uint32_t clock_millis();
+
+/**
+ * Estimated current drawn by the CPU in mA at the current clock
+ */
+uint8_t clock_mcu_ma();
+
+/**
+ * Current saved by the CPU in mA compared to running at F_CPU, to correct POWER_BASE_MA
+ */
+uint8_t clock_saved_ma();
+
+/**
+ * Background task for the main loop: measures the load and changes the clock every CLOCK_UPDATE_MS.
+ */
+void clock_service();
+
+#ifdef SUPPORT_CLOCK_SCALING
+  // Add the duration of a tick to the measured ISR load
+  #define CLOCK_ACCOUNT(__counts) {                         \
+    const uint16_t __c = (__counts);                        \
+    _clock_busy += __c;                                     \
+    if(__c > _clock_peak) _clock_peak = __c;                \
+  }
+#else
+  #define CLOCK_ACCOUNT(__counts) {}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,387 @@
+/**
+ * heart_command.cpp - Heart PCB Project - Serial command interface for live control and parameter tuning
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.05
+ * @license GNUGPLv3
+ */
+
+#include "heart_command.h"
+#include "heart_isr.h"
+#include "heart_delay.h"
+#include "heart_eeprom.h"
+#include "heart_telemetry.h"
+#include "heart_stream.h"
+#include "heart_power.h"
+#include "heart_governor.h"
+#include "heart_audio.h"
+#include "heart_clock.h"
+#include "heart_event.h"
+#include "heart_wave.h"
+#include "heart_frames.h"
+#include "heart_memory.h"
+#include "heart_load.h"
+#include "heart_trace.h"
+
+volatile int8_t command_animation = -1; // Animation requested by the 'a' command, -1 when there is no request
+
+#ifdef SUPPORT_COMMANDS
+#include "Arduino.h"
+
+// Maximum length of a command line, longer lines are rejected
+#define COMMAND_LINE_MAX 24
+
+// Output in progress; the listings print one line per call of command_service() and end with the reply
+#define COMMAND_OUT_NONE     0
+#define COMMAND_OUT_REPLY    1 // "OK" or "ERR"
+#define COMMAND_OUT_PARAMS   2 // 'p' without a name
+#define COMMAND_OUT_COUNTERS 3 // 'c'
+#define COMMAND_OUT_ERRORS   4 // 'e'
+#define COMMAND_OUT_TRACE    5 // 't'
+
+char    command_line [COMMAND_LINE_MAX]; // Line being received
+uint8_t command_len = 0;                 // Number of characters in command_line, COMMAND_LINE_MAX when the line overflowed
+uint8_t command_ready = 0;               // Set when command_line is complete, it runs once the output is done
+uint8_t command_out = COMMAND_OUT_NONE;  // Output in progress
+uint8_t command_out_idx = 0;             // Next line of the listing
+uint8_t command_out_sub = 0;             // Next value of a line with a value per animation
+uint8_t command_ok = 0;                  // Result of the command, for the reply
+
+// Counters which are updated from interrupts, copied atomically by the 'c' command
+struct {
+  uint16_t avoided, late, missed, peak, period;
+  uint32_t written;
+  #ifdef SUPPORT_ISR_JITTER
+    uint16_t entry_min, entry_max;
+  #endif
+} command_snap;
+
+/**
+ * Start the serial port for the command interface
+ */
+void command_init() {
+  Serial.begin(SERIAL_BAUD);
+}
+
+/**
+ * Parse a decimal number, returns the position after the number or NULL when there is no number
+ */
+static char *command_parse_num(char *p, uint16_t *val) {
+  while(*p == ' ') p++;
+  if(*p < '0' || *p > '9') return NULL;
+  *val = 0;
+  while(*p >= '0' && *p <= '9') {
+    *val = *val * 10 + (*p - '0');
+    p++;
+  }
+  return p;
+}
+
+/**
+ * List or set a tunable parameter
+ * @return 1 on success
+ */
+static uint8_t command_param(char *p, uint8_t animation_id) {
+  command_param_t param;
+  char *name;
+  uint16_t val;
+
+  while(*p == ' ') p++;
+  name = p;
+  while(*p != ' ' && *p != 0) p++;
+  if(*p) *p++ = 0;
+
+  if(*name == 0) {
+    // No name given, list all parameters
+    command_out = COMMAND_OUT_PARAMS;
+    return 1;
+  }
+
+  for(uint8_t i=0; i<command_num_params; i++) {
+    memcpy_P(&param, &command_params[i], sizeof(command_param_t));
+    if(strcmp(name, param.name) == 0) {
+      if(command_parse_num(p, &val) == NULL) return 0;
+      if(param.size == 1) {
+        if(val > 255) return 0;
+        *(uint8_t *)param.value = val;
+      } else {
+        *(uint16_t *)param.value = val;
+      }
+      // Restart the running animation so it picks up the new value
+      command_animation = animation_id;
+      disable_heart_delay();
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Print the next parameter of the listing
+ * @return 0 when all parameters have been printed
+ */
+static uint8_t command_param_line() {
+  command_param_t param;
+
+  if(command_out_idx >= command_num_params) return 0;
+  memcpy_P(&param, &command_params[command_out_idx++], sizeof(command_param_t));
+  Serial.print(param.name);
+  Serial.print(' ');
+  Serial.println(param.size == 1 ? *(uint8_t *)param.value : *(uint16_t *)param.value);
+  return 1;
+}
+
+/**
+ * Copy the counters which are updated from interrupts, for the listing of the counters
+ */
+static void command_counters() {
+  uint8_t sreg = SREG;
+
+  // The EEPROM, stream and ISR counters are updated from interrupts, copy them atomically
+  cli();
+  command_snap.avoided = eeprom_writes_avoided;
+  command_snap.written = eeprom_bytes_written;
+  command_snap.late    = stream_late;
+  command_snap.missed  = _isr_missed;
+  command_snap.peak    = _isr_peak;
+  command_snap.period  = 2 * (_pwm_tail_long ? _pwm_base_icr : ICR1);
+  #ifdef SUPPORT_ISR_JITTER
+    // The entry spread starts over with every print, so each one covers the time since the previous
+    command_snap.entry_min = _isr_entry_min;
+    command_snap.entry_max = _isr_entry_max;
+    _isr_entry_min = 0xFFFF;
+    _isr_entry_max = 0;
+  #endif
+  SREG = sreg;
+
+  command_out = COMMAND_OUT_COUNTERS;
+}
+
+// Print a line of the counters when it is the next one
+#define COUNTER_LINE(__name, __value) {                                    \
+  if(line++ == command_out_idx) {                                          \
+    Serial.print(F(__name " "));                                           \
+    Serial.println(__value);                                               \
+    command_out_idx++;                                                     \
+    return 1;                                                              \
+  }                                                                        \
+}
+
+// Print the next part of the line of the counters with a value per animation when it is the next one: the name and a
+// value, then one more value per call and the end of the line
+#define COUNTER_ANIMATIONS(__name, __field) {                              \
+  if(line++ == command_out_idx) {                                          \
+    if(command_out_sub == 0) Serial.print(F(__name));                      \
+    if(command_out_sub < NUM_ANIMATIONS) {                                 \
+      Serial.print(' ');                                                   \
+      Serial.print(heart_delay_stats[command_out_sub++].__field);          \
+    } else {                                                               \
+      Serial.println();                                                    \
+      command_out_sub = 0;                                                 \
+      command_out_idx++;                                                   \
+    }                                                                      \
+    return 1;                                                              \
+  }                                                                        \
+}
+
+/**
+ * Print the next line of the counters of the various subsystems
+ * @return 0 when all counters have been printed
+ */
+static uint8_t command_counter_line() {
+  uint8_t line = 0;
+
+  COUNTER_LINE("eeprom_avoided",    command_snap.avoided);
+  COUNTER_LINE("eeprom_written",    command_snap.written);
+  COUNTER_LINE("telemetry_dropped", telemetry_dropped);
+  COUNTER_LINE("stream_dropped",    stream_dropped);
+  COUNTER_LINE("stream_late",       command_snap.late);
+  COUNTER_LINE("stream_duplicate",  stream_duplicate);
+  COUNTER_LINE("power_ma",          power_ma);
+  COUNTER_LINE("power_mah",         power_mah);
+  COUNTER_LINE("isr_missed",        command_snap.missed);
+  COUNTER_LINE("isr_peak_pct",      (uint32_t)command_snap.peak * 100 / command_snap.period);
+  COUNTER_LINE("isr_peak_cyc",      command_snap.peak);
+  #ifdef SUPPORT_ISR_JITTER
+    COUNTER_LINE("isr_entry_cyc_min", command_snap.entry_min);
+    COUNTER_LINE("isr_entry_cyc_max", command_snap.entry_max);
+  #endif
+  COUNTER_LINE("isr_interval_us",   governor_interval_us);
+  COUNTER_LINE("audio_beats",       audio_beats);
+  COUNTER_LINE("audio_overruns",    audio_overruns);
+  COUNTER_LINE("audio_cyc_sample",  audio_cycles_per_sample);
+  COUNTER_LINE("audio_cyc_goertzel", audio_cycles_goertzel);
+  COUNTER_LINE("clock_mhz",         (F_CPU / 1000000) >> clock_shift);
+  COUNTER_LINE("clock_mcu_ma",      clock_mcu_ma());
+  COUNTER_LINE("clock_div1_s",      clock_time_ms[0] / 1000);
+  COUNTER_LINE("clock_div2_s",      clock_time_ms[1] / 1000);
+  COUNTER_LINE("clock_div4_s",      clock_time_ms[2] / 1000);
+  COUNTER_LINE("event_latency_us",  event_latency_us);
+  COUNTER_LINE("event_latency_max_us", event_latency_max_us);
+  COUNTER_LINE("event_dropped",     event_dropped);
+  // Steps which missed their deadline and the largest overrun in us, one value per animation
+  COUNTER_ANIMATIONS("delay_overruns", overruns);
+  COUNTER_ANIMATIONS("delay_overrun_max_us", overrun_max_us);
+  COUNTER_LINE("wave_render_us_max", wave_render_us_max);
+  COUNTER_LINE("wave_cyc_frame",    wave_cycles_frame);
+  COUNTER_LINE("wave_cyc_led",      wave_cycles_frame / NUM_LEDS);
+  COUNTER_LINE("trace_cyc_record",  trace_cycles_record);
+  COUNTER_LINE("frames_decode_us_max", frames_decode_us_max);
+  COUNTER_LINE("sram_static",       memory_static);
+  // Both 0 and 65535 without SUPPORT_STACK_CHECK
+  COUNTER_LINE("stack_free_min",    memory_stack_free());
+  // Share of the CPU over the last LOAD_SLOTS * LOAD_SLOT_MS; all 0 without SUPPORT_LOAD_METER
+  COUNTER_LINE("load_isr_pct",      load_isr_pct());
+  COUNTER_LINE("load_main_pct",     load_main_pct());
+  COUNTER_LINE("load_idle_pct",     load_idle_pct());
+  COUNTER_LINE("err",               _err);
+  COUNTER_LINE("demo",              demo_mode);
+  COUNTER_LINE("brightness",        GET_BRIGHTNESS_SCALE);
+  return 0;
+}
+
+/**
+ * Print the next entry of the error log, newest first: code, animation and uptime in ms
+ * @return 0 when all entries have been printed
+ */
+static uint8_t command_error_line() {
+  eeprom_error_t err;
+
+  if(command_out_idx >= ERROR_LOG_ENTRIES) return 0;
+  const uint8_t res = eeprom_error_read(command_out_idx, &err);
+  // The EEPROM is being written in the background, try again on the next call
+  if(res == EEPROM_ERROR_BUSY) return 1;
+  if(!res) return 0;
+  command_out_idx++;
+  Serial.print(err.code);
+  Serial.print(' ');
+  Serial.print(err.animation_id);
+  Serial.print(' ');
+  Serial.println(err.uptime_ms);
+  return 1;
+}
+
+/**
+ * Print the next line of the output in progress: a line of the listing, or the reply when the listing is done
+ */
+static void command_out_line() {
+  uint8_t more;
+
+  switch(command_out) {
+    case COMMAND_OUT_PARAMS:   more = command_param_line();   break;
+    case COMMAND_OUT_COUNTERS: more = command_counter_line(); break;
+    case COMMAND_OUT_ERRORS:   more = command_error_line();   break;
+    case COMMAND_OUT_TRACE:    more = trace_dump_line();      break;
+    default:
+      Serial.println(command_ok ? F("OK") : F("ERR"));
+      command_out = COMMAND_OUT_NONE;
+      return;
+  }
+  if(!more) command_out = COMMAND_OUT_REPLY;
+}
+
+/**
+ * Run a complete command line
+ * @return 1 on success
+ */
+static uint8_t command_run(uint8_t animation_id) {
+  uint16_t val;
+  char *p = &command_line[1];
+
+  switch(command_line[0]) {
+    case 'a':
+      if(command_parse_num(p, &val) == NULL || val >= NUM_ANIMATIONS) return 0;
+      command_animation = val;
+      // Abort the running animation so the main loop can switch
+      disable_heart_delay();
+      return 1;
+    case 'b':
+      if(command_parse_num(p, &val) == NULL || val >= NUM_BRIGHTNESS_LEVELS) return 0;
+      SET_BRIGHTNESS_SCALE(val);
+      return 1;
+    case 'd':
+      if(command_parse_num(p, &val) == NULL || val > 5) return 0;
+      demo_mode = val;
+      return 1;
+    case 'p':
+      return command_param(p, animation_id);
+    case 'c':
+      command_counters();
+      return 1;
+    case 'e':
+      command_out = COMMAND_OUT_ERRORS;
+      return 1;
+    case 'l':
+      if(command_parse_num(p, &val) == NULL || val > 1) return 0;
+      load_bar_show(val);
+      return 1;
+    case 't':
+      command_out = COMMAND_OUT_TRACE;
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Background task for the main loop: processes at most COMMAND_BYTES_PER_CALL received bytes and runs a command
+ * when a complete line was received. Replies and listings are printed one line per call, when the serial transmit
+ * buffer has room for it; a command which arrives meanwhile waits for them.
+ * @param animation_id Animation which is currently running, used to restart it when a parameter changes
+ */
+void command_service(uint8_t animation_id) {
+  if(command_out != COMMAND_OUT_NONE) {
+    if(Serial.availableForWrite() >= COMMAND_OUT_ROOM) command_out_line();
+    // Leave the bytes after a complete line in the receive buffer until the output is done and the line ran
+    if(command_ready) return;
+  }
+
+  for(uint8_t n=0; n<COMMAND_BYTES_PER_CALL && !command_ready; n++) {
+    int c = Serial.read();
+    if(c < 0) break;
+
+    // Streamed frames are binary and never valid text, hand them to the stream parser
+    if(stream_rx(c)) continue;
+
+    if(c == '\n' || c == '\r') {
+      // End of line, run the command (empty lines are ignored)
+      if(command_len == 0) continue;
+      command_ready = 1;
+    } else if(command_len < COMMAND_LINE_MAX - 1) {
+      command_line[command_len++] = c;
+    } else {
+      // Line too long, drop the rest and reject it
+      command_len = COMMAND_LINE_MAX;
+    }
+  }
+
+  // Only run one command per call to keep the time slice bounded; its output starts on the next call
+  if(command_ready && command_out == COMMAND_OUT_NONE) {
+    command_out_idx = 0;
+    command_out_sub = 0;
+    if(command_len < COMMAND_LINE_MAX) {
+      command_line[command_len] = 0;
+      command_ok = command_run(animation_id);
+    } else {
+      command_ok = 0;
+    }
+    if(command_out == COMMAND_OUT_NONE) command_out = COMMAND_OUT_REPLY;
+    command_len = 0;
+    command_ready = 0;
+  }
+}
+
+#else
+// *** No command support ***
+
+/**
+ * Start the serial port for the command interface
+ */
+void command_init() {}
+
+/**
+ * Background task for the main loop: processes received bytes and runs commands.
+ */
+void command_service(uint8_t /* animation_id */) {}
+
+#endif
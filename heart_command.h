@@ -0,0 +1,55 @@
+/**
+ * heart_command.h - Heart PCB Project - Serial command interface for live control and parameter tuning
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.05
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_COMMAND_H_
+#define _HEART_COMMAND_H_
+
+#include "heart_settings.h"
+
+/**
+ * Commands are single lines of text, terminated by a newline:
+ *   a <id>           Switch to animation <id>
+ *   b <level>        Set the brightness level (0 = brightest)
+ *   d <level>        Set the demo mode level (0 = off)
+ *   p                List all tunable parameters
+ *   p <name> <value> Set a parameter; the running animation restarts to apply it
+ *   c                Print the counters
+ *   e                Print the error log, newest first: "<code> <animation> <uptime ms>" per line
+ *   l <0|1>          Show the animation (0) or the CPU load bar (1) on the LEDs; needs SUPPORT_LOAD_BAR
+ *   t                Print and empty the event trace: "<ticks> <event> <arg>" per line and "trace <tick us> <lost>"
+ * Every command is answered with a line starting with "OK" or "ERR", after the lines it prints.
+ */
+
+// Tunable parameter, the table of parameters lives in flash (PROGMEM)
+typedef struct {
+  char     name [10]; // Name of the parameter as used by the 'p' command
+  void    *value;     // Pointer to the parameter in RAM
+  uint8_t  size;      // Size of the parameter in bytes: 1 or 2
+} command_param_t;
+
+// Table of tunable parameters, provided by the main sketch
+extern const command_param_t command_params [];
+extern const uint8_t         command_num_params;
+
+// Animation requested by the 'a' command, -1 when there is no request; the main loop switches and clears it
+extern volatile int8_t command_animation;
+
+/**
+ * Start the serial port for the command interface
+ */
+void command_init();
+
+/**
+ * Background task for the main loop: processes at most COMMAND_BYTES_PER_CALL received bytes and runs a command
+ * when a complete line was received. Replies and listings are printed one line per call, when the serial transmit
+ * buffer has room for it; a command which arrives meanwhile waits for them.
+ * @param animation_id Animation which is currently running, used to restart it when a parameter changes
+ */
+void command_service(uint8_t animation_id);
+
+#endif
\ No newline at end of file
@@ -8,26 +8,114 @@
  */
 
 #include "heart_delay.h"
+#include "heart_sync.h"
+#include "heart_load.h"
+#include "heart_trace.h"
 #include "Arduino.h"
 
 // Special flag set when heart_delay() should stop any delay and return control to the main loop
 volatile uint8_t _abort_heart_delay = 0;
 
+heart_delay_stats_t heart_delay_stats [NUM_ANIMATIONS];
+uint32_t heart_deadline_us = 0;
+uint8_t  heart_delay_animation = 0; // Animation the overruns are counted for
+uint8_t  heart_delay_catchup = 0;   // Set while the steps run without waiting to catch up with an aligned start
+
 /**
  * Modified version of delay() which aborts when _abort_heart_delay turns 1.
+ * When synchronising with other hearts, the time is the sync time which can be corrected while waiting; the signed
+ * comparison makes sure a correction backwards only extends the delay.
  * @return 1 when the delay is aborted, 0 when is completed like normal delay()
  */
 uint8_t heart_delay(unsigned long ms)
 {
-  uint32_t start = micros();
+  uint32_t start = HEART_MICROS();
 
+  TRACE(TRACE_WAIT, (ms < 65535) ? ms : 65535);
+  load_wait_begin();
   while (ms > 0 && _abort_heart_delay == 0) {
     yield();
-    while ( ms > 0 && (micros() - start) >= 1000) {
+    while ( ms > 0 && (int32_t)(HEART_MICROS() - start) >= 1000) {
       ms--;
       start += 1000;
     }
   }
+  load_wait_end();
+  TRACE(TRACE_RESUME, _abort_heart_delay);
 
   return _abort_heart_delay;
+}
+
+/**
+ * Start the deadlines of an animation from now; its overruns are counted in heart_delay_stats[animation]
+ */
+void heart_delay_start(uint8_t animation) {
+  heart_delay_animation = (animation < NUM_ANIMATIONS) ? animation : 0;
+  heart_deadline_us = HEART_MICROS();
+  heart_delay_catchup = 0;
+}
+
+/**
+ * Start the deadlines from now again, for an animation which waited for something else than time
+ */
+void heart_delay_resync() {
+  heart_deadline_us = HEART_MICROS();
+  heart_delay_catchup = 0;
+}
+
+/**
+ * Start the deadlines of the running animation at start_us (in HEART_MICROS() time) instead, the start of the same
+ * animation on another heart; when that lies in the past, the steps run without waiting and without counting overruns
+ * until they caught up with the deadlines
+ */
+void heart_delay_align(uint32_t start_us) {
+  heart_deadline_us = start_us;
+  heart_delay_catchup = 1;
+}
+
+/**
+ * Wait until the absolute time deadline_us (in HEART_MICROS() time); runs yield() at least once.
+ * The signed comparison keeps working when the time wraps around.
+ * @return 1 when the delay is aborted, 0 when the deadline is reached
+ */
+uint8_t heart_delay_until(uint32_t deadline_us)
+{
+#ifdef SUPPORT_TRACE
+  const int32_t wait_us = deadline_us - HEART_MICROS();
+  TRACE(TRACE_WAIT, (wait_us <= 0) ? 0 : (wait_us < 65535000L) ? wait_us / 1000 : 65535);
+#endif
+  load_wait_begin();
+  do {
+    yield();
+  } while(_abort_heart_delay == 0 && (int32_t)(HEART_MICROS() - deadline_us) < 0);
+  load_wait_end();
+  TRACE(TRACE_RESUME, _abort_heart_delay);
+
+  return _abort_heart_delay;
+}
+
+/**
+ * Wait until period_ms after the deadline of the previous step.
+ * @return 1 when the delay is aborted, 0 when the deadline is reached
+ */
+uint8_t heart_delay_next(uint16_t period_ms)
+{
+  const uint32_t now = HEART_MICROS();
+  heart_deadline_us += period_ms * 1000UL;
+
+  const int32_t late_us = now - heart_deadline_us;
+  if(late_us < 0) {
+    heart_delay_catchup = 0;
+  } else if(!heart_delay_catchup) {
+    // The step took longer than its period; a period of 0 only asks to run the background tasks
+    if(period_ms > 0) {
+      heart_delay_stats_t *st = &heart_delay_stats[heart_delay_animation];
+      if(st->overruns < 65535) st->overruns++;
+      if(late_us > st->overrun_max_us) st->overrun_max_us = (late_us < 65535) ? late_us : 65535;
+      TRACE(TRACE_OVERRUN, (late_us < 65535) ? late_us : 65535);
+    }
+    heart_deadline_us = now;
+  }
+
+  return heart_delay_until(heart_deadline_us);
 }
\ No newline at end of file
@@ -20,6 +20,55 @@ extern volatile uint8_t _abort_heart_delay;
  */
 uint8_t heart_delay(unsigned long ms);
 
+/**
+ * Animations which step at a fixed rate wait with heart_delay_next() instead of heart_delay(): it waits until an
+ * absolute deadline which moves by the period of every step, so the time the animation spends on a step (and in yield())
+ * no longer adds up. A step which finishes after its deadline is an overrun: it is counted for the animation and the
+ * next deadline starts from now, rather than rushing through the steps which were missed.
+ * Synchronised hearts (SUPPORT_SYNC) move the first deadline to the start of the animation on the master with
+ * heart_delay_align(); a heart which starts later runs the missed steps without waiting until it caught up.
+ */
+
+// Overrun statistics per animation
+typedef struct {
+  uint16_t overruns;       // Steps which finished after their deadline
+  uint16_t overrun_max_us; // Largest overrun, saturates at 65535
+} heart_delay_stats_t;
+
+extern heart_delay_stats_t heart_delay_stats [NUM_ANIMATIONS];
+
+// Deadline of the step which is running, in HEART_MICROS() time
+extern uint32_t heart_deadline_us;
+
+/**
+ * Start the deadlines of an animation from now; its overruns are counted in heart_delay_stats[animation]
+ */
+void heart_delay_start(uint8_t animation);
+
+/**
+ * Start the deadlines from now again, for an animation which waited for something else than time
+ */
+void heart_delay_resync();
+
+/**
+ * Start the deadlines of the running animation at start_us (in HEART_MICROS() time) instead, the start of the same
+ * animation on another heart; when that lies in the past, the steps run without waiting and without counting overruns
+ * until they caught up with the deadlines
+ */
+void heart_delay_align(uint32_t start_us);
+
+/**
+ * Wait until the absolute time deadline_us (in HEART_MICROS() time); runs yield() at least once.
+ * @return 1 when the delay is aborted, 0 when the deadline is reached
+ */
+uint8_t heart_delay_until(uint32_t deadline_us);
+
+/**
+ * Wait until period_ms after the deadline of the previous step.
+ * @return 1 when the delay is aborted, 0 when the deadline is reached
+ */
+uint8_t heart_delay_next(uint16_t period_ms);
+
 /**
  * Abort the heart_delay() function; subsequent calls will simply abort immediately
  */
@@ -9,18 +9,26 @@
 
 /**
  * EEPROM layout:
- *   0            4 + N * 4              4 + (N+1) * 4
- * | 4 bytes    | X bytes (can be 0)   | 4 bytes           |
- * | MAGIC      | old unused data      | eeprom_settings_t |
+ *   0            4                      4 + N * 6            4 + (N+1) * 6                          E2END+1 - ERROR_LOG_ENTRIES * 8
+ * | 4 bytes    | X bytes (can be 0)   | 6 bytes           | Y bytes (can be 0)   | unused        | ERROR_LOG_ENTRIES * 8 bytes |
+ * | MAGIC      | older records        | eeprom_record_t   | records of last lap  |               | eeprom_error_t ring buffer  |
  *
- * After using a position, the carrot field is set to something not 42, marking it as invalid.
+ * The records form a circular log: every store writes the next slot with a sequence number one higher than the
+ * previous record. Starting at slot 0, the slots written in the current lap all satisfy 'seq == seq of slot 0 + slot',
+ * the first slot where this does not hold (or the checksum fails) is past the newest record. This allows a binary
+ * search on boot-up instead of scanning the whole EEPROM.
  * By shifting the position where the settings are stored, the EEPROM is worn out gradually (years of use when writing every 20 seconds)
+ *
+ * The error log at the end works the same way on a small scale: the entries are written in turn with an increasing
+ * sequence number, the newest entry is the valid one which is not followed by its successor.
  */
 
 
 #include "heart_eeprom.h"
 #include "heart_profiling.h"
 #include "heart_settings.h"
+#include "heart_isr.h"
+#include "heart_time.h"
 
 #ifdef SUPPORT_EEPROM
 #include "EEPROM.h"
@@ -35,16 +43,95 @@
 #endif
 
 // Magic value to store at position 0 in the EEPROM; when this differs the EEPROM content is invalid
-#define EEPROM_MAGIC 0xCAFED00D
+// Note: changed from 0xCAFED00D when the sequence numbered log was introduced and from 0xCAFED00E when the error log
+// was added, so old layouts are wiped on first boot
+#define EEPROM_MAGIC 0xCAFED00F
+
+// Start of the record log, right after the magic number
+#define EEPROM_LOG_START 4
+
+// Start of the error log at the end of the EEPROM: E2END is the last valid address
+#define EEPROM_ERRLOG_START (E2END + 1 - ERROR_LOG_ENTRIES * sizeof(eeprom_error_t))
+
+// Number of records that can be written after another before having to start over
+#define NUM_SETTINGS ((EEPROM_ERRLOG_START - EEPROM_LOG_START) / sizeof(eeprom_record_t))
+
+// Address of a record slot in the EEPROM
+#define EEPROM_SLOT_ADDR(__slot) (EEPROM_LOG_START + (__slot) * sizeof(eeprom_record_t))
+
+// Address of an error log entry in the EEPROM
+#define EEPROM_ERRLOG_ADDR(__entry) (EEPROM_ERRLOG_START + (__entry) * sizeof(eeprom_error_t))
 
-// Number of setting structs that can be written after another before having to start over. Note that the magic number at the start uses up 1 position
-#define NUM_SETTINGS ((E2END + 1 / 4) - 1)
-//#define NUM_SETTINGS 25
+// Size of the write-behind buffer: fits both a settings record and an error log entry
+#define EEPROM_WR_BUF_SIZE (sizeof(eeprom_record_t) > sizeof(eeprom_error_t) ? sizeof(eeprom_record_t) : sizeof(eeprom_error_t))
 
 volatile int16_t eeprom_pos = -1; // Pointer to the location where the settings will be stored next - updated when loading the EEPROM on boot-up
+uint16_t eeprom_seq = 0;          // Sequence number for the next record that is stored
 int eeprom_ok = 0;                // On the first call to check_eeprom this is set to 1, so the magic number is only read once
 
 eeprom_settings_t eeprom_settings; // Struct containing the current settings (shared as an exernal)
+eeprom_settings_t eeprom_committed; // Settings as last written (or queued for writing) to the EEPROM
+uint8_t  eeprom_dirty = 0;          // Set when eeprom_settings differ from the EEPROM and a commit is pending
+uint32_t eeprom_dirty_ms = 0;       // Time of the last change to the settings, used to wait until they are stable
+
+// Write-behind state: the record (or error log entry) being streamed to the EEPROM by the EEPROM ready interrupt
+volatile uint8_t  eeprom_wr_buf [EEPROM_WR_BUF_SIZE];
+volatile uint16_t eeprom_wr_addr = 0; // EEPROM address of the first byte of the record
+volatile uint8_t  eeprom_wr_len  = 0; // Number of bytes in the buffer
+volatile uint8_t  eeprom_wr_idx  = 0; // Next byte to write, equal to eeprom_wr_len when idle
+
+// Error log state
+int8_t  eeprom_err_pos = -1;  // Entry to write the next error to, -1 until the log was scanned
+uint8_t eeprom_err_seq = 0;   // Sequence number for the next error
+uint8_t eeprom_err_last = 0;  // Last error code seen, to log every error only once
+uint8_t eeprom_err_pending = 0; // Error code queued by eeprom_error_log(), 0 when there is none
+
+volatile uint16_t eeprom_writes_avoided = 0; // Number of stores that did not result in a write
+volatile uint32_t eeprom_bytes_written  = 0; // Number of bytes physically written to the EEPROM
+
+/**
+ * Compute the checksum of a record or error log entry, which is stored in the last byte and therefore not included;
+ * seeded so that both erased (0xFF) and zeroed slots are invalid
+ */
+static uint8_t eeprom_checksum(const void *data, uint8_t len) {
+  const uint8_t *b = (const uint8_t *)data;
+  uint8_t sum = 0xA5;
+  for(uint8_t i = 0; i < len - 1; i++) {
+    sum = (sum << 1 | sum >> 7) ^ b[i];
+  }
+  return sum;
+}
+
+/**
+ * Read the record at a slot, returns 1 when it holds a valid record
+ */
+static uint8_t eeprom_read_record(int16_t slot, eeprom_record_t *rec) {
+  EEPROM.get(EEPROM_SLOT_ADDR(slot), *rec);
+  return rec->check == eeprom_checksum(rec, sizeof(eeprom_record_t));
+}
+
+/**
+ * Read an error log entry, returns 1 when it holds a valid entry; uses the same checksum as the records
+ */
+static uint8_t eeprom_read_error(uint8_t entry, eeprom_error_t *err) {
+  EEPROM.get(EEPROM_ERRLOG_ADDR(entry), *err);
+  return err->check == eeprom_checksum(err, sizeof(eeprom_error_t));
+}
+
+/**
+ * Start writing a buffer to the EEPROM in the background; the writer has to be idle
+ */
+static void eeprom_write_start(uint16_t addr, const void *data, uint8_t len) {
+  memcpy((void *)eeprom_wr_buf, data, len);
+  eeprom_wr_addr = addr;
+  eeprom_wr_len  = len;
+
+  // Hand the buffer to the interrupt; it fires as soon as the EEPROM is idle
+  eeprom_wr_idx = 0;
+  barrier();
+  TRACE(TRACE_EEPROM_START, addr);
+  EECR |= _BV(EERIE);
+}
 
 /**
  * Check if the EEPROM was initialized before; if it was, the magic number should be written at the start
@@ -52,7 +139,9 @@ eeprom_settings_t eeprom_settings; // Struct containing the current settings (sh
 void eeprom_check() {
   uint32_t magic;
   // Make sure the settings struct is indeed packed (results in a compiler error, no code is added, can be done in any function)
-  BUILD_BUG_ON( sizeof(eeprom_settings_t) != 4 );
+  BUILD_BUG_ON( sizeof(eeprom_settings_t) != 3 );
+  BUILD_BUG_ON( sizeof(eeprom_record_t) != 6 );
+  BUILD_BUG_ON( sizeof(eeprom_error_t) != 8 );
   
   if(eeprom_ok) return;
   EEPROM_SERPRINTLN("EEPROM check");
@@ -69,9 +158,10 @@ void eeprom_check() {
 void eeprom_init() {
   EEPROM_SERPRINTLN("EEPROM init");
   
-  // Erase remainder of EEPROM
-  for(int a = 1; a < NUM_SETTINGS; a++) {
-    EEPROM.put(a * 4, (uint32_t)0);
+  // Erase the record log and the error log; update() only writes bytes that differ so a blank EEPROM (all 0xFF) is not
+  // written at all
+  for(int a = EEPROM_LOG_START; a <= E2END; a++) {
+    EEPROM.update(a, 0xFF);
   }
   
   // Write the magic word
@@ -83,64 +173,203 @@ void eeprom_init() {
 }
 
 /**
- * Store the settings struct into EEPROM. Note that the location is changed every time to do wear levelling.
+ * Queue the settings struct for storing into EEPROM. Returns immediately; the write is done in the background by
+ * eeprom_service() once the settings have been stable for EEPROM_COMMIT_DELAY_MS.
+ * Note that the location is changed every time to do wear levelling.
  */
 void eeprom_store() {
   // When calling store without load, the position is wrong - attempt to load it first and then write
   if(eeprom_pos == -1) eeprom_load();
-  // Now eeprom_pos is valid and ready to be used; use it to compute the potential previous position and wipe that
-  int prev = eeprom_pos - 1;
-  eeprom_settings.carrot = 42; // Hardcode to 42
-  // Store settings
-  EEPROM.put(4 + eeprom_pos * 4, eeprom_settings);
-  //SERPRINT(F("EEPROM store at pos "));
+
+  if(memcmp(&eeprom_settings, &eeprom_committed, sizeof(eeprom_settings_t)) == 0) {
+    // Settings match the EEPROM (again), nothing to write; this also cancels a pending commit
+    eeprom_dirty = 0;
+    eeprom_writes_avoided++;
+    return;
+  }
+
+  // A pending commit which did not start yet is replaced by this one
+  if(eeprom_dirty) eeprom_writes_avoided++;
+  eeprom_dirty = 1;
+  eeprom_dirty_ms = heart_millis();
+}
+
+/**
+ * Background task for the main loop: starts writing queued settings when they have been stable long enough.
+ * The record is streamed to the EEPROM one byte at a time by the EEPROM ready interrupt.
+ */
+void eeprom_service() {
+  eeprom_record_t rec;
+
+  // Only start when a commit is pending, the previous record is completely written and the settings are stable
+  if(!eeprom_dirty || eeprom_wr_idx < eeprom_wr_len) return;
+  if(heart_millis() - eeprom_dirty_ms < EEPROM_COMMIT_DELAY_MS) return;
+
+  // Build the record; no need to invalidate the previous one as the sequence number marks this one as the newest
+  rec.seq      = eeprom_seq;
+  rec.settings = eeprom_settings;
+  rec.check    = eeprom_checksum(&rec, sizeof(eeprom_record_t));
+  eeprom_write_start(EEPROM_SLOT_ADDR(eeprom_pos), &rec, sizeof(eeprom_record_t));
   EEPROM_SERPRINT("EEPROM store at pos ");
   EEPROM_SERPRINTLN(eeprom_pos);
+
+  eeprom_committed = eeprom_settings;
+  eeprom_dirty = 0;
   // Move pointer to next position, honoring wrap around
   eeprom_pos = (eeprom_pos+1) % NUM_SETTINGS;
-  
-  // Invalidate previous setting
-  if(prev < 0) prev += NUM_SETTINGS;
-  EEPROM.put(4 + prev * 4, (uint32_t)0);
-  //SERPRINT(F("EEPROM erased prev at pos "));
-  EEPROM_SERPRINT("EEPROM erased prev at pos ");
-  EEPROM_SERPRINTLN(prev);
+  eeprom_seq++;
+}
+
+/**
+ * Find the next free entry of the error log: the entry after the newest one
+ */
+static void eeprom_error_scan() {
+  eeprom_error_t err;
+  eeprom_check();
+
+  eeprom_err_pos = 0;
+  eeprom_err_seq = 0;
+  for(uint8_t i = 0; i < ERROR_LOG_ENTRIES; i++) {
+    if(!eeprom_read_error(i, &err)) continue;
+    const uint8_t seq = err.seq;
+    const uint8_t next = (i + 1) % ERROR_LOG_ENTRIES;
+    if(!eeprom_read_error(next, &err) || err.seq != (uint8_t)(seq + 1)) {
+      // Entry i is the newest
+      eeprom_err_pos = next;
+      eeprom_err_seq = seq + 1;
+      return;
+    }
+  }
 }
 
 /**
- * Get the settings struct from EEPROM. Because of the wear levelling we have to search for its location so only do this on boot-up.
+ * Background task for the main loop: when an error is raised (_err is set), append it to the error log in EEPROM so it
+ * survives a reset. Every error code is logged once per boot; the entry is written in the background like the settings.
+ */
+void eeprom_error_service(uint8_t animation_id) {
+  eeprom_error_t err;
+  const uint8_t code = eeprom_err_pending ? eeprom_err_pending : _err;
+
+  // Only log new error codes, and wait until the writer is idle (a settings record might be in progress)
+  if(code == 0 || eeprom_wr_idx < eeprom_wr_len) return;
+  if(!eeprom_err_pending && code == eeprom_err_last) return;
+  if(eeprom_err_pos < 0) eeprom_error_scan();
+
+  err.seq          = eeprom_err_seq;
+  err.code         = code;
+  err.animation_id = animation_id;
+  err.uptime_ms    = heart_millis();
+  err.check        = eeprom_checksum(&err, sizeof(eeprom_error_t));
+  eeprom_write_start(EEPROM_ERRLOG_ADDR(eeprom_err_pos), &err, sizeof(eeprom_error_t));
+
+  if(eeprom_err_pending) {
+    eeprom_err_pending = 0;
+  } else {
+    eeprom_err_last = code;
+  }
+  eeprom_err_pos = (eeprom_err_pos + 1) % ERROR_LOG_ENTRIES;
+  eeprom_err_seq++;
+}
+
+/**
+ * Write an error to the error log without switching to error mode.
+ */
+void eeprom_error_log(uint8_t code) {
+  eeprom_err_pending = code;
+}
+
+/**
+ * Read an entry from the error log.
+ */
+uint8_t eeprom_error_read(uint8_t n, eeprom_error_t *err) {
+  if(n >= ERROR_LOG_ENTRIES) return 0;
+  // The EEPROM interrupt changes the address register, do not read while it is writing
+  if(eeprom_wr_idx < eeprom_wr_len) return EEPROM_ERROR_BUSY;
+  if(eeprom_err_pos < 0) eeprom_error_scan();
+
+  // Walk back from the newest entry; a valid entry with the wrong sequence number belongs to an older lap
+  const uint8_t entry = (eeprom_err_pos + 2 * ERROR_LOG_ENTRIES - 1 - n) % ERROR_LOG_ENTRIES;
+  return eeprom_read_error(entry, err) && err->seq == (uint8_t)(eeprom_err_seq - 1 - n);
+}
+
+/**
+ * EEPROM ready interrupt: writes the next byte of the queued record which differs from the EEPROM content.
+ * Each write takes about 3.3 ms after which this interrupt fires again; when the record is done the interrupt is disabled.
+ */
+ISR(EE_READY_vect) {
+  while(eeprom_wr_idx < eeprom_wr_len) {
+    const uint16_t addr = eeprom_wr_addr + eeprom_wr_idx;
+    const uint8_t  val  = eeprom_wr_buf[eeprom_wr_idx];
+    eeprom_wr_idx++;
+
+    // Read the current content, skip the byte when it already holds the right value
+    EEAR = addr;
+    EECR |= _BV(EERE);
+    if(EEDR != val) {
+      // Start an erase + write of this byte (EEPE has to be set within 4 cycles after EEMPE)
+      TRACE(TRACE_EEPROM_BYTE, addr);
+      EEDR = val;
+      EECR |= _BV(EEMPE);
+      EECR |= _BV(EEPE);
+      eeprom_bytes_written++;
+      return;
+    }
+  }
+
+  // Record or error log entry complete
+  TRACE(TRACE_EEPROM_DONE, eeprom_wr_addr);
+  EECR &= ~_BV(EERIE);
+}
+
+/**
+ * Get the settings struct from EEPROM. The newest record is found with a binary search on the sequence numbers so
+ * only a handful of records are read, regardless of the EEPROM size.
  */
 void eeprom_load() {
+  eeprom_record_t rec;
+  int16_t newest = -1;
+
   // Check the EEPROM before using it
   eeprom_check();
-  // Reset the position counter
-  eeprom_pos = 0;
-  
-  // Now scan for the previous position that held data
-  for(int o=0; o<NUM_SETTINGS; o++) {
-    // Get the struct at this EEPROM position
-    EEPROM.get(4+o*4, eeprom_settings);
-    
-    if(eeprom_settings.carrot == 42) {
-      // Debug output
-      //EEPROM_SERPRINT(F("EEPROM load pos "));
-      EEPROM_SERPRINT("EEPROM load pos ");
-      EEPROM_SERPRINTLN(o);
-      // Record the position for the next store
-      eeprom_pos = (o+1) % NUM_SETTINGS;
-      break;
+
+  if(eeprom_read_record(0, &rec)) {
+    // Binary search for the last slot written in the current lap: slot 'lo' is always part of the lap, 'hi' never is
+    const uint16_t seq0 = rec.seq;
+    int16_t lo = 0, hi = NUM_SETTINGS;
+    while(hi - lo > 1) {
+      int16_t mid = (lo + hi) / 2;
+      eeprom_record_t m;
+      if(eeprom_read_record(mid, &m) && (uint16_t)(m.seq - seq0) == (uint16_t)mid) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
     }
+    newest = lo;
+  } else if(eeprom_read_record(NUM_SETTINGS - 1, &rec)) {
+    // Slot 0 is not valid but the last slot is: power was lost while wrapping around, the last slot is the newest
+    newest = NUM_SETTINGS - 1;
   }
-  
-  // See if the settings are valid
-  if(eeprom_settings.carrot != 42) {
+
+  if(newest < 0) {
     // No valid settings found - loading defaults
     EEPROM_SERPRINTLN(F("EEPROM loading defaults"));
     // Set store pointer to start
     eeprom_pos = 0;
+    eeprom_seq = 0;
     // Set defaults, all zeros is fine
     eeprom_settings = {};
+    // Nothing valid in the EEPROM, make sure the first store is written
+    memset(&eeprom_committed, 0xFF, sizeof(eeprom_settings_t));
   } else {
+    // Fetch the newest record (the search might have ended on a different slot)
+    eeprom_read_record(newest, &rec);
+    eeprom_settings = rec.settings;
+    eeprom_committed = rec.settings;
+    // Record the position and sequence number for the next store
+    eeprom_pos = (newest + 1) % NUM_SETTINGS;
+    eeprom_seq = rec.seq + 1;
+
     EEPROM_SERPRINT("EEPROM loaded (ani, demo, brightness, next pos): ");
     EEPROM_SERPRINT(eeprom_settings.animation_id);
     EEPROM_SERPRINT(" ");
@@ -150,6 +379,7 @@ void eeprom_load() {
     EEPROM_SERPRINT(" ");
     EEPROM_SERPRINTLN(eeprom_pos); 
   }
+  eeprom_dirty = 0;
   
   // Sanity checking
   if(eeprom_settings.animation_id >= NUM_ANIMATIONS) {
@@ -162,7 +392,7 @@ void eeprom_load() {
     EEPROM_SERPRINTLN(eeprom_settings.demo_mode);
     eeprom_settings.demo_mode = 0;
   }
-  if(eeprom_settings.brightness > 5) {
+  if(eeprom_settings.brightness >= NUM_BRIGHTNESS_LEVELS) {
     //SERPRINTLN(F("EEPROM invalid brightness "));
     EEPROM_SERPRINTLN(eeprom_settings.brightness);
     eeprom_settings.brightness = 0;
@@ -173,7 +403,10 @@ void eeprom_load() {
 // *** No EEPROM support ***
 
 // Dummy settings struct
-eeprom_settings_t eeprom_settings = {.animation_id = 0, .demo_mode = 1, .brightness = 0, .carrot = 42};
+eeprom_settings_t eeprom_settings = {.animation_id = 0, .demo_mode = 1, .brightness = 0};
+
+volatile uint16_t eeprom_writes_avoided = 0;
+volatile uint32_t eeprom_bytes_written  = 0;
 
 void eeprom_check() {}
 
@@ -183,12 +416,33 @@ void eeprom_check() {}
 void eeprom_init() {}
 
 /**
- * Store the settings struct into EEPROM. Note that the location is changed every time to do wear levelling.
+ * Queue the settings struct for storing into EEPROM.
  */
 void eeprom_store() {}
 
 /**
- * Get the settings struct from EEPROM. Because of the wear levelling we have to search for its location so only do this on boot-up.
+ * Background task for the main loop: starts writing queued settings when they have been stable long enough.
+ */
+void eeprom_service() {}
+
+/**
+ * Background task for the main loop: append raised errors to the error log in EEPROM.
+ */
+void eeprom_error_service(uint8_t /* animation_id */) {}
+
+/**
+ * Write an error to the error log without switching to error mode.
+ */
+void eeprom_error_log(uint8_t /* code */) {}
+
+/**
+ * Read an entry from the error log; there is no log without EEPROM support.
+ */
+uint8_t eeprom_error_read(uint8_t /* n */, eeprom_error_t * /* err */) { return 0; }
+
+/**
+ * Get the settings struct from EEPROM. The newest record is found with a binary search on the sequence numbers so
+ * only a handful of records are read, regardless of the EEPROM size.
  */
 void eeprom_load() {}
 
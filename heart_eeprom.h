@@ -14,13 +14,30 @@
 typedef struct {
   uint8_t animation_id; // Last active animation ID
   uint8_t demo_mode;    // Demo mode level: 0 = off, manually cycle through animations, >0 automatically change where higher numbers indicate wait time multipliers, max: 5
-  uint8_t brightness;   // Value 0-5
-  uint8_t carrot;       // Always 42, when something else the data is not valid
+  uint8_t brightness;   // Value 0 to NUM_BRIGHTNESS_LEVELS - 1
 } __attribute__ ((packed)) eeprom_settings_t;
 
+typedef struct {
+  uint16_t          seq;      // Sequence number, incremented on every store: the record with the highest number is the newest
+  eeprom_settings_t settings; // Settings stored in this record
+  uint8_t           check;    // Checksum over the sequence number and the settings, when it does not match the record is not valid
+} __attribute__ ((packed)) eeprom_record_t;
+
+typedef struct {
+  uint8_t  seq;          // Sequence number, incremented for every logged error: used to find the newest entry
+  uint8_t  code;         // Error code (ERR_*)
+  uint8_t  animation_id; // Animation which was running when the error was logged
+  uint32_t uptime_ms;    // Time since boot when the error was logged
+  uint8_t  check;        // Checksum over the other fields, when it does not match the entry is not valid
+} __attribute__ ((packed)) eeprom_error_t;
+
 // Expose the EEPROM settings for use elsewhere
 extern eeprom_settings_t eeprom_settings;
 
+// Statistics of the write-behind cache; read with interrupts disabled as the EEPROM interrupt updates them
+extern volatile uint16_t eeprom_writes_avoided; // Number of stores that did not result in a write (unchanged or combined with a later store)
+extern volatile uint32_t eeprom_bytes_written;  // Number of bytes physically written to the EEPROM
+
 #define BUILD_BUG_ON(condition) ((void)sizeof(char[1 - 2*!!(condition)]))
 
 /**
@@ -34,12 +51,47 @@ void eeprom_check();
 void eeprom_init();
 
 /**
- * Store the settings struct into EEPROM. Note that the location is changed every time to do wear levelling.
+ * Queue the settings struct for storing into EEPROM. Returns immediately; the write is done in the background by
+ * eeprom_service() once the settings have been stable for EEPROM_COMMIT_DELAY_MS.
+ * Note that the location is changed every time to do wear levelling.
  */
 void eeprom_store();
 
 /**
- * Get the settings struct from EEPROM. Because of the wear levelling we have to search for its location so only do this on boot-up.
+ * Background task for the main loop: starts writing queued settings when they have been stable long enough.
+ * The record is streamed to the EEPROM one byte at a time by the EEPROM ready interrupt.
+ */
+void eeprom_service();
+
+/**
+ * Background task for the main loop: when an error is raised (_err is set), append it to the error log in EEPROM so it
+ * survives a reset. Every error code is logged once per boot; the entry is written in the background like the settings.
+ * @param animation_id Animation which is currently running
+ */
+void eeprom_error_service(uint8_t animation_id);
+
+/**
+ * Write an error to the error log without switching to error mode, for example the cause of the last reset. The entry is
+ * written by eeprom_error_service(), before any error raised through _err.
+ * @param code Error code (ERR_*)
+ */
+void eeprom_error_log(uint8_t code);
+
+// eeprom_error_read() result while a background write is running; try again on a later call
+#define EEPROM_ERROR_BUSY 2
+
+/**
+ * Read an entry from the error log.
+ * @param n   Entry to read, 0 is the newest, ERROR_LOG_ENTRIES - 1 the oldest
+ * @param err Entry read
+ * @return 1 when the entry is valid, 0 when there are less than n + 1 errors logged, EEPROM_ERROR_BUSY while the
+ *         EEPROM is being written
+ */
+uint8_t eeprom_error_read(uint8_t n, eeprom_error_t *err);
+
+/**
+ * Get the settings struct from EEPROM. The newest record is found with a binary search on the sequence numbers so
+ * only a handful of records are read, regardless of the EEPROM size.
  */
 void eeprom_load();
 
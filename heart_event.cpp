@@ -0,0 +1,165 @@
+/**
+ * heart_event.cpp - Heart PCB Project - Events from the ISR to the main loop and the button gestures built from them
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.07
+ * @license GNUGPLv3
+ */
+
+#include "heart_event.h"
+#include "heart_isr.h"
+#include "heart_delay.h"
+
+volatile event_t _event_queue [EVENT_QUEUE_SIZE];
+volatile uint8_t _event_head = 0;
+volatile uint8_t _event_tail = 0;
+volatile uint8_t event_dropped = 0;
+
+volatile uint8_t btn0_hold = 0;
+volatile uint8_t button_hold_level = 0;
+
+uint32_t event_latency_us = 0;
+uint32_t event_latency_max_us = 0;
+
+#define EVENT_BUTTONS 2
+
+uint8_t  event_down = 0;                        // Bit per button which is down
+uint8_t  event_level [EVENT_BUTTONS];           // Hold level per button, 0 until the hold is detected
+uint32_t event_press_us [EVENT_BUTTONS];        // Time of the last press per button
+uint32_t event_click_us [EVENT_BUTTONS];        // Time of the last click which may start a double click
+uint8_t  event_click_valid = 0;                 // Bit per button with a click in event_click_us
+
+/**
+ * Record the time from the event in the ISR until now, when its action is done
+ */
+static void event_latency(uint32_t time_us) {
+  event_latency_us = heart_micros() - time_us;
+  if(event_latency_us > event_latency_max_us) event_latency_max_us = event_latency_us;
+}
+
+/**
+ * Short press and release of a button
+ */
+static void event_click(uint8_t btn) {
+  if(btn == 0) {
+    // Next brightness level, effective from the next PWM period; after the dimmest level back to full brightness
+    if(GET_BRIGHTNESS_SCALE < NUM_BRIGHTNESS_LEVELS - 1) {
+      SET_BRIGHTNESS_SCALE(GET_BRIGHTNESS_SCALE + 1);
+    } else {
+      SET_BRIGHTNESS_SCALE(0);
+    }
+  }
+}
+
+/**
+ * A button was pressed for the first time; button 1 acts on the press instead of the click to switch quickly
+ */
+static void event_press(uint8_t btn) {
+  if(btn == 1) {
+    // Abort the current animation and make sure the demo mode starts anew with the next one
+    disable_heart_delay();
+    DEMO_RESTART();
+  }
+}
+
+/**
+ * Second press of a button within BUTTON_DOUBLE_MS of the first
+ */
+static void event_double(uint8_t btn) {
+  if(btn == 1) {
+    // Demo mode on (with the shortest duration) or off
+    demo_mode = demo_mode ? 0 : 1;
+    DEMO_RESTART();
+  }
+}
+
+/**
+ * A button is held down; called once for every level
+ */
+static void event_hold(uint8_t btn, uint8_t level) {
+  if(btn == 0) {
+    button_hold_level = level;
+    if(level == 1) {
+      // Return control to the main loop, which starts the demo mode configuration while the button stays down
+      btn0_hold = 1;
+      disable_heart_delay();
+    }
+  }
+}
+
+/**
+ * Turn one event from the ISR into gestures
+ */
+static void event_handle(uint8_t type, uint8_t btn, uint32_t time_us) {
+  const uint8_t mask = 1 << btn;
+
+  TRACE(TRACE_EVENT, (type << 8) | btn);
+  switch(type) {
+    case EVENT_PRESS:
+      event_down |= mask;
+      event_level[btn] = 0;
+      event_press_us[btn] = time_us;
+      if((event_click_valid & mask) && time_us - event_click_us[btn] < BUTTON_DOUBLE_MS * 1000UL) {
+        event_click_valid &= ~mask;
+        event_double(btn);
+      } else {
+        event_click_valid |= mask;
+        event_click_us[btn] = time_us;
+        event_press(btn);
+      }
+      event_latency(time_us);
+      break;
+
+    case EVENT_RELEASE:
+      event_down &= ~mask;
+      if(event_level[btn] == 0) {
+        event_click(btn);
+        event_latency(time_us);
+      } else {
+        // End of a hold, which can not be part of a double click
+        event_click_valid &= ~mask;
+        if(btn == 0) {
+          btn0_hold = 0;
+          button_hold_level = 0;
+        }
+      }
+      event_level[btn] = 0;
+      break;
+
+    case EVENT_DEMO:
+      disable_heart_delay();
+      event_latency(time_us);
+      break;
+  }
+}
+
+/**
+ * Background task for the main loop: handles the queued events and recognises the button gestures.
+ */
+void event_service() {
+  while(_event_tail != _event_head) {
+    const uint8_t tail = _event_tail;
+    const uint8_t type = _event_queue[tail].type;
+    const uint8_t arg = _event_queue[tail].arg;
+    const uint32_t time_us = _event_queue[tail].time_us;
+    // Only hand the entry back to the ISR after it is copied
+    barrier();
+    _event_tail = (tail + 1) & (EVENT_QUEUE_SIZE - 1);
+    event_handle(type, arg, time_us);
+  }
+
+  // Hold levels of the buttons which are down: the first after BUTTON_HOLD_MS, then one every BUTTON_HOLD_STEP_MS
+  if(!event_down) return;
+  const uint32_t now = heart_micros();
+  for(uint8_t btn = 0; btn < EVENT_BUTTONS; btn++) {
+    if(!(event_down & (1 << btn))) continue;
+    const uint32_t held_ms = (now - event_press_us[btn]) / 1000;
+    if(held_ms < BUTTON_HOLD_MS) continue;
+    const uint32_t level = 1 + (held_ms - BUTTON_HOLD_MS) / BUTTON_HOLD_STEP_MS;
+    if(level > event_level[btn] && event_level[btn] < 255) {
+      event_level[btn]++;
+      event_hold(btn, event_level[btn]);
+    }
+  }
+}
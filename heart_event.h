@@ -0,0 +1,82 @@
+/**
+ * heart_event.h - Heart PCB Project - Events from the ISR to the main loop and the button gestures built from them
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.07
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_EVENT_H_
+#define _HEART_EVENT_H_
+
+#include "heart_settings.h"
+#include "heart_time.h"
+#include "heart_trace.h"
+
+/**
+ * The ISR only samples and debounces the buttons and counts the demo mode timer; what happened is put in a queue with
+ * the time it happened. event_service() takes the events from the queue in the main loop and turns them into gestures:
+ *   button 0 click        - next brightness level
+ *   button 0 hold         - configure the demo mode; the hold level goes up every BUTTON_HOLD_STEP_MS
+ *   button 1 click        - next animation
+ *   button 1 double click - demo mode on or off
+ *   demo timeout          - next animation
+ *
+ * The queue has a single writer (the ISR, which owns _event_head) and a single reader (the main loop, which owns
+ * _event_tail), so neither side needs to disable the interrupts. When the queue is full new events are dropped and
+ * counted in event_dropped.
+ */
+
+// Event types in the queue
+#define EVENT_PRESS   0 // Button (arg) went down
+#define EVENT_RELEASE 1 // Button (arg) went up
+#define EVENT_DEMO    2 // Demo mode duration expired
+
+typedef struct {
+  uint8_t  type;    // EVENT_*
+  uint8_t  arg;     // Button number
+  uint32_t time_us; // heart_micros() when the ISR detected the event
+} event_t;
+
+extern volatile event_t _event_queue [EVENT_QUEUE_SIZE];
+extern volatile uint8_t _event_head; // Next entry the ISR writes
+extern volatile uint8_t _event_tail; // Next entry the main loop reads
+
+// Number of events lost because the queue was full
+extern volatile uint8_t event_dropped;
+
+// Flag to indicate button 0 is held down; set and cleared by event_service()
+extern volatile uint8_t btn0_hold;
+
+// Hold level of button 0: 1 when the hold is detected, one higher every BUTTON_HOLD_STEP_MS; 0 when not held
+extern volatile uint8_t button_hold_level;
+
+// Time in us from an event in the ISR until the main loop acted on it: the last one and the longest since boot
+extern uint32_t event_latency_us;
+extern uint32_t event_latency_max_us;
+
+/**
+ * Put an event in the queue; only call this from the ISR
+ */
+static inline void event_push(uint8_t type, uint8_t arg) {
+  const uint8_t head = _event_head;
+  const uint8_t next = (head + 1) & (EVENT_QUEUE_SIZE - 1);
+  if(next == _event_tail) {
+    if(event_dropped < 255) event_dropped++;
+    return;
+  }
+  _event_queue[head].type = type;
+  _event_queue[head].arg = arg;
+  _event_queue[head].time_us = heart_micros();
+  TRACE(TRACE_BUTTON, (type << 8) | arg);
+  // The entry has to be complete before the main loop can see it
+  barrier();
+  _event_head = next;
+}
+
+/**
+ * Background task for the main loop: handles the queued events and recognises the button gestures.
+ */
+void event_service();
+
+#endif
\ No newline at end of file
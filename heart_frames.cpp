@@ -0,0 +1,94 @@
+/**
+ * heart_frames.cpp - Heart PCB Project - Playback of recorded frame sequences, delta and run length coded in flash
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.11
+ * @license GNUGPLv3
+ */
+
+#include "heart_frames.h"
+#include "heart_isr.h"
+#include "heart_time.h"
+#include <avr/pgmspace.h>
+
+uint16_t frames_decode_us_max = 0;
+
+const uint8_t *frames_pos = NULL;     // Next code in flash
+uint16_t       frames_left = 0;       // Frames left in the sequence
+uint8_t        frames_channels = 0;   // Channels per frame
+uint8_t        frames_ms = 0;         // Frame interval
+
+/**
+ * Start playing a sequence in flash
+ * @return 1 when the sequence is valid for this heart, 0 when it has more channels than there are LEDs
+ */
+uint8_t frames_start(const uint8_t *seq) {
+  frames_channels = pgm_read_byte(seq);
+  frames_ms = pgm_read_byte(seq + 1);
+  frames_left = pgm_read_word(seq + 2);
+  frames_pos = seq + FRAMES_HEADER_SIZE;
+  if(frames_channels > NUM_LEDS) {
+    frames_left = 0;
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * Frame interval of the sequence being played in ms
+ */
+uint8_t frames_interval_ms() {
+  return frames_ms;
+}
+
+/**
+ * Decode the next frame into the LED brightness
+ * @return 1 when a frame was shown, 0 at the end of the sequence
+ */
+uint8_t frames_next() {
+  if(frames_left == 0) return 0;
+  const uint32_t start = heart_micros();
+  const uint8_t *p = frames_pos;
+  const uint8_t channels = frames_channels;
+  uint8_t l = 0;
+
+  while(l < channels) {
+    const uint8_t code = pgm_read_byte(p++);
+    uint8_t n = (code & 0x3F) + 1;
+    switch(code & 0xC0) {
+      case FRAMES_OP_SKIP:
+        l += n;
+        break;
+      case FRAMES_OP_DELTA:
+        // Sign extend the 6 bit delta; the brightness wraps like the encoder computed it
+        SET_LED_BRIGHTNESS_MAJOR(l, GET_LED_BRIGHTNESS(l).major + ((int8_t)(code << 2) >> 2));
+        l++;
+        break;
+      case FRAMES_OP_RUN: {
+        const uint8_t v = pgm_read_byte(p++);
+        for(; n && l < channels; n--, l++) SET_LED_BRIGHTNESS_MAJOR(l, v);
+        break;
+      }
+      default:
+        n = (code & 0x1F) + 1;
+        if((code & FRAMES_OP_NIBBLES) == FRAMES_OP_NIBBLES) {
+          uint8_t b = 0;
+          for(uint8_t k = 0; n && l < channels; k++, n--, l++) {
+            if(!(k & 1)) b = pgm_read_byte(p++);
+            const int8_t d = (k & 1) ? (int8_t)(b << 4) >> 4 : (int8_t)b >> 4;
+            SET_LED_BRIGHTNESS_MAJOR(l, GET_LED_BRIGHTNESS(l).major + d);
+          }
+        } else {
+          for(; n && l < channels; n--, l++) SET_LED_BRIGHTNESS_MAJOR(l, pgm_read_byte(p++));
+        }
+        break;
+    }
+  }
+
+  frames_pos = p;
+  frames_left--;
+  const uint32_t dur = heart_micros() - start;
+  if(dur > frames_decode_us_max) frames_decode_us_max = dur;
+  return 1;
+}
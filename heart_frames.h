@@ -0,0 +1,60 @@
+/**
+ * heart_frames.h - Heart PCB Project - Playback of recorded frame sequences, delta and run length coded in flash
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.11
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_FRAMES_H_
+#define _HEART_FRAMES_H_
+
+#include "heart_settings.h"
+
+/**
+ * A sequence is a recorded animation: a frame holds the brightness of every channel (LED group). Stored as is, 10 bytes
+ * a frame at 40 frames per second would fill the flash in seconds, so every frame is coded against the previous one,
+ * which is the brightness the LEDs show: the decoder needs no buffer and only keeps its place in the sequence.
+ *
+ * A sequence starts with a header of 4 bytes: the number of channels, the frame interval in ms and the number of
+ * frames (16 bits, LSB first). Each frame then is a list of codes which together cover all channels, in order:
+ *   00nnnnnn          - the next n + 1 channels are unchanged
+ *   01dddddd          - add d (-32 to 31) to the next channel
+ *   10nnnnnn v        - the next n + 1 channels get brightness v
+ *   110nnnnn v0 .. vn - the next n + 1 channels get brightness v0 to vn
+ *   111nnnnn d0d1 ..  - add d0 to dn (-8 to 7, 4 bits each, the first in the high nibble) to the next n + 1 channels
+ * An unchanged frame takes a single byte and a slow fade on all 10 channels 6 bytes. The first frame is a key frame without
+ * deltas, so a sequence can start (and loop) whatever the LEDs showed before. The brightness wraps around at 255.
+ *
+ * Sequences are made from a CSV file with one frame per line by tools/frames_encode.py, which writes heart_frames_data.h.
+ */
+
+#define FRAMES_OP_SKIP    0x00
+#define FRAMES_OP_DELTA   0x40
+#define FRAMES_OP_RUN     0x80
+#define FRAMES_OP_LITERAL 0xC0
+#define FRAMES_OP_NIBBLES 0xE0
+
+#define FRAMES_HEADER_SIZE 4
+
+// Longest time in us frames_next() took to decode a frame
+extern uint16_t frames_decode_us_max;
+
+/**
+ * Start playing a sequence in flash
+ * @return 1 when the sequence is valid for this heart, 0 when it has more channels than there are LEDs
+ */
+uint8_t frames_start(const uint8_t *seq);
+
+/**
+ * Frame interval of the sequence being played in ms
+ */
+uint8_t frames_interval_ms();
+
+/**
+ * Decode the next frame into the LED brightness
+ * @return 1 when a frame was shown, 0 at the end of the sequence
+ */
+uint8_t frames_next();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+ * heart_frames_data.h - Heart PCB Project - Recorded frame sequences, see heart_frames.h
+ * 
+ * Generated by tools/frames_encode.py from comet.csv, sparkle.csv; do not edit
+ *
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_FRAMES_DATA_H_
+#define _HEART_FRAMES_DATA_H_
+
+#include <avr/pgmspace.h>
+
+// comet.csv: 64 frames of 10 channels at 25 ms, 474 bytes instead of 640
+static const uint8_t FRAMES_COMET [474] PROGMEM = {
+  0x0A, 0x19, 0x40, 0x00, 0x80, 0xFF, 0x84, 0x00, 0xC3, 0x02, 0x06, 0x15, 0x4A, 0xC1, 0xD7, 0x28, 0x03, 0x7F, 0x7F, 0x7C, 0x73, 0xC1, 0xB0, 0x50,
+  0x04, 0x7F, 0x7D, 0x75, 0x61, 0x80, 0x78, 0x04, 0x7F, 0x7D, 0x77, 0x66, 0x80, 0x9F, 0x05, 0x7E, 0x78, 0x6A, 0x80, 0xC7, 0x04, 0x7F, 0x7F, 0x7A,
+  0x6F, 0x80, 0xEF, 0x03, 0xE3, 0xF0, 0xEB, 0x71, 0x78, 0x58, 0x03, 0x7F, 0x7F, 0x7C, 0x75, 0xC1, 0xBF, 0x40, 0x04, 0x7F, 0x7D, 0x76, 0xC1, 0x9D,
+  0x68, 0x04, 0x7F, 0x7D, 0x78, 0x64, 0x80, 0x8F, 0x05, 0x7E, 0x7A, 0x68, 0x80, 0xB7, 0x04, 0x7F, 0x7E, 0x7A, 0x6D, 0x80, 0xDF, 0x05, 0x7F, 0x7C,
+  0x71, 0x58, 0x48, 0x02, 0x7F, 0x00, 0x7F, 0x7C, 0x73, 0xC1, 0xCF, 0x30, 0x03, 0x7F, 0x7F, 0x7D, 0x76, 0xC1, 0xAA, 0x58, 0x04, 0x7F, 0x7E, 0x77,
+  0x61, 0x80, 0x80, 0x04, 0x7F, 0x7E, 0x79, 0x67, 0x80, 0xA7, 0x05, 0x7E, 0x7A, 0x6C, 0x80, 0xCF, 0x04, 0x7F, 0x7F, 0x7C, 0x6F, 0x80, 0xF7, 0x03,
+  0x7F, 0x00, 0x7F, 0x7C, 0x72, 0x68, 0x80, 0x20, 0x03, 0x7F, 0x7F, 0x7C, 0x75, 0xC1, 0xB7, 0x48, 0x04, 0x7F, 0x7E, 0x76, 0xC1, 0x96, 0x70, 0x04,
+  0x00, 0x7E, 0x79, 0x65, 0x80, 0x97, 0x04, 0x7F, 0x7E, 0x79, 0x6A, 0x80, 0xBF, 0x04, 0x00, 0x7F, 0x7B, 0x6E, 0x80, 0xE7, 0x04, 0x00, 0x7E, 0x7C,
+  0x71, 0x48, 0x50, 0x02, 0x7F, 0x7F, 0x7F, 0x7D, 0x74, 0xC1, 0xC7, 0x38, 0x03, 0x01, 0x7D, 0x76, 0xC1, 0xA3, 0x60, 0x03, 0x00, 0x7F, 0x7E, 0x77,
+  0x63, 0x80, 0x87, 0x03, 0xE3, 0x0F, 0xEA, 0x68, 0x80, 0xAF, 0x03, 0x01, 0x7E, 0x7A, 0x6C, 0x80, 0xD7, 0x03, 0xE3, 0xF0, 0xFC, 0x70, 0x80, 0xFF,
+  0x03, 0xE3, 0x0F, 0xFC, 0x73, 0xC1, 0xD7, 0x28, 0x02, 0x01, 0x7F, 0x7D, 0x75, 0xC1, 0xB0, 0x50, 0x02, 0x01, 0x7F, 0x7D, 0x77, 0x61, 0x80, 0x78,
+  0x02, 0x02, 0x7E, 0x78, 0x66, 0x80, 0x9F, 0x02, 0x01, 0x7F, 0x7F, 0x7A, 0x6A, 0x80, 0xC7, 0x02, 0x00, 0xE3, 0xF0, 0xEB, 0x6F, 0x80, 0xEF, 0x02,
+  0x01, 0x7F, 0x7F, 0x7C, 0x71, 0x78, 0x58, 0x01, 0x02, 0x7F, 0x7D, 0x75, 0xC1, 0xBF, 0x40, 0x01, 0x02, 0x7F, 0x7D, 0x76, 0xC1, 0x9D, 0x68, 0x01,
+  0x03, 0x7E, 0x78, 0x64, 0x80, 0x8F, 0x01, 0x02, 0x7F, 0x7E, 0x7A, 0x68, 0x80, 0xB7, 0x01, 0x03, 0x7F, 0x7A, 0x6D, 0x80, 0xDF, 0x01, 0x01, 0xE3,
+  0xF0, 0xFC, 0x71, 0x58, 0x48, 0x00, 0x02, 0x7F, 0x7F, 0x7C, 0x73, 0xC1, 0xCF, 0x30, 0x00, 0x03, 0x7F, 0x7D, 0x76, 0xC1, 0xAA, 0x58, 0x00, 0x03,
+  0x7F, 0x7E, 0x77, 0x61, 0x80, 0x80, 0x00, 0x04, 0x7E, 0x79, 0x67, 0x80, 0xA7, 0x00, 0x03, 0x7F, 0x7E, 0x7A, 0x6C, 0x80, 0xCF, 0x00, 0x02, 0xE3,
+  0xF0, 0xFC, 0x6F, 0x80, 0xF7, 0x00, 0x03, 0x7F, 0x7F, 0x7C, 0x72, 0x68, 0x80, 0x20, 0x04, 0x7F, 0x7C, 0x75, 0xC1, 0xB7, 0x48, 0x04, 0x7F, 0x7E,
+  0x76, 0xC1, 0x96, 0x70, 0x05, 0x7E, 0x79, 0x65, 0x80, 0x97, 0x04, 0x7F, 0x7E, 0x79, 0x6A, 0x80, 0xBF, 0x05, 0x7F, 0x7B, 0x6E, 0x80, 0xE7, 0x50,
+  0x02, 0xE3, 0xF0, 0xEC, 0x71, 0x48, 0x80, 0x38, 0x03, 0x7F, 0x7F, 0x7D, 0x74, 0x80, 0xC7, 0x80, 0x60, 0x05, 0x7D, 0x76, 0x80, 0xA3, 0x80, 0x87,
+  0x04, 0x7F, 0x7E, 0x77, 0x63, 0x80, 0xAF, 0x04, 0x7F, 0x7E, 0x7A, 0x68, 0x80, 0xD7, 0x05, 0x7E, 0x7A, 0x6C,
+};
+
+// sparkle.csv: 160 frames of 10 channels at 25 ms, 896 bytes instead of 1600
+static const uint8_t FRAMES_SPARKLE [896] PROGMEM = {
+  0x0A, 0x19, 0xA0, 0x00, 0xC5, 0x71, 0x0C, 0x0C, 0x10, 0x0C, 0xD9, 0x82, 0x0C, 0x80, 0x2B, 0x6F, 0x01, 0x7E, 0x00, 0x80, 0xB8, 0x02, 0x79, 0x72,
+  0x83, 0x0C, 0x65, 0x02, 0x7B, 0x73, 0x03, 0x68, 0x02, 0x7B, 0x76, 0x03, 0x6C, 0x02, 0x7C, 0x77, 0x03, 0x6F, 0x02, 0x7D, 0x79, 0x41, 0x80, 0xD9,
+  0x41, 0x41, 0x72, 0xE3, 0x11, 0x1D, 0x79, 0x00, 0x80, 0xB8, 0x01, 0x73, 0x02, 0x7E, 0x7B, 0x00, 0x65, 0x01, 0x76, 0x02, 0x7F, 0x7B, 0x00, 0x68,
+  0x01, 0x77, 0x03, 0x7C, 0x41, 0x6C, 0x41, 0x41, 0x79, 0x83, 0x0E, 0x7D, 0x00, 0x6F, 0x01, 0x79, 0x03, 0x7D, 0x00, 0x72, 0x01, 0x7B, 0x80, 0xD9,
+  0x02, 0x7F, 0x41, 0x73, 0x41, 0x41, 0x7B, 0x80, 0xB8, 0x82, 0x0F, 0x01, 0x76, 0x01, 0x7C, 0x65, 0x02, 0x01, 0x77, 0x01, 0x7D, 0x68, 0x02, 0xE5,
+  0x11, 0x91, 0x1D, 0x6C, 0x82, 0x10, 0x01, 0x79, 0x02, 0x6F, 0x02, 0x80, 0xD9, 0x41, 0x7B, 0x82, 0x11, 0x72, 0x82, 0x11, 0x80, 0xB8, 0x00, 0x7B,
+  0x02, 0x73, 0x02, 0x65, 0x41, 0x7C, 0x82, 0x12, 0x76, 0x82, 0x12, 0x68, 0x00, 0x7D, 0x02, 0x77, 0x02, 0x6C, 0x84, 0x13, 0x79, 0x82, 0x13, 0x6F,
+  0x84, 0x14, 0x79, 0x82, 0x14, 0x72, 0x80, 0xD9, 0x03, 0x7B, 0x02, 0x73, 0x80, 0xB8, 0xE7, 0x11, 0x11, 0xB1, 0x11, 0x76, 0x65, 0x87, 0x16, 0x77,
+  0x68, 0x07, 0x79, 0x6C, 0x87, 0x17, 0x79, 0x6F, 0x87, 0x18, 0x7B, 0x72, 0x05, 0x80, 0xD9, 0x00, 0x7B, 0x73, 0x85, 0x19, 0x80, 0xB8, 0x41, 0x00,
+  0x76, 0x85, 0x1A, 0x65, 0x41, 0x41, 0x77, 0x85, 0x1B, 0x68, 0x41, 0x00, 0x79, 0x05, 0x6C, 0x00, 0x41, 0x79, 0x85, 0x1C, 0x6F, 0x41, 0x41, 0x80,
+  0xD9, 0x85, 0x1D, 0x72, 0x41, 0x41, 0x80, 0xB8, 0x85, 0x1E, 0x73, 0x41, 0x00, 0x65, 0x05, 0x76, 0x00, 0x41, 0x68, 0x85, 0x1F, 0x77, 0x41, 0x41,
+  0x6C, 0x85, 0x20, 0x79, 0x41, 0x41, 0x6F, 0x85, 0x21, 0x79, 0x41, 0x41, 0x72, 0x82, 0x22, 0x80, 0xD9, 0x83, 0x22, 0x00, 0x73, 0x02, 0x80, 0xB8,
+  0x03, 0x41, 0x76, 0x82, 0x23, 0x65, 0x83, 0x23, 0x41, 0x77, 0x82, 0x24, 0x68, 0x83, 0x24, 0x41, 0x79, 0x82, 0x25, 0x6C, 0x83, 0x25, 0x84, 0x25,
+  0x6F, 0x03, 0x84, 0x26, 0x72, 0x82, 0x26, 0x80, 0xD9, 0x84, 0x27, 0x73, 0x82, 0x27, 0x80, 0xB8, 0x84, 0x28, 0x76, 0x82, 0x28, 0x65, 0x04, 0x77,
+  0x02, 0x68, 0x84, 0x29, 0x79, 0x82, 0x29, 0x6C, 0x88, 0x2A, 0x6F, 0x80, 0xD9, 0x07, 0x72, 0x80, 0xB8, 0x87, 0x2B, 0x73, 0x65, 0x87, 0x2C, 0x76,
+  0x68, 0x07, 0x77, 0x6C, 0x88, 0x2D, 0x6F, 0x88, 0x2E, 0x72, 0x06, 0x80, 0xD9, 0x00, 0x73, 0x86, 0x2F, 0x80, 0xB8, 0x41, 0x76, 0x06, 0x65, 0x00,
+  0x77, 0x86, 0x30, 0x68, 0x41, 0x7E, 0x06, 0x6C, 0x00, 0x87, 0x31, 0x6F, 0x41, 0x02, 0x80, 0xD9, 0x03, 0x72, 0x00, 0x02, 0x80, 0xB8, 0x03, 0x73,
+  0x00, 0x82, 0x32, 0x65, 0x83, 0x32, 0x76, 0x41, 0x02, 0x68, 0x85, 0x32, 0x02, 0x6C, 0x05, 0x82, 0x33, 0x6F, 0x85, 0x33, 0x80, 0xD9, 0x01, 0x72,
+  0x05, 0x80, 0xB8, 0x01, 0x73, 0x05, 0x65, 0x01, 0x76, 0x05, 0x68, 0x88, 0x34, 0x6C, 0x08, 0x6F, 0x08, 0x72, 0x80, 0xD9, 0x07, 0x73, 0x80, 0xB8,
+  0x07, 0x76, 0x65, 0x07, 0x79, 0x68, 0x07, 0x00, 0x6C, 0x07, 0x00, 0x6F, 0x07, 0x00, 0x72, 0x03, 0x80, 0xD9, 0x02, 0x00, 0x73, 0x03, 0x80, 0xB8,
+  0x02, 0x7F, 0x76, 0x83, 0x33, 0x65, 0x82, 0x33, 0x85, 0x33, 0x68, 0x02, 0x05, 0x6C, 0x02, 0x05, 0x6F, 0x02, 0x85, 0x32, 0x80, 0xD9, 0x82, 0x32,
+  0x05, 0x80, 0xB8, 0x02, 0x05, 0x65, 0x02, 0x85, 0x31, 0x68, 0x82, 0x31, 0x05, 0x6C, 0x02, 0x05, 0x6F, 0x02, 0x7F, 0x80, 0xD9, 0x83, 0x30, 0x72,
+  0x82, 0x30, 0x00, 0x80, 0xB8, 0x03, 0x73, 0x02, 0x7F, 0x65, 0x83, 0x2F, 0x76, 0x82, 0x2F, 0x00, 0x68, 0x03, 0x77, 0x02, 0x7F, 0x6C, 0x87, 0x2E,
+  0x00, 0x6F, 0x07, 0x7F, 0x72, 0x7F, 0x80, 0xD9, 0x85, 0x2D, 0x7F, 0x73, 0x7F, 0x80, 0xB8, 0x85, 0x2C, 0x00, 0x76, 0x00, 0x65, 0x05, 0x7F, 0x77,
+  0x7F, 0x68, 0x85, 0x2B, 0x7F, 0x79, 0x7F, 0x6C, 0x85, 0x2A, 0x82, 0x2A, 0x6F, 0x05, 0x7F, 0x80, 0xD9, 0x7F, 0x72, 0x85, 0x29, 0x7F, 0x80, 0xB8,
+  0x7F, 0x73, 0x85, 0x28, 0x00, 0x65, 0x00, 0x76, 0x05, 0x7F, 0x68, 0x7F, 0x77, 0x85, 0x27, 0x7F, 0x6C, 0x7F, 0x79, 0x85, 0x26, 0x7F, 0x6F, 0x87,
+  0x25, 0x00, 0x72, 0x05, 0x80, 0xD9, 0x00, 0x7F, 0x73, 0x85, 0x24, 0x80, 0xB8, 0x7F, 0x7F, 0x76, 0x85, 0x23, 0x65, 0x7F, 0x7F, 0x77, 0x85, 0x22,
+  0x68, 0x7F, 0x00, 0x79, 0x05, 0x6C, 0x00, 0x7F, 0x79, 0x85, 0x21, 0x6F, 0x7F, 0x85, 0x20, 0x80, 0xD9, 0x7F, 0x72, 0x7F, 0x85, 0x1F, 0x80, 0xB8,
+  0x7F, 0x73, 0x7F, 0x85, 0x1E, 0x65, 0x7F, 0x76, 0x7F, 0x05, 0x68, 0x00, 0x77, 0x00, 0x85, 0x1D, 0x6C, 0x7F, 0x79, 0x7F, 0x85, 0x1C, 0x6F, 0x7F,
+  0x79, 0x7F, 0x80, 0xD9, 0x84, 0x1B, 0x72, 0x7F, 0x7B, 0x7F, 0x80, 0xB8, 0x04, 0x73, 0x82, 0x1B, 0x65, 0x84, 0x1A, 0x76, 0x82, 0x1A, 0x68, 0x84,
+  0x19, 0x77, 0x82, 0x19, 0x6C, 0x84, 0x18, 0x79, 0x82, 0x18, 0x6F, 0x04, 0x79, 0x02, 0x72, 0xE7, 0xFF, 0xFF, 0xFB, 0xFF, 0x80, 0xD9, 0x73, 0xE7,
+  0xFF, 0xFF, 0xFB, 0xFF, 0x80, 0xB8, 0x76, 0x87, 0x16, 0x65, 0x77, 0x87, 0x15, 0x68, 0x79, 0x87, 0x14, 0x6C, 0x79, 0x07, 0x6F, 0x7B, 0x80, 0xD9,
+  0x86, 0x13, 0x72, 0x7B, 0x80, 0xB8, 0x86, 0x12, 0x73, 0x7C, 0x65, 0x06, 0x76, 0x7D, 0x68, 0x86, 0x11, 0x77, 0x7E, 0x6C, 0x06, 0x79, 0x7F, 0x6F,
+  0x86, 0x10, 0x79, 0x00, 0x72, 0x00, 0x80, 0xD9, 0x04, 0x7B, 0x7F, 0x73, 0x7F, 0x80, 0xB8, 0x84, 0x0F, 0x7B, 0x00, 0x76, 0x00, 0x65, 0x04, 0x7C,
+  0x00, 0x77, 0x00, 0x68, 0x04, 0x7D, 0x7F, 0x79, 0x7F, 0x6C, 0x84, 0x0E, 0x7D, 0x00, 0x79, 0x00, 0x6F, 0x04, 0x7E, 0x00, 0x7B, 0x00, 0x72, 0x04,
+  0x80, 0xD9, 0x7F, 0x7B, 0x7F, 0x73, 0x84, 0x0D, 0x80, 0xB8, 0x00, 0x7C, 0x00, 0x76, 0x04, 0x65, 0x00, 0x7D, 0x00, 0x77, 0x04, 0x68, 0xE3, 0x0D,
+  0x09, 0x04, 0x6C, 0xE3, 0xFE, 0xF9, 0x84, 0x0C, 0x6F, 0x80, 0xD9, 0x7E, 0x00, 0x7B, 0x04, 0x72, 0x80, 0xB8, 0x01, 0x7B, 0x04, 0x73, 0x65, 0x01,
+  0x7C, 0x04, 0x76, 0x68, 0x01, 0x7D, 0x04, 0x77,
+};
+
+#define FRAMES_NUM_SEQUENCES 2
+#define FRAMES_SEQUENCES { FRAMES_COMET, FRAMES_SPARKLE }
+
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+/**
+ * heart_geometry.cpp - Heart PCB Project - Position of every LED group on the heart
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.08
+ * @license GNUGPLv3
+ */
+
+#include "heart_geometry.h"
+#include "heart_isr.h"
+
+#if NUM_LEDS < 10
+#error "The geometry table describes the 10 LED groups of the heart PCB"
+#endif
+
+const led_geometry_t led_geometry [NUM_LEDS] PROGMEM = {
+  //  x     y    r  ring layer
+  {    0, -127, 127,   0, 5 }, // Bottom tip
+  {  -24,  -89,  92,  26, 4 },
+  { -103,  -14, 104,  51, 3 },
+  { -103,   70, 125,  77, 2 },
+  {  -24,   78,  82, 102, 1 }, // Top of the left lobe
+  {    0,   37,  37, 128, 0 }, // Dip at the top centre
+  {   24,   78,  82, 154, 1 }, // Top of the right lobe
+  {  103,   70, 125, 179, 2 },
+  {  103,  -14, 104, 205, 3 },
+  {   24,  -89,  92, 230, 4 },
+  // Larger hearts on shift registers (see SUPPORT_SHIFT_OUT): describe the other channels here, until then they sit in
+  // the centre of the top layer
+};
+
+/**
+ * Fader mask (see FADER_BIT()) of the LED groups in a layer
+ */
+fader_mask_t geometry_layer_mask(uint8_t layer) {
+  fader_mask_t mask = 0;
+  for(uint8_t l=0; l < NUM_LEDS; l++) {
+    if(GEOMETRY_LAYER(l) == layer) mask |= FADER_BIT(l);
+  }
+  return mask;
+}
@@ -0,0 +1,49 @@
+/**
+ * heart_geometry.h - Heart PCB Project - Position of every LED group on the heart
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.08
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_GEOMETRY_H_
+#define _HEART_GEOMETRY_H_
+
+#include "heart_settings.h"
+#include "heart_isr.h"
+#include <avr/pgmspace.h>
+
+/**
+ * The LED groups sit on the outline of the heart, numbered along it: group 0 is the bottom tip, group 5 the dip at the
+ * top centre. The positions follow the classic heart curve with the groups evenly spaced along the outline, centred on
+ * the middle of the heart and scaled to -127..127; y points up.
+ *
+ * The layers follow the outline down on both sides, from the top centre to the bottom tip, as animate_dropfill() lets
+ * the drops fall: {5}, {4, 6}, {3, 7}, {2, 8}, {1, 9}, {0}.
+ */
+
+typedef struct {
+  int8_t  x;     // Horizontal position, -127 (left) to 127 (right)
+  int8_t  y;     // Vertical position, -127 (bottom) to 127 (top)
+  uint8_t r;     // Distance from the centre of the heart, 0 to 127
+  uint8_t ring;  // Position along the outline, 0 to 255 for one round starting at the bottom tip
+  uint8_t layer; // Layer from the top, 0 to GEOMETRY_LAYERS - 1
+} led_geometry_t;
+
+#define GEOMETRY_LAYERS 6
+
+extern const led_geometry_t led_geometry [NUM_LEDS] PROGMEM;
+
+// Read one field of the geometry of a LED group from flash
+#define GEOMETRY_X(__led)     ((int8_t)pgm_read_byte(&led_geometry[__led].x))
+#define GEOMETRY_Y(__led)     ((int8_t)pgm_read_byte(&led_geometry[__led].y))
+#define GEOMETRY_R(__led)     pgm_read_byte(&led_geometry[__led].r)
+#define GEOMETRY_RING(__led)  pgm_read_byte(&led_geometry[__led].ring)
+#define GEOMETRY_LAYER(__led) pgm_read_byte(&led_geometry[__led].layer)
+
+/**
+ * Fader mask (see FADER_BIT()) of the LED groups in a layer
+ */
+fader_mask_t geometry_layer_mask(uint8_t layer);
+
+#endif
\ No newline at end of file
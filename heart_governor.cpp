@@ -0,0 +1,115 @@
+/**
+ * heart_governor.cpp - Heart PCB Project - Run-time adaptation of the PWM frequency to the measured ISR load
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.01
+ * @license GNUGPLv3
+ */
+
+#include "heart_governor.h"
+#include "heart_isr.h"
+#include "heart_trace.h"
+#include "heart_time.h"
+
+volatile uint8_t  governor_interval_us = TIMER_INTERVAL_US;
+volatile uint16_t _fader_update_ticks  = FADER_UPDATE_TICKS;
+
+#ifdef SUPPORT_GOVERNOR
+#include "Arduino.h"
+#include "TimerOne.h"
+
+// Fader ticks for a timer interval, using the same formula as FADER_UPDATE_TICKS
+#define GOVERNOR_FADER_TICKS(__us) (( FADER_UPDATE_INTERVAL_US ) / ( (uint32_t)(__us) * 3) )
+
+// Timer1 runs at the CPU clock (TimerOne picks no prescaler for intervals this short)
+#define GOVERNOR_COUNTS_PER_US (F_CPU / 1000000UL)
+
+// After an overload, wait this many decisions before shortening the interval again; a missed tick shows up only after
+// the fact, so without this the governor would keep trying the interval which just failed
+#define GOVERNOR_HOLD_UPDATES 40
+
+volatile uint32_t _governor_busy = 0;
+
+uint8_t  governor_hold     = 0; // Decisions left before the interval may be shortened again
+uint32_t governor_last_ms  = 0; // Time of the last decision
+uint32_t governor_yield_ms = 0; // Time of the last call, to find the longest wait of the main loop
+uint16_t governor_gap_ms   = 0; // Longest wait of the main loop since the last decision
+uint16_t governor_missed   = 0; // Missed ticks at the last decision
+
+/**
+ * Change the timer interval and the fader interval along with it
+ */
+static void governor_set_interval(uint8_t us) {
+  const uint8_t sreg = SREG;
+  // The ISR reads ICR1 and uses the fader interval, change both at once
+  cli();
+  if(_pwm_tail_long) {
+    // The timer runs a long tick for the tail of a PWM period, changing ICR1 now would cut it short; retry next decision
+    SREG = sreg;
+    return;
+  }
+  Timer1.setPeriod(us);
+  governor_interval_us = us;
+  _fader_update_ticks = GOVERNOR_FADER_TICKS(us);
+  TRACE(TRACE_INTERVAL, us);
+  SREG = sreg;
+}
+
+/**
+ * Background task for the main loop: measures the load and adjusts the timer interval every GOVERNOR_UPDATE_MS.
+ */
+void governor_service() {
+  const uint32_t now = heart_millis();
+  const uint32_t dt = now - governor_last_ms;
+  const uint16_t gap = governor_yield_ms ? now - governor_yield_ms : 0; // The first call follows setup(), not a wait
+  uint32_t busy;
+  uint16_t missed;
+  uint8_t  sreg, load_pct, us;
+
+  governor_yield_ms = now;
+  if(gap > governor_gap_ms) governor_gap_ms = gap;
+  if(dt < GOVERNOR_UPDATE_MS) return;
+  governor_last_ms = now;
+
+  sreg = SREG;
+  cli();
+  busy = _governor_busy;
+  _governor_busy = 0;
+  missed = _isr_missed;
+  SREG = sreg;
+
+  // Never touch the timer in error mode, the interval might have been set to the error interval on purpose
+  if(_err) return;
+
+  // ISR load in percent of the CPU time during this window
+  load_pct = (busy / GOVERNOR_COUNTS_PER_US) * 100 / (dt * 1000);
+  us = governor_interval_us;
+
+  if(missed != governor_missed || load_pct > 100 - GOVERNOR_RESERVE_PCT || governor_gap_ms > GOVERNOR_MAX_GAP_MS) {
+    // Overloaded: slow down
+    if(us < GOVERNOR_MAX_INTERVAL_US) governor_set_interval(us + 1);
+    governor_hold = GOVERNOR_HOLD_UPDATES;
+  } else if(governor_hold) {
+    governor_hold--;
+  } else if(us > GOVERNOR_MIN_INTERVAL_US &&
+            (uint16_t)load_pct * us / (us - 1) < 100 - GOVERNOR_RESERVE_PCT - GOVERNOR_HYSTERESIS_PCT) {
+    // The load after shortening the interval is still well within the limit: speed up
+    governor_set_interval(us - 1);
+  }
+
+  governor_missed = missed;
+  governor_gap_ms = 0;
+}
+
+#else
+// *** No governor support ***
+
+volatile uint32_t _governor_busy = 0;
+
+/**
+ * Background task for the main loop: measures the load and adjusts the timer interval every GOVERNOR_UPDATE_MS.
+ */
+void governor_service() {}
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * heart_governor.h - Heart PCB Project - Run-time adaptation of the PWM frequency to the measured ISR load
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.01
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_GOVERNOR_H_
+#define _HEART_GOVERNOR_H_
+
+#include "heart_settings.h"
+
+/**
+ * The ISR measures how long each tick takes (see the deadline check at the end of heart_isr()) and adds it to
+ * _governor_busy. Every GOVERNOR_UPDATE_MS the governor compares the ISR load and the longest wait of the main loop with
+ * the limits and moves the timer interval by 1 us. As each tick takes roughly the same time regardless of the interval,
+ * the load after a change can be predicted before shortening the interval.
+ */
+
+// Current timer interval in us
+extern volatile uint8_t governor_interval_us;
+
+// Number of ticks between fader updates; follows the timer interval so the faders keep running at FADER_UPDATE_FREQ
+extern volatile uint16_t _fader_update_ticks;
+
+// Time spent in the ISR in Timer1 counts since the last governor decision
+extern volatile uint32_t _governor_busy;
+
+/**
+ * Background task for the main loop: measures the load and adjusts the timer interval every GOVERNOR_UPDATE_MS.
+ */
+void governor_service();
+
+#ifdef SUPPORT_GOVERNOR
+  // Add the duration of a tick to the measured ISR load
+  #define GOVERNOR_ACCOUNT(__counts) { _governor_busy += (__counts); }
+#else
+  #define GOVERNOR_ACCOUNT(__counts) {}
+#endif
+
+#endif
\ No newline at end of file
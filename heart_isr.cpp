@@ -10,7 +10,14 @@
 #include "heart_settings.h"
 #include "heart_isr.h"
 #include "heart_profiling.h"
-#include "heart_delay.h"
+#include "heart_stream.h"
+#include "heart_governor.h"
+#include "heart_clock.h"
+#include "heart_time.h"
+#include "heart_event.h"
+#include "heart_shift.h"
+#include "heart_load.h"
+#include "heart_trace.h"
 #include "Arduino.h"
 
 // Only support measuring inside the ISR when measuments in general are enabled
@@ -59,7 +66,7 @@
 #endif
 
 #define SOFT_PWM_LED(led_pin, led_brightness) {          \
-  if(_pwm_step >= led_brightness) {                      \
+  if(pwm_thr >= led_brightness) {                        \
     if(led_pin <= 7) {                                   \
       /* Pin in port D, turn on */                       \
       pin0_7 |= LED_MASKON_PORTD[led_pin - 2];           \
@@ -116,6 +123,10 @@ static const uint8_t LED_MASKOFF_PORTB [6] = {
   ~(0x1 << 3),   // LED 10 = pin 11
 };
 
+// Bit of a pin in PORTD (pin 0 to 7) or PORTB (pin 8 to 13), 0 when the pin is in the other port
+#define PIN_PORTD_MASK(__pin) (((__pin) <= 7) ? (0x1 << ((__pin) & 7)) : 0)
+#define PIN_PORTB_MASK(__pin) (((__pin) >= 8 && (__pin) <= 13) ? (0x1 << ((__pin) & 7)) : 0)
+
 static const uint8_t BTN0_MASK = 0x1 << (PIN_BTN0 - 8);
 static const uint8_t BTN1_MASK = 0x1 << (PIN_BTN1 - 8);
 
@@ -126,32 +137,101 @@ volatile uint8_t  _isr_fader = 0;         // flag to track when the LED fading l
 #endif
 
 uint8_t           _pwm_step = 0;          // PWM step counter for all LEDs
+uint16_t          _pwm_thr = 0;           // PWM compare threshold (8.8 fixed point), runs from 0 to 255 at a speed set by the brightness level
+volatile uint16_t _pwm_thr_inc = 256;     // Threshold increment per PWM step for the current period
+volatile uint8_t  _pwm_tail_long = 0;     // set while the timer runs a long tick covering the idle tail of a PWM period
+volatile uint16_t _pwm_base_icr = 0;      // Timer1 TOP for a normal tick, saved while a long tick runs
+
+#ifdef SUPPORT_PWM_TAIL
+  // Once the compare threshold saturated, all LEDs stay off until the end of the PWM period. Instead of running the
+  // remaining ticks, the timer TOP is multiplied so this tick lasts for up to PWM_TAIL_MAX_TICKS ticks; the step and
+  // fader counters skip ahead by the same amount so the period and the fader timing stay the same.
+  // Only done when no fader update is in progress (those take one fader per tick) and early in the ISR, while the timer
+  // is still counting up: raising TOP then takes effect in the current tick. A long tick ends at the button tick at the
+  // latest, so the buttons and the demo timer are handled once per fader interval at every brightness level.
+  #define PWM_TAIL_SKIP() {                                                    \
+    if(_fader_pending == 0) {                                                \
+      const uint8_t remaining = -_pwm_step; /* ticks left including this */  \
+      uint8_t skip = (remaining < PWM_TAIL_MAX_TICKS) ? remaining : PWM_TAIL_MAX_TICKS; \
+      const uint16_t button_tick = _fader_update_ticks - 1;                  \
+      if(fader_interval_cnt < button_tick && skip > button_tick - fader_interval_cnt) { \
+        skip = button_tick - fader_interval_cnt;                             \
+      }                                                                      \
+      if(skip > 1) {                                                         \
+        _pwm_base_icr = ICR1;                                                \
+        ICR1 = _pwm_base_icr * skip;                                         \
+        _pwm_tail_long = 1;                                                  \
+        TIME_LONG_TICK(skip);                                                \
+        TRACE_LONG_TICK(skip);                                               \
+        _pwm_step += skip - 1;                                               \
+        fader_interval_cnt += skip - 1;                                      \
+      }                                                                      \
+    }                                                                        \
+  }
+  // Return to the normal timer TOP after a long tick; the timer just passed BOTTOM and is counting up from 0, so this has
+  // to be done before it reaches the normal TOP: keep it at the start of the ISR
+  #define PWM_TAIL_RESTORE() { if(_pwm_tail_long) { ICR1 = _pwm_base_icr; _pwm_tail_long = 0; TIME_LONG_TICK_END(); TRACE_LONG_TICK_END(); } }
+#else
+  #define PWM_TAIL_SKIP() {}
+  #define PWM_TAIL_RESTORE() {}
+#endif
+
+#ifdef SUPPORT_ISR_JITTER
+  // Timer1 passed BOTTOM when the tick was due and counts up from there at the CPU clock; read it first thing
+  #define ISR_JITTER_ENTRY() const uint16_t isr_entry = TCNT1;
+  #define ISR_JITTER_ACCOUNT() {                                 \
+    if(isr_entry < _isr_entry_min) _isr_entry_min = isr_entry; \
+    if(isr_entry > _isr_entry_max) _isr_entry_max = isr_entry; \
+  }
+#else
+  #define ISR_JITTER_ENTRY() {}
+  #define ISR_JITTER_ACCOUNT() {}
+#endif
+
+// Threshold increment per PWM step for every brightness level: a LED with brightness b is on while the threshold is
+// below b, so the duty cycle becomes b/256 * 256/inc. The levels are spaced evenly in CIE lightness (L* = 100, 84, 68,
+// 52, 36 and 20), the dimmest level is 1/34 of full brightness.
+static const uint16_t BRIGHTNESS_THR_INC [NUM_BRIGHTNESS_LEVELS] PROGMEM = {
+  256, 400, 674, 1271, 2842, 8565
+};
 
 volatile uint16_t fader_interval_cnt = 0; // Faders are updated every ANI_INTERVAL steps of the PWM interrupt
-volatile int8_t   fader_update_ptr = -1;  // To speed up the ISR, when the update interval is reached, this pointer is set to the highest LED fader index; as long as its not 0, a single fader at a time is updated during the ISR
+fader_mask_t      _fader_pending = 0;     // To speed up the ISR, when the update interval is reached the active faders are marked pending; as long as one is left, a single fader at a time is updated during the ISR
 
 volatile int16_t  _err_cnt = 0;           // during error, blink the single LEDs
+uint8_t           _err_shown = 0;         // error code for which the port masks below were computed
+uint8_t           _err_phase = 0;         // blink phase written to the ports, 1 when the indicator LEDs are on
+uint8_t           _err_all_d, _err_all_b;     // LED pins on PORTD / PORTB
+uint8_t           _err_lit_d, _err_lit_b;     // LED indicating the error code, always on
+uint8_t           _err_blink_d, _err_blink_b; // blinking indicator LEDs PIN_LED_ERR0 and PIN_LED_ERR1
+
+// Deadline tracking
+volatile uint8_t  _isr_ticks = 0;         // incremented on every tick, the watchdog is only fed while this changes
+volatile uint16_t _isr_missed = 0;        // saturating count of ticks which did not finish before the next tick was due
+volatile uint16_t _isr_peak = 0;          // longest tick in Timer1 counts (from the start of the period to the end of the ISR)
+#ifdef SUPPORT_ISR_JITTER
+volatile uint16_t _isr_entry_min = 0xFFFF; // lowest and highest Timer1 count at the start of the ISR
+volatile uint16_t _isr_entry_max = 0;
+#endif
 
 // Shared error register, when set to non-zero the ISR will show an error using the LEDs
 volatile uint8_t  _err = 0; // when non-zero, an error occured and the LEDs will indicate what went wrong
 
 // Shared LED brightness tracking
 volatile duint8_t _led_brightness [NUM_LEDS]; // double uint8_t, the major byte indicates the PWM value
-volatile uint8_t  _raw_pwm_val    [NUM_LEDS]; // scaled value from _led_brightness, to allow dimming
-volatile uint8_t  _raw_scaler = 0;            // scale factor (shift) for _raw_pwm_val
+volatile uint8_t  _brightness_level = 0;      // global brightness level, index in BRIGHTNESS_THR_INC
 
-// special type controlling the faders per LED
-fader_struct_t fader [NUM_LEDS];
+// Faders per LED
+volatile int16_t  fader_delta  [NUM_LEDS];
+volatile uint8_t  fader_reload [NUM_LEDS];
+volatile uint8_t  fader_upper  [NUM_LEDS];
+volatile uint8_t  fader_lower  [NUM_LEDS];
+volatile fader_mask_t fader_active = 0;
 
 // Button state tracking
-const uint8_t     btn_debounce_limit = 2; // Number of consecutive readings to debounce the press 
-const uint8_t     btn_hold_limit = 50;    // Number of consecutive readings to upgrade the press to a hold
-volatile uint8_t  _btn0_down_cnt = 0;
-volatile uint8_t  _btn1_down_cnt = 0;
-volatile uint8_t  _btn0_active = 0;
-
-volatile uint8_t  btn0_hold = 0;           // Flag to indicate the button was held down
-volatile uint8_t  btn1_hold = 0;           // Flag to indicate the button was held down
+const uint8_t     btn_debounce_limit = 2; // Number of consecutive readings to debounce a press or release
+uint8_t           _btn_state = 0;         // Debounced state, bit per button: 1 when down
+uint8_t           _btn_change_cnt [2];    // Consecutive readings which differ from the debounced state
 
 // Demo controls
 volatile uint8_t demo_mode = 0; // Flag to track if the demo mode (auto-switch between effects) is enabled, 0 = off, anything higher is a duration multiplier
@@ -171,6 +251,19 @@ uint16_t demo_tick_cnt = 0;    // Count number of ISR ticks to determine if the
  * Currently this ISR is measured to take between 8 us and 24 us depending on the settings.
  */
 void heart_isr() {
+  // Interrupt latency of this tick (when enabled)
+  ISR_JITTER_ENTRY();
+  // Back to the normal tick length when the previous tick covered the tail of a PWM period (when enabled)
+  PWM_TAIL_RESTORE();
+  ISR_JITTER_ACCOUNT();
+
+  // Progress counter for the watchdog, also counts in error mode as the ISR is still running
+  _isr_ticks++;
+  // Time stamps of the trace (when enabled)
+  TRACE_TICK();
+  // Time base (when enabled)
+  TIME_TICK();
+
   #ifdef SUPPORT_NESTED_ISR
     // Detect if this function was pre-empted by the current interrupt; if so the PWM is failing, switch to error mode
     if(_isr_running)
@@ -179,16 +272,35 @@ void heart_isr() {
   
   #ifdef SUPPORT_ERRORS
   if(_err) {
-    // Error mode, blink 2 LEDs on to indicate something went wrong
-    // Start by driving all LEDs off except for the LED indicating the problem.
-    for(uint8_t l=0, el=PIN_LED_START; el<PIN_LED_END; el++, l++) {
-      if(el != PIN_LED_ERR0 && el != PIN_LED_ERR1) {
-        digitalWrite(el, (l != _err) ? HIGH : LOW); // Leave the LED on that indicates the problem
+    // Error mode, blink 2 LEDs on to indicate something went wrong and leave the LED on that indicates the problem.
+    // The port registers are only written when the blink phase changes, so the error display hardly uses any CPU time.
+    const uint8_t phase = (_err_cnt > 0);
+    if(_err != _err_shown) {
+      // New error code: compute the port masks once (LEDs are active low, so a set bit in the 'lit' masks drives it LOW)
+      _err_all_d = _err_all_b = _err_lit_d = _err_lit_b = _err_blink_d = _err_blink_b = 0;
+      for(uint8_t l=0, el=PIN_LED_START; el<PIN_LED_END; el++, l++) {
+        _err_all_d |= PIN_PORTD_MASK(el);
+        _err_all_b |= PIN_PORTB_MASK(el);
+        if(el == PIN_LED_ERR0 || el == PIN_LED_ERR1) {
+          _err_blink_d |= PIN_PORTD_MASK(el);
+          _err_blink_b |= PIN_PORTB_MASK(el);
+        } else if(l == _err) {
+          _err_lit_d |= PIN_PORTD_MASK(el);
+          _err_lit_b |= PIN_PORTB_MASK(el);
+        }
       }
+      _err_shown = _err;
+      _err_phase = !phase; // Force a port update below
+    }
+    if(phase != _err_phase) {
+      #ifdef SUPPORT_SHIFT_OUT
+        shift_error(_err, phase);
+      #else
+        PORTD = (PORTD | _err_all_d) & ~(_err_lit_d | (phase ? _err_blink_d : 0));
+        PORTB = (PORTB | _err_all_b) & ~(_err_lit_b | (phase ? _err_blink_b : 0));
+      #endif
+      _err_phase = phase;
     }
-    // Blink the 2 indicator LEDs
-    digitalWrite(PIN_LED_ERR0, (_err_cnt > 0) ? LOW : HIGH);
-    digitalWrite(PIN_LED_ERR1, (_err_cnt > 0) ? LOW : HIGH);
 
     // Increase the counter used to blink the LEDs
     _err_cnt++;
@@ -215,12 +327,35 @@ void heart_isr() {
 
     // Profiling measurement starts (note that at most one of these macros is defined at compile time)
     MEASUREMENT_ISR_PWM_START; // Measurement start when measuring PWM part only; every tick
-    if(fader_update_ptr >= 0)
+    if(_fader_pending)
       MEASUREMENT_ISR_ALL_START; // Measurement start when measuring PWM + fader; every FADER_UPDATE_TICKS ticks
     MEASUREMENT_ISR_ANY_START;
 
     // Increase PWM counter
     _pwm_step++;
+
+    // Move the compare threshold; the global brightness determines how fast it reaches the end of the PWM range
+    if(_pwm_step == 0) {
+      // Start of a new PWM period: pick up the brightness level, apply the current limit and latch the next streamed frame
+      // (the last two only when enabled)
+      uint16_t inc = pgm_read_word(&BRIGHTNESS_THR_INC[_brightness_level]);
+      POWER_LIMIT_INC(inc);
+      _pwm_thr = 0;
+      _pwm_thr_inc = inc;
+      STREAM_PERIOD();
+    } else if(_pwm_thr <= 0xFFFF - _pwm_thr_inc) {
+      _pwm_thr += _pwm_thr_inc;
+    } else {
+      // Saturate; all LEDs are off for the remainder of the period
+      _pwm_thr = 0xFFFF;
+      PWM_TAIL_SKIP();
+    }
+
+    #ifdef SUPPORT_SHIFT_OUT
+    // Bit-plane modulation through the shift registers; the planes are only computed in ticks without fader work
+    shift_tick(_pwm_step, _pwm_thr_inc, _fader_pending == 0 && fader_interval_cnt + 1 < _fader_update_ticks);
+    #else
+    const uint8_t pwm_thr = _pwm_thr >> 8;
     
     // Do PWM per LED
     // Note: since digitalWrite is very slow, we read the pin status registers, manipulate the copy and write back the result
@@ -232,7 +367,7 @@ void heart_isr() {
       // Generic loop, optimized to run between 24us and 36us
       for(uint8_t l=0, li=PIN_LED_START; l<NUM_LEDS; l++, li++) {
         // Note: this boundary provides support for switching LEDs completely off, but completely on (255/255) will result in a single low cycle during PWM
-        if(_pwm_step >= _raw_pwm_val[l]) {
+        if(pwm_thr >= _led_brightness[l].major) {
           //digitalWrite(li, HIGH); // slow - replaced by direct port manipulation below
           if(li <= 7) {
             // Pin in port D, turn on
@@ -264,16 +399,16 @@ void heart_isr() {
       }
     #else
       // Unrolled loop resulting in removal of most of the if-then-else, optimized to run between 8us and 20us
-      SOFT_PWM_LED( 2, _raw_pwm_val[0]); // LED 0, pin 2
-      SOFT_PWM_LED( 3, _raw_pwm_val[1]); // LED 1, pin 3
-      SOFT_PWM_LED( 4, _raw_pwm_val[2]); // LED 2, pin 4
-      SOFT_PWM_LED( 5, _raw_pwm_val[3]); // LED 3, pin 5
-      SOFT_PWM_LED( 6, _raw_pwm_val[4]); // LED 4, pin 6
-      SOFT_PWM_LED( 7, _raw_pwm_val[5]); // LED 5, pin 7
-      SOFT_PWM_LED( 8, _raw_pwm_val[6]); // LED 6, pin 8
-      SOFT_PWM_LED( 9, _raw_pwm_val[7]); // LED 7, pin 9
-      SOFT_PWM_LED(10, _raw_pwm_val[8]); // LED 8, pin 10
-      SOFT_PWM_LED(11, _raw_pwm_val[9]); // LED 9, pin 11
+      SOFT_PWM_LED( 2, _led_brightness[0].major); // LED 0, pin 2
+      SOFT_PWM_LED( 3, _led_brightness[1].major); // LED 1, pin 3
+      SOFT_PWM_LED( 4, _led_brightness[2].major); // LED 2, pin 4
+      SOFT_PWM_LED( 5, _led_brightness[3].major); // LED 3, pin 5
+      SOFT_PWM_LED( 6, _led_brightness[4].major); // LED 4, pin 6
+      SOFT_PWM_LED( 7, _led_brightness[5].major); // LED 5, pin 7
+      SOFT_PWM_LED( 8, _led_brightness[6].major); // LED 6, pin 8
+      SOFT_PWM_LED( 9, _led_brightness[7].major); // LED 7, pin 9
+      SOFT_PWM_LED(10, _led_brightness[8].major); // LED 8, pin 10
+      SOFT_PWM_LED(11, _led_brightness[9].major); // LED 9, pin 11
 
       // Guard against changes in the design which would mismatch with the original pin layout
       #if NUM_LEDS != 10
@@ -284,79 +419,38 @@ void heart_isr() {
       #endif
     #endif
 
+    // Show the load meter instead of the animation (when enabled)
+    LOAD_BAR_OVERRIDE(pin0_7, pin8_13);
+
     // Apply the new port pin states
     PORTD = pin0_7;
     PORTB = pin8_13;
+    #endif
 
 
     // ------------------------------- fader controls -------------------------------------------
-    // Increase the counter for the fader interval
+    // Increase the counter for the fader interval; the number of ticks between fader updates follows the timer interval
+    // when the governor is enabled, otherwise it is FADER_UPDATE_TICKS
+    const uint16_t fader_ticks = _fader_update_ticks;
     fader_interval_cnt++;
     
-    // Do button handling one 'tick' before starting the faders
-    if(fader_interval_cnt >= FADER_UPDATE_TICKS - 1) {
-      // Sample and handle the button inputs at the same frequency as the faders get updated
-      volatile uint8_t btn0_pressed = PINB & BTN0_MASK;
-      volatile uint8_t btn1_pressed = PINB & BTN1_MASK;
-      
-      // Only process btn0 state changes if the PWM computations are not active
-      if(!_btn0_active) {
-        if(btn0_pressed) {
-          if(_btn0_down_cnt < btn_hold_limit) {
-              _btn0_down_cnt++;
-          } else if(_btn0_down_cnt == btn_hold_limit) {
-            // Reached hold limit - flag that the button is held down
-            btn0_hold = 1;
-            
-            // Disable current animation delay so it aborts and control returns to the main loop
-            disable_heart_delay();
-            
-            // Add one more step to only run this code once when the hold is detected
-            _btn0_down_cnt++;
-          }
-        } else {
-          // Make sure the button was pressed for even a single cycle...
-          if(_btn0_down_cnt > 0) {
-            // Potential button release, determine what it was
-            if(_btn0_down_cnt < btn_hold_limit) {
-              // Short button press, change brightness
-
-              // First trigger of the button 0 press - change the PWM scale
-              if(GET_BRIGHTNESS_SCALE < 5) {
-                SET_BRIGHTNESS_SCALE(GET_BRIGHTNESS_SCALE + 1);
-              } else {
-                // Reset to full brightness
-                SET_BRIGHTNESS_SCALE(0);
-              }
-            
-              // Mark btn0 active to disable button response during the fader updates, the PWM values are recomputed, also for inactive faders
-              _btn0_active = 1;
-            }
-            // Clear the hold down flag (if it was set)
-            btn0_hold = 0;
-            // Clear the counter
-            _btn0_down_cnt = 0;
-          } 
-        } 
-      } 
-
-      // Handle if button 1 is pressed
-      if(btn1_pressed) {
-        if(_btn1_down_cnt < btn_debounce_limit) {
-          _btn1_down_cnt++;
-        } else if(_btn1_down_cnt == btn_debounce_limit){
-          // Disable the animation delay so it aborts
-          disable_heart_delay();
-
-          // Increase the counter to only run this logic once
-          _btn1_down_cnt = btn_debounce_limit+1;
-          
-          // Reset demo mode counters to make sure they start anew when switching animations
-          demo_tick_cnt = 0;
-          demo_multi_cnt = 0;
+    // Do button handling one 'tick' before starting the faders, exactly once per fader interval (a long PWM tail tick
+    // never skips this tick)
+    if(fader_interval_cnt == fader_ticks - 1) {
+      // Sample the button inputs at the same frequency as the faders get updated; a change counts once it is seen
+      // btn_debounce_limit times in a row (22-44 ms at the 45 Hz fader rate), the gestures are recognised by
+      // event_service() in the main loop
+      const uint8_t pins = PINB;
+      for(uint8_t btn = 0; btn < 2; btn++) {
+        const uint8_t mask = btn ? BTN1_MASK : BTN0_MASK;
+        const uint8_t bit = 1 << btn;
+        if(((pins & mask) != 0) == ((_btn_state & bit) != 0)) {
+          _btn_change_cnt[btn] = 0;
+        } else if(++_btn_change_cnt[btn] >= btn_debounce_limit) {
+          _btn_change_cnt[btn] = 0;
+          _btn_state ^= bit;
+          event_push((_btn_state & bit) ? EVENT_PRESS : EVENT_RELEASE, btn);
         }
-      } else {
-        _btn1_down_cnt = 0;
       }
 
       // Demo mode support
@@ -372,8 +466,8 @@ void heart_isr() {
             // Reset the multiplier counter
             demo_multi_cnt = 0;
           
-            // Disable the animation delay so any animation currently active aborts
-            disable_heart_delay();
+            // Let the main loop abort the animation which is currently active
+            event_push(EVENT_DEMO, 0);
           }
         }
       } else {
@@ -383,11 +477,12 @@ void heart_isr() {
       }
     }
 
-    // Fader interval reached, start updating all faders, one at a time
-    if(fader_interval_cnt >= FADER_UPDATE_TICKS) {
-      fader_update_ptr = NUM_LEDS - 1;
-      // Clear the counter
-      fader_interval_cnt = 0;
+    // Fader interval reached, start updating the active faders, one at a time; when nothing is animating there is
+    // nothing to do until the next interval
+    if(fader_interval_cnt >= fader_ticks) {
+      _fader_pending = fader_active;
+      // Restart the counter; keep the ticks counted past the interval, a long tick at the end of a PWM period skips ahead
+      fader_interval_cnt -= fader_ticks;
 
       // When measuring PWM + fader, on the first fader we missed the PWM part, but measure the fader part to make sure the stops match up
       MEASUREMENT_ISR_ALL_START;
@@ -395,7 +490,7 @@ void heart_isr() {
 
     MEASUREMENT_ISR_PWM_STOP; // When measuring PWM only, stop measuring here
 
-    if(fader_update_ptr >= 0) {
+    if(_fader_pending) {
       #ifdef SUPPORT_NESTED_ISR
       // Error handling; when this logic is so slow it results in nested fader logic, the program will lock up
       if(_isr_fader) {
@@ -408,91 +503,129 @@ void heart_isr() {
       _isr_running = 0;
       #endif
 
-      fader_struct_t * const f = (fader_struct_t * const)&fader[fader_update_ptr];
-      const effect_enum_t    e = f->reload;
-      if(f->active) {
+      // Take the lowest pending fader, its index is found in constant time by halving the part of the mask to search
+      const fader_mask_t pending = _fader_pending;
+      uint8_t l = 0;
+      #if NUM_LEDS > 32
+        uint32_t w = pending;
+        if(w == 0) {
+          w = pending >> 32;
+          l = 32;
+        }
+      #elif NUM_LEDS > 16
+        const uint32_t w = pending;
+      #endif
+      #if NUM_LEDS > 16
+        uint16_t h = w;
+        if(h == 0) {
+          h = w >> 16;
+          l += 16;
+        }
+      #else
+        const uint16_t h = pending;
+      #endif
+      uint8_t b = h;
+      if(b == 0) {
+        b = h >> 8;
+        l += 8;
+      }
+      if((b & 0x0F) == 0) {
+        b >>= 4;
+        l += 4;
+      }
+      if((b & 0x03) == 0) {
+        b >>= 2;
+        l += 2;
+      }
+      if((b & 0x01) == 0) {
+        l += 1;
+      }
+      const fader_mask_t bit = pending & -pending;
+      _fader_pending = pending & ~bit;
+
+      // Skip the fader when it was stopped since the interval started
+      if(fader_active & bit) {
+        // Load the settings once, the arrays are volatile as the main loop changes them
+        const int16_t delta = fader_delta[l];
+        const uint8_t upper = fader_upper[l];
+        const uint8_t lower = fader_lower[l];
+        const uint8_t e     = fader_reload[l];
         // Use a 32 bit to detect over and underflow on the 16 bit PWM counter (note that the uper 8 bits are used for PWM, this allows sub-stepping)
-        int32_t newraw = (int32_t)_led_brightness[fader_update_ptr].raw + (int32_t)f->delta;
+        int32_t newraw = (int32_t)_led_brightness[l].raw + (int32_t)delta;
         int16_t newmajor = newraw >> 8; // Remove the lower byte to obtain the PWM value (note that the first 8 bits are valid, upper bits are only needed to detect overflow)
-        if(newmajor > f->upper) {
+        if(newmajor > upper) {
           // Upper-bound tripped, handle effect
+          TRACE(TRACE_FADER_BOUND, 0x8000 | (e << 8) | l);
           switch(e) {
             case NONE:
               // No effect, cap to upper and hold
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->upper, 0);
-              f->active = 0;
+              SET_LED_BRIGHTNESS(l, upper, 0);
+              fader_active &= ~bit;
               break;
             case JUMP:
               // Jump to lower bound
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->lower, 0);
+              SET_LED_BRIGHTNESS(l, lower, 0);
               break;
             case INVERT:
             case UPPER_INVERT:
               // Cap to upper - delta (upper bound was used last update)
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->upper - (f->delta >> 8), 0 - (f->delta & 0xFF));
-              f->delta = -f->delta;
+              SET_LED_BRIGHTNESS(l, upper - (delta >> 8), 0 - (delta & 0xFF));
+              fader_delta[l] = -delta;
               break;
             case LOWER_INVERT:
               // Already inverted once, disable fader
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->upper, 0);
-              f->active = 0;
+              SET_LED_BRIGHTNESS(l, upper, 0);
+              fader_active &= ~bit;
               break;
           }
-        } else if(newmajor < f->lower) {
+        } else if(newmajor < lower) {
           // Lower bound tripped, handle effect
+          TRACE(TRACE_FADER_BOUND, (e << 8) | l);
           switch(e) {
             case NONE:
               // No effect, cap to lower and hold
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->lower, 0);
-              f->active = 0;
+              SET_LED_BRIGHTNESS(l, lower, 0);
+              fader_active &= ~bit;
               break;
             case JUMP:
               // Jump to upper bound
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->upper, 0);
+              SET_LED_BRIGHTNESS(l, upper, 0);
               break;
             case INVERT:
-            case LOWER_INVERT:
-              // Cap to lower + delta (lower bound was used last update)
-              f->delta = -f->delta; // First invert delta, its now positive
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->lower + (f->delta >> 8), f->delta & 0xFF);
+            case LOWER_INVERT: {
+              // Cap to lower + delta (lower bound was used last update); invert the delta first, its now positive
+              const int16_t inv = -delta;
+              fader_delta[l] = inv;
+              SET_LED_BRIGHTNESS(l, lower + (inv >> 8), inv & 0xFF);
               break;
+            }
             case UPPER_INVERT:
               // Already inverted once, disable fader
-              SET_LED_BRIGHTNESS(fader_update_ptr, f->lower, 0);
-              f->active = 0;
+              SET_LED_BRIGHTNESS(l, lower, 0);
+              fader_active &= ~bit;
               break;
             case SETUP_LOWER:
               // Bug/programming fix: make sure the delta is positive (so this LED fades in)
-              if(f->delta < 0) {
-                f->delta = -f->delta;
+              if(delta < 0) {
+                fader_delta[l] = -delta;
               }
               // Still below the target brightness, apply the value
-              SET_LED_BRIGHTNESS_RAW(fader_update_ptr, newraw);
+              SET_LED_BRIGHTNESS_RAW(l, newraw);
               break;
           }
         } else {
           // Not below the lower bound or above the upper bound
           if(e == SETUP_LOWER) {
             // Setup to lower bound complete; cap to lower bound
-            SET_LED_BRIGHTNESS(fader_update_ptr, f->lower, 0);
-            f->active = 0;
+            SET_LED_BRIGHTNESS(l, lower, 0);
+            fader_active &= ~bit;
           } else {
             // Normal fade step: apply new value
-            SET_LED_BRIGHTNESS_RAW(fader_update_ptr, newraw);
+            SET_LED_BRIGHTNESS_RAW(l, newraw);
           }
         }
-      } else if(_btn0_active) {
-         // Fader inactive but btn0 is pressed; update the real PWM value to the new brightness
-        _SET_SCALED_PWM(fader_update_ptr, GET_LED_BRIGHTNESS(fader_update_ptr).major);
       }
 
-      // Make sure to clear the button state at the last update
-      if(fader_update_ptr == 0)
-        _btn0_active = 0;
-
-      // Fader updated, move the pointer, when it hits -1 all faders are done
-      fader_update_ptr--;
-
       // When measuring PWM + fader duration, stop here
       MEASUREMENT_ISR_ALL_STOP;
 
@@ -508,6 +641,26 @@ void heart_isr() {
     }
     
     MEASUREMENT_ISR_ANY_STOP;
+
+    // Deadline check: Timer1 clears the overflow flag when entering this interrupt, so when it is set again the next tick
+    // is already due and will be late (or lost when it is due twice). The timer runs up and down (phase correct PWM),
+    // when it is going down the time since the start of this tick is the period minus the count.
+    // The time spent is also added to the load measured by the governor, the clock scaling and the load meter (when
+    // enabled).
+    if(TIFR1 & _BV(TOV1)) {
+      if(_isr_missed != 0xFFFF) _isr_missed++;
+      GOVERNOR_ACCOUNT(2 * ICR1);
+      CLOCK_ACCOUNT(2 * ICR1);
+      LOAD_ACCOUNT(2 * ICR1);
+    } else {
+      const uint16_t cnt0 = TCNT1;
+      const uint16_t cnt1 = TCNT1;
+      const uint16_t elapsed = (cnt1 >= cnt0) ? cnt1 : 2 * ICR1 - cnt1;
+      if(elapsed > _isr_peak) _isr_peak = elapsed;
+      GOVERNOR_ACCOUNT(elapsed);
+      CLOCK_ACCOUNT(elapsed);
+      LOAD_ACCOUNT(elapsed);
+    }
   #ifdef SUPPORT_ERRORS
     // When error reporting is on, close the scope of the error-or-normal if block
   }
@@ -10,25 +10,96 @@
 #define _HEART_ISR_H_
 
 #include "heart_settings.h"
+#include "heart_power.h"
+#include "heart_trace.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
 
 // Shared error register, when set to non-zero the ISR will show an error using the LEDs
 extern volatile uint8_t  _err; // when non-zero, an error occured and the LEDs will indicate what went wrong
 
+// Deadline tracking: read the 16 bit counters with interrupts disabled
+extern volatile uint8_t  _isr_ticks;  // incremented on every tick
+extern volatile uint16_t _isr_missed; // saturating count of ticks which did not finish before the next tick was due
+extern volatile uint16_t _isr_peak;   // longest tick in Timer1 counts; a full period is 2 * ICR1 counts
+#ifdef SUPPORT_ISR_JITTER
+extern volatile uint16_t _isr_entry_min; // lowest and highest Timer1 count at the start of the ISR (the latency in cycles)
+extern volatile uint16_t _isr_entry_max;
+#endif
+// Timer1 counts at the CPU clock, so _isr_peak is the longest tick in cycles (the 'c' command prints it as isr_peak_cyc):
+// the interrupt latency, the PWM part and, on a fader tick, one fader update.
+
 // Shared LED brightness tracking
 // DO NOT SET THESE DIRECTLY; ALWAYS USE 'SET_LED_BRIGHTNESS' or 'SET_LED_BRIGHTNESS_MAJOR'
 extern volatile duint8_t _led_brightness [NUM_LEDS];  // double uint8_t, the major byte is used for the PWM value
-extern volatile uint8_t  _raw_pwm_val [NUM_LEDS];     // real PWM values
-extern volatile uint8_t  _raw_scaler;
+extern volatile uint8_t  _brightness_level;           // global brightness level, 0 is the brightest; applied by the PWM compare
+extern volatile uint16_t _pwm_thr_inc;                // PWM compare threshold increment of the current period; brightness is scaled by 256/inc
+extern volatile uint8_t  _pwm_tail_long;              // set while Timer1 runs a long tick, ICR1 is then a multiple of _pwm_base_icr
+extern volatile uint16_t _pwm_base_icr;               // Timer1 TOP for a normal tick while a long tick runs
+
+// Faders per LED, kept in parallel arrays so the ISR only loads the fields of the fader it updates.
+// To change a running fader, stop it with FADER_STOP() first and start it again with FADER_START() afterwards.
+extern volatile int16_t fader_delta  [NUM_LEDS]; // step size, note that this is a 16-bit value in order to do smooth sub-step fades
+extern volatile uint8_t fader_reload [NUM_LEDS]; // what to do when the end of the fade (up or down) is reached, an effect_enum_t
+extern volatile uint8_t fader_upper  [NUM_LEDS]; // upper bound for the fader - default is 255
+extern volatile uint8_t fader_lower  [NUM_LEDS]; // lower bound for the fader - default is 0
+
+// Fader masks have a bit per LED; wider types are only used for the larger LED counts of the shift register output
+#if NUM_LEDS > 64
+#error "The active fader mask holds 64 LEDs only!"
+#elif NUM_LEDS > 32
+typedef uint64_t fader_mask_t;
+#elif NUM_LEDS > 16
+typedef uint32_t fader_mask_t;
+#else
+typedef uint16_t fader_mask_t;
+#endif
+
+// Bit mask of the active faders, bit n for LED n; the ISR clears the bit when a fade ends.
+// DO NOT SET THIS DIRECTLY; ALWAYS USE THE FADER_START / FADER_STOP MACROS
+extern volatile fader_mask_t fader_active;
+
+#define FADER_BIT(__led) ((fader_mask_t)1 << (__led))
+#define FADER_ALL        ((fader_mask_t)~(fader_mask_t)0 >> (8 * sizeof(fader_mask_t) - NUM_LEDS))
+
+// Start or stop a set of faders at once; the ISR changes the mask as well so this is done with interrupts disabled
+#define FADER_START_MASK(__mask) {              \
+  const uint8_t __sreg = SREG;                  \
+  cli();                                        \
+  fader_active |= (__mask);                     \
+  TRACE(TRACE_FADER_START, (uint16_t)(__mask)); \
+  SREG = __sreg;                                \
+}
+
+#define FADER_STOP_MASK(__mask) {   \
+  const uint8_t __sreg = SREG;      \
+  cli();                            \
+  fader_active &= ~(__mask);        \
+  SREG = __sreg;                    \
+}
 
-// special type controlling the faders per LED
-extern fader_struct_t fader [NUM_LEDS];
+#define FADER_START(__led) FADER_START_MASK(FADER_BIT(__led))
+#define FADER_STOP(__led)  FADER_STOP_MASK(FADER_BIT(__led))
+#define FADER_ACTIVE(__led) ((fader_active & FADER_BIT(__led)) != 0)
+
+// True when no fader is running: every LED holds its brightness
+#define FADERS_IDLE() (fader_active == 0)
 
 // flag to enable or disable the demo mode (0 = disabled, anything higher is a duration multiplier)
 extern volatile uint8_t demo_mode;
 
-// flags to track that a button is held down
-extern volatile uint8_t btn0_hold;
-//extern volatile uint8_t btn1_hold; - not yet implemented
+// demo mode timer, counted by the ISR; restart it with DEMO_RESTART()
+extern uint16_t demo_tick_cnt;
+extern uint8_t  demo_multi_cnt;
+
+// Restart the demo mode timer, which keeps the demo mode from switching to the next animation for a while
+#define DEMO_RESTART() {            \
+  const uint8_t __sreg = SREG;      \
+  cli();                            \
+  demo_tick_cnt = 0;                \
+  demo_multi_cnt = 0;               \
+  SREG = __sreg;                    \
+}
 
 /**
  * Timer interrupt routine; provides software PWM and LED fading logic, needs to be fast in order to
@@ -38,30 +109,56 @@ extern volatile uint8_t btn0_hold;
  */
 void heart_isr();
 
-#define _SET_SCALED_PWM(__led, __major) _raw_pwm_val[__led] = (__major) >> _raw_scaler;
-
+// Note: the power accounting (when enabled) needs the old brightness, so it has to run before the new value is set
 #define SET_LED_BRIGHTNESS_MAJOR(__led, __major) {    \
-  _led_brightness[__led].major = __major;             \
-  _raw_pwm_val[__led] = __major >> _raw_scaler;       \
+  const uint8_t __m = (__major);                      \
+  POWER_ACCOUNT(__led, __m);                          \
+  _led_brightness[__led].major = __m;                 \
 }
 
 #define SET_LED_BRIGHTNESS(__led, __major, __minor) {   \
-  _led_brightness[__led].major = (__major);             \
+  const uint8_t __m = (__major);                        \
+  POWER_ACCOUNT(__led, __m);                            \
+  _led_brightness[__led].major = __m;                   \
   _led_brightness[__led].minor = (__minor);             \
-  _SET_SCALED_PWM(__led, __major);                      \
 }
 
 #define SET_LED_BRIGHTNESS_RAW(__led, __raw) {         \
-  _led_brightness[__led].raw = (__raw);                \
-  _SET_SCALED_PWM(__led, (__raw) >> 8);                \
+  const uint16_t __r = (__raw);                        \
+  POWER_ACCOUNT(__led, __r >> 8);                      \
+  _led_brightness[__led].raw = __r;                    \
 }
 
 #define GET_LED_BRIGHTNESS(i) _led_brightness[i]
 
-#define SET_BRIGHTNESS_SCALE(__scaler) {                               \
-  _raw_scaler = (__scaler < 5) ? ((__scaler >= 0) ? __scaler : 0) : 5; \
+/**
+ * Utility function to quickly configure a fader to fade to the lower bound
+ */
+static inline void setup_fade_to_lower(uint8_t l) {
+  if(fader_lower[l] == _led_brightness[l].major) {
+    // Nothing to do, fader and LED have same value, disable fader
+    FADER_STOP(l);
+    _led_brightness[l].minor = 0;
+  } else if(fader_lower[l] < _led_brightness[l].major) {
+    // LED is brighter, fade down
+    fader_reload[l] = NONE;
+    if(fader_delta[l] > 0) fader_delta[l] = -fader_delta[l]; // Reverse fade direction to fade out
+    FADER_START(l);
+  } else {
+    // LED is dimmer, fade in
+    fader_reload[l] = SETUP_LOWER;
+    fader_delta[l] = SETUP_FADE_SPEED_MAJOR << 8;
+    FADER_START(l);
+  }
+}
+
+// The global brightness is applied when comparing against the PWM counter; the ISR picks up a new level at the start
+// of the next PWM period
+#define SET_BRIGHTNESS_SCALE(__scaler) {                                                   \
+  _brightness_level = (__scaler < NUM_BRIGHTNESS_LEVELS) ? ((__scaler >= 0) ? __scaler : 0) \
+                                                         : NUM_BRIGHTNESS_LEVELS - 1;       \
 }
 
-#define GET_BRIGHTNESS_SCALE _raw_scaler
+#define GET_BRIGHTNESS_SCALE _brightness_level
 
 #endif
\ No newline at end of file
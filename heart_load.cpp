@@ -0,0 +1,154 @@
+/**
+ * heart_load.cpp - Heart PCB Project - CPU load meter: time in the ISR, in the animations and waiting
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.13
+ * @license GNUGPLv3
+ */
+
+#include "heart_load.h"
+
+#ifdef SUPPORT_LOAD_METER
+#include "Arduino.h"
+#include "heart_time.h"
+
+volatile uint32_t _load_busy = 0;
+volatile uint32_t _load_total = 0;
+
+uint8_t  load_isr [LOAD_SLOTS];     // Share of the ISR per slot, 255 is all of the time
+uint8_t  load_idle [LOAD_SLOTS];    // Share of the waits per slot
+uint8_t  load_slot = 0;             // Next slot to fill
+uint32_t load_slot_us = 0;          // Start of the current slot
+uint32_t load_wait_us = 0;          // Time spent waiting in the current slot
+uint32_t load_wait_start_us = 0;    // Start of the current wait, or the part of it in the current slot
+uint8_t  load_waiting = 0;          // Set while the main loop waits
+
+#ifdef SUPPORT_LOAD_BAR
+volatile uint8_t _load_bar = 1;
+volatile uint8_t _load_bar_d = 0;
+volatile uint8_t _load_bar_b = 0;
+#endif
+
+/**
+ * The main loop starts and stops waiting; called by the delay functions
+ */
+void load_wait_begin() {
+  // Only the outer wait counts when a wait runs from a background task of another
+  if(load_waiting++) return;
+  load_wait_start_us = heart_micros();
+}
+
+void load_wait_end() {
+  if(--load_waiting) return;
+  load_wait_us += heart_micros() - load_wait_start_us;
+}
+
+/**
+ * Sum of a share over all slots
+ */
+static uint16_t load_sum(const uint8_t *shares) {
+  uint16_t sum = 0;
+  for(uint8_t s = 0; s < LOAD_SLOTS; s++) sum += shares[s];
+  return sum;
+}
+
+/**
+ * Share of the CPU time in % over the last LOAD_SLOTS slots: in the ISR, in the animations and waiting
+ */
+uint8_t load_isr_pct() {
+  return (uint32_t)load_sum(load_isr) * 100 / (255 * LOAD_SLOTS);
+}
+
+uint8_t load_idle_pct() {
+  return (uint32_t)load_sum(load_idle) * 100 / (255 * LOAD_SLOTS);
+}
+
+uint8_t load_main_pct() {
+  return 100 - (uint32_t)(load_sum(load_isr) + load_sum(load_idle)) * 100 / (255 * LOAD_SLOTS);
+}
+
+/**
+ * Show the bar on the LEDs (1) or the animation (0); only with SUPPORT_LOAD_BAR
+ */
+#ifdef SUPPORT_LOAD_BAR
+void load_bar_show(uint8_t show) {
+  _load_bar = show;
+}
+#else
+void load_bar_show(uint8_t /* show */) {}
+#endif
+
+/**
+ * Background task for the main loop: closes a slot every LOAD_SLOT_MS and updates the bar
+ */
+void load_service() {
+  const uint32_t now = heart_micros();
+  const uint32_t wall = now - load_slot_us;
+  if(wall < LOAD_SLOT_MS * 1000UL) return;
+
+  // This runs from yield(), usually while waiting: close the part of the wait in this slot
+  if(load_waiting) {
+    load_wait_us += now - load_wait_start_us;
+    load_wait_start_us = now;
+  }
+
+  uint32_t busy, total;
+  uint8_t sreg = SREG;
+  cli();
+  busy = _load_busy;
+  total = _load_total;
+  _load_busy = 0;
+  _load_total = 0;
+  SREG = sreg;
+
+  // Shares in 1/255; the ISR takes the same share of the waits as of the rest. Long slots (when the main loop did not
+  // yield for seconds) are scaled down first to keep the products in 32 bits
+  uint32_t wait = (load_wait_us < wall) ? load_wait_us : wall;
+  uint32_t span = wall;
+  if(total > 0x00FFFFFFUL) { busy >>= 8; total >>= 8; }
+  if(span > 0x00FFFFFFUL) { wait >>= 8; span >>= 8; }
+  const uint8_t isr = (total == 0) ? 0 : (busy >= total) ? 255 : busy * 255 / total;
+  const uint8_t idle = (uint16_t)(wait * 255 / span) * (255 - isr) / 255;
+  load_isr[load_slot] = isr;
+  load_idle[load_slot] = idle;
+  load_slot = (load_slot + 1) % LOAD_SLOTS;
+  load_slot_us = now;
+  load_wait_us = 0;
+
+#ifdef SUPPORT_LOAD_BAR
+  // Busy share rounded up to the next 10%, one LED each from LED 0 (the bottom tip)
+  const uint8_t leds = (100 - load_idle_pct() + 9) / 10;
+  const uint16_t lit = (1 << leds) - 1;
+  _load_bar_d = (lit << PIN_LED_START) & LOAD_BAR_PORTD_MASK;
+  _load_bar_b = (lit >> (8 - PIN_LED_START)) & LOAD_BAR_PORTB_MASK;
+#endif
+}
+
+#else
+// *** No load meter ***
+
+/**
+ * The main loop starts and stops waiting; called by the delay functions
+ */
+void load_wait_begin() {}
+void load_wait_end() {}
+
+/**
+ * Share of the CPU time in % over the last LOAD_SLOTS slots: in the ISR, in the animations and waiting
+ */
+uint8_t load_isr_pct() { return 0; }
+uint8_t load_main_pct() { return 0; }
+uint8_t load_idle_pct() { return 0; }
+
+/**
+ * Show the bar on the LEDs (1) or the animation (0); only with SUPPORT_LOAD_BAR
+ */
+void load_bar_show(uint8_t /* show */) {}
+
+/**
+ * Background task for the main loop: closes a slot every LOAD_SLOT_MS and updates the bar
+ */
+void load_service() {}
+
+#endif
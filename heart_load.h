@@ -0,0 +1,82 @@
+/**
+ * heart_load.h - Heart PCB Project - CPU load meter: time in the ISR, in the animations and waiting
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.13
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_LOAD_H_
+#define _HEART_LOAD_H_
+
+#include "heart_settings.h"
+
+/**
+ * The CPU time is split in three:
+ *   isr  - the LED interrupt; it adds the Timer1 counts of every tick to _load_busy and the length of the tick to
+ *          _load_total, so the share holds at any timer interval or CPU clock
+ *   idle - waiting in heart_delay(), heart_delay_until() and heart_delay_next(), including the background tasks in
+ *          yield() which run while waiting (they have to be short anyway)
+ *   main - the rest: the animations computing their next step
+ * The interrupt runs at a fixed rate, so it takes the same share of the waits as of the rest of the time.
+ *
+ * Every LOAD_SLOT_MS the shares of the last slot are stored; the meter shows the average of the last LOAD_SLOTS slots.
+ * With SUPPORT_LOAD_BAR the LEDs show the busy share (isr + main) as a bar instead of the animation, 10% per LED from
+ * the bottom tip; the animation keeps running, so its load is what the bar shows.
+ */
+
+#ifdef SUPPORT_LOAD_METER
+// Timer1 counts spent in the ISR and passed in total since the end of the last slot
+extern volatile uint32_t _load_busy;
+extern volatile uint32_t _load_total;
+
+// Add the duration of a tick to the ISR time
+#define LOAD_ACCOUNT(__counts) { _load_busy += (__counts); _load_total += 2 * ICR1; }
+#else
+#define LOAD_ACCOUNT(__counts) {}
+#endif
+
+#ifdef SUPPORT_LOAD_BAR
+// Set while the LEDs show the bar; the masks have a set bit for a LED pin which is lit
+extern volatile uint8_t _load_bar;
+extern volatile uint8_t _load_bar_d, _load_bar_b;
+
+// Replace the PWM outputs of the animation by the bar; LEDs are active low
+#define LOAD_BAR_OVERRIDE(__pin0_7, __pin8_13) {                       \
+  if(_load_bar) {                                                      \
+    __pin0_7  = (__pin0_7 | LOAD_BAR_PORTD_MASK) & ~_load_bar_d;       \
+    __pin8_13 = (__pin8_13 | LOAD_BAR_PORTB_MASK) & ~_load_bar_b;      \
+  }                                                                    \
+}
+
+// All LED pins in PORTD (pin 2 to 7) and PORTB (pin 8 to 11)
+#define LOAD_BAR_PORTD_MASK 0xFC
+#define LOAD_BAR_PORTB_MASK 0x0F
+#else
+#define LOAD_BAR_OVERRIDE(__pin0_7, __pin8_13) {}
+#endif
+
+/**
+ * The main loop starts and stops waiting; called by the delay functions
+ */
+void load_wait_begin();
+void load_wait_end();
+
+/**
+ * Share of the CPU time in % over the last LOAD_SLOTS slots: in the ISR, in the animations and waiting
+ */
+uint8_t load_isr_pct();
+uint8_t load_main_pct();
+uint8_t load_idle_pct();
+
+/**
+ * Show the bar on the LEDs (1) or the animation (0); only with SUPPORT_LOAD_BAR
+ */
+void load_bar_show(uint8_t show);
+
+/**
+ * Background task for the main loop: closes a slot every LOAD_SLOT_MS and updates the bar
+ */
+void load_service();
+
+#endif
\ No newline at end of file
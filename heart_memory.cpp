@@ -0,0 +1,78 @@
+/**
+ * heart_memory.cpp - Heart PCB Project - Stack painting to find how close the stack came to the static variables
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.12
+ * @license GNUGPLv3
+ */
+
+#include "heart_memory.h"
+
+uint16_t memory_static = 0;
+uint16_t memory_stack_free_min = 0xFFFF;
+
+#ifdef SUPPORT_STACK_CHECK
+#include "heart_time.h"
+#include "heart_eeprom.h"
+
+// Symbols of the linker script: start of .data, end of .bss and the top of the SRAM
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+
+uint32_t memory_check_ms = 0;   // Time of the last check
+uint8_t  memory_logged = 0;     // Set when the low margin was logged
+
+/**
+ * Paint the SRAM between the variables and the top; runs from the startup code before the variables are initialised,
+ * when the stack is still empty. It can not have a stack frame or return, so it is naked and sits in a section which
+ * runs straight into the next.
+ */
+void memory_paint() __attribute__ ((naked, used, section(".init3")));
+void memory_paint() {
+  for(uint8_t *p = &_end; p <= &__stack; p++) *p = STACK_PAINT;
+}
+
+/**
+ * Scan the paint for the smallest free stack margin since boot; takes about 4 cycles per free byte
+ */
+uint16_t memory_stack_free() {
+  const uint8_t *p = &_end;
+  while(p <= &__stack && *p == STACK_PAINT) p++;
+  const uint16_t margin = p - &_end;
+  memory_static = &_end - &__data_start;
+  if(margin < memory_stack_free_min) memory_stack_free_min = margin;
+  return memory_stack_free_min;
+}
+
+/**
+ * Background task for the main loop: checks the margin every STACK_CHECK_MS and logs an error once when it is below
+ * STACK_RESERVE
+ */
+void memory_service() {
+  const uint32_t now = heart_millis();
+  if(now - memory_check_ms < STACK_CHECK_MS) return;
+  memory_check_ms = now;
+
+  if(memory_stack_free() < STACK_RESERVE && !memory_logged) {
+    memory_logged = 1;
+    eeprom_error_log(ERR_STACK_LOW);
+  }
+}
+
+#else
+// *** No stack check ***
+
+/**
+ * Scan the paint for the smallest free stack margin since boot; takes about 4 cycles per free byte
+ */
+uint16_t memory_stack_free() { return memory_stack_free_min; }
+
+/**
+ * Background task for the main loop: checks the margin every STACK_CHECK_MS and logs an error once when it is below
+ * STACK_RESERVE
+ */
+void memory_service() {}
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * heart_memory.h - Heart PCB Project - Stack painting to find how close the stack came to the static variables
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.12
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_MEMORY_H_
+#define _HEART_MEMORY_H_
+
+#include "heart_settings.h"
+
+/**
+ * The SRAM holds the static variables (.data and .bss) from the bottom up and the stack from the top down; the space in
+ * between is all there is for the deepest call chain plus the interrupts nesting on top of it. Before the variables are
+ * initialised, all SRAM above them is filled with STACK_PAINT. The stack overwrites the paint as it grows, so the paint
+ * left directly above the variables is the smallest margin the stack ever had.
+ *
+ * The firmware does not use the heap (malloc, new or String); if it did, the heap would count as used stack.
+ *
+ * tools/sram_report.py lists the static variables of a build per module.
+ */
+
+// Value the free SRAM is painted with
+#define STACK_PAINT 0xC5
+
+// Bytes of static variables (.data and .bss)
+extern uint16_t memory_static;
+
+// Smallest free stack margin in bytes found so far; 0xFFFF before the first check
+extern uint16_t memory_stack_free_min;
+
+/**
+ * Scan the paint for the smallest free stack margin since boot; takes about 4 cycles per free byte
+ */
+uint16_t memory_stack_free();
+
+/**
+ * Background task for the main loop: checks the margin every STACK_CHECK_MS and logs an error once when it is below
+ * STACK_RESERVE
+ */
+void memory_service();
+
+#endif
\ No newline at end of file
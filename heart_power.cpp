@@ -0,0 +1,82 @@
+/**
+ * heart_power.cpp - Heart PCB Project - Supply current estimation and limiting
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.18
+ * @license GNUGPLv3
+ */
+
+#include "heart_power.h"
+#include "heart_isr.h"
+#include "heart_clock.h"
+#include "heart_time.h"
+
+uint16_t power_ma  = 0; // Estimated supply current in mA
+uint16_t power_mah = 0; // Charge used since boot in mAh
+
+#ifdef SUPPORT_POWER_LIMIT
+#include "Arduino.h"
+
+// Charge of 1 mAh expressed in mA * ms
+#define POWER_MAMS_PER_MAH 3600000UL
+
+const uint8_t power_led_ma [NUM_LEDS] PROGMEM = LED_CURRENT_MA;
+
+volatile uint16_t _power_duty_sum = 0;
+volatile uint16_t _power_min_inc  = 0;
+
+uint32_t power_last_ms = 0;   // Time of the last update
+uint32_t power_charge  = 0;   // Charge in mA * ms which did not add up to a full mAh yet
+
+/**
+ * Background task for the main loop: updates the current estimate, the charge and the dimming factor.
+ */
+void power_service() {
+  const uint32_t now = heart_millis();
+  const uint32_t dt = now - power_last_ms;
+  const uint8_t base_ma = POWER_BASE_MA - clock_saved_ma(); // The CPU draws less at a lower clock
+  uint16_t sum, pwm_inc, target, inc;
+  uint8_t sreg;
+
+  if(dt < POWER_UPDATE_MS) return;
+  power_last_ms = now;
+
+  sreg = SREG;
+  cli();
+  sum = _power_duty_sum;
+  pwm_inc = _pwm_thr_inc;
+  SREG = sreg;
+
+  // Smallest increment which keeps the LED current within the budget: sum / inc <= budget
+  target = sum / (POWER_BUDGET_MA - base_ma);
+
+  // Move the limit gradually to avoid visible steps: dim quickly, recover slowly
+  inc = _power_min_inc;
+  if(target > inc) {
+    inc += (target - inc + 3) / 4;
+  } else {
+    inc -= (inc - target) / 16;
+  }
+  _power_min_inc = inc;
+
+  // Estimate the current with the increment the ISR uses in the current PWM period
+  power_ma = sum / pwm_inc + base_ma;
+
+  // Integrate the charge
+  power_charge += (uint32_t)power_ma * dt;
+  while(power_charge >= POWER_MAMS_PER_MAH) {
+    power_charge -= POWER_MAMS_PER_MAH;
+    power_mah++;
+  }
+}
+
+#else
+// *** No power limit support ***
+
+/**
+ * Background task for the main loop: updates the current estimate, the charge and the dimming factor.
+ */
+void power_service() {}
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * heart_power.h - Heart PCB Project - Supply current estimation and limiting
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.18
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_POWER_H_
+#define _HEART_POWER_H_
+
+#include "heart_settings.h"
+#include <avr/pgmspace.h>
+
+/**
+ * The current is estimated from a running sum of the brightness of all LEDs, weighted with the current per channel.
+ * The sum is updated by the SET_LED_BRIGHTNESS macros when a brightness changes, so there is no cost per PWM tick.
+ * The PWM compare threshold increment scales the brightness by 256/inc, so the LED current is sum / inc mA. Limiting
+ * the current to a budget is therefore a lower bound on the increment which the ISR applies at the start of a period.
+ */
+
+// Current per LED channel in mA when fully on
+extern const uint8_t power_led_ma [NUM_LEDS] PROGMEM;
+
+// Sum of brightness (0-255) times current per channel, in mA/256 at full brightness
+extern volatile uint16_t _power_duty_sum;
+
+// Lower bound for the PWM threshold increment to stay within the current budget, 0 when not limiting
+extern volatile uint16_t _power_min_inc;
+
+// Estimated supply current in mA and the charge used since boot in mAh, updated every POWER_UPDATE_MS
+extern uint16_t power_ma;
+extern uint16_t power_mah;
+
+/**
+ * Background task for the main loop: updates the current estimate, the charge and the dimming factor.
+ */
+void power_service();
+
+#ifdef SUPPORT_POWER_LIMIT
+  // Update the weighted duty sum for a new brightness of a LED; the sum is shared by the ISR and the main loop
+  #define POWER_ACCOUNT(__led, __major) {                                                                   \
+    const uint8_t __sreg = SREG;                                                                          \
+    cli();                                                                                                \
+    _power_duty_sum += (int16_t)pgm_read_byte(&power_led_ma[__led]) *                                     \
+                       ((int16_t)(__major) - (int16_t)_led_brightness[__led].major);                      \
+    SREG = __sreg;                                                                                        \
+  }
+  // Apply the current limit to the PWM threshold increment
+  #define POWER_LIMIT_INC(__inc) { if((__inc) < _power_min_inc) (__inc) = _power_min_inc; }
+#else
+  #define POWER_ACCOUNT(__led, __major) {}
+  #define POWER_LIMIT_INC(__inc) {}
+#endif
+
+#endif
\ No newline at end of file
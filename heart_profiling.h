@@ -10,6 +10,7 @@
 #define _HEART_PROFILING_H_
 
 #include "heart_settings.h"
+#include "heart_time.h"
 
 #ifdef SUPPORT_MEASUREMENTS
 
@@ -28,9 +29,9 @@
 
 #if 1
   // Classical profiling: record a number of entry and exit times and print them after a while
-  #define MEASUREMENT_INIT  { Serial.begin(9600); SERPRINTLN("Profiling active"); delay(100); }
-  #define MEASUREMENT_START { if(measure_start < NUM_MEASUREMENTS) { starts[measure_start] = micros(); measure_start++; }}
-  #define MEASUREMENT_STOP  { if(measure_stop < NUM_MEASUREMENTS) { stops[measure_stop] = micros(); measure_stop++; }}
+  #define MEASUREMENT_INIT  { Serial.begin(SERIAL_BAUD); SERPRINTLN("Profiling active"); delay(100); }
+  #define MEASUREMENT_START { if(measure_start < NUM_MEASUREMENTS) { starts[measure_start] = heart_micros(); measure_start++; }}
+  #define MEASUREMENT_STOP  { if(measure_stop < NUM_MEASUREMENTS) { stops[measure_stop] = heart_micros(); measure_stop++; }}
   #define MEASUREMENT_PRINT { if(measure_stop >= NUM_MEASUREMENTS && measure_stop != 255) { \
     unsigned long mindur, maxdur, minival, maxival;                                         \
     measure_stop = 255;                                                                     \
@@ -58,12 +59,12 @@
   // Continuous profiling: only capture the bounds
   #define NUM_CMEASUREMENTS 30000
   
-  #define MEASUREMENT_INIT  { Serial.begin(9600); SERPRINTLN("Profiling active"); delay(100); starts[0] = 0; starts[1] = 0; starts[2] = 0; starts[3] = 0; starts[4] = 0; starts[5] = 0; starts[6] = 0; }
+  #define MEASUREMENT_INIT  { Serial.begin(SERIAL_BAUD); SERPRINTLN("Profiling active"); delay(100); starts[0] = 0; starts[1] = 0; starts[2] = 0; starts[3] = 0; starts[4] = 0; starts[5] = 0; starts[6] = 0; }
   
   // 0 = lower bound duration, 1 = upper bound duration, 2 = lower bound interval, 
   // 3 = upper bound interval, 4 = last start time, 5 = start count, 6 = stop count
   #define MEASUREMENT_START if(measure_start < NUM_CMEASUREMENTS) {                         \
-    unsigned long curtime = micros(), ival;                                                 \
+    unsigned long curtime = heart_micros(), ival;                                           \
     starts[5]++;  /* Update start count */                                                  \
     ival = curtime - starts[4]; /* Compute interval */                                      \
     if(measure_start > 2) { /* After startup, do interval bound tracking */                 \
@@ -80,7 +81,7 @@
   }
 
   #define MEASUREMENT_STOP {if(measure_stop < NUM_CMEASUREMENTS) {                          \
-    unsigned long curtime = micros(), dur;                                                  \
+    unsigned long curtime = heart_micros(), dur;                                            \
     starts[6]++; /* Update stop count */                                                    \
     dur = curtime - starts[4]; /* Compute duration */                                       \
     if(measure_start > 1) { /* After startup, do interval bound tracking */                 \
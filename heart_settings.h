@@ -22,6 +22,88 @@
 // Comment out when not debugging the project!
 //#define SUPPORT_ISR_MEASUREMENTS
 
+// Define to record the spread of the PWM interrupt entry: the Timer1 count when the ISR starts is the delay since the
+// tick was due in CPU cycles, so its spread is the jitter of the PWM edges. The 'c' command prints the lowest and highest
+// since the previous 'c'; compare a build with and without SUPPORT_TICK_TIME for the jitter of the Timer0 interrupt.
+// Adds about 20 cycles to every tick.
+//#define SUPPORT_ISR_JITTER
+
+// Define to stream binary telemetry frames (LED brightness, active faders, animation and error code) over the serial port.
+// Use tools/telemetry.py on the host to decode, record or plot the stream.
+//#define SUPPORT_TELEMETRY
+
+// Number of telemetry frames per second; each frame is TELEMETRY_FRAME_LEN (19) bytes
+// Default: 50
+#define TELEMETRY_FREQ 50
+
+// Define to enable the serial command interface to switch animations, change settings and tune animation parameters
+// on a live board. See heart_command.h for the commands.
+//#define SUPPORT_COMMANDS
+
+// Number of received bytes the command interface processes per call from the main loop; keeps the time slice short
+// Default: 8
+#define COMMAND_BYTES_PER_CALL 8
+
+// Free bytes the serial transmit buffer needs before the command interface prints the next line of a listing ('p',
+// 'c', 'e' and 't' print one line per call from the main loop), so printing never waits for the port; the longest line
+// is about 35 bytes. Must stay below the size of the transmit buffer (64 bytes).
+// Default: 40
+#define COMMAND_OUT_ROOM 40
+
+// Define to let the host stream LED frames over the serial port (needs SUPPORT_COMMANDS); see tools/stream.py.
+// Receiving a frame switches to the streaming mode, it ends when no frames are received for STREAM_TIMEOUT_MS.
+//#define SUPPORT_STREAM
+
+// Frame rate of the stream; frames are shown at the start of a PWM period so this should divide TIMER_FREQ
+// Default: 100
+#define STREAM_FPS 100
+
+// Size of the jitter buffer in frames (power of 2) and number of frames to buffer before playback (re)starts
+// Default: 4 and 2
+#define STREAM_BUFFER_FRAMES 4
+#define STREAM_PREFILL_FRAMES 2
+
+// Leave the streaming mode when no frames were received for this many milliseconds
+// Default: 1000
+#define STREAM_TIMEOUT_MS 1000
+
+// ------------------------- Sync Settings ----------------------------
+
+// Define to synchronise multiple hearts over a serial daisy chain: TX of one heart goes to RX of the next. The heart
+// which does not receive sync frames (the first in the chain) is the master, the others follow its time base and
+// animation and relay the frames to the next heart. Uses the serial port, so it can not be combined with the telemetry,
+// command and streaming support. See tools/sync_sim.py to simulate a chain on a PC.
+//#define SUPPORT_SYNC
+
+// Interval in ms between two sync frames sent by the master; a frame is also sent when the master starts an animation
+// Default: 100
+#define SYNC_INTERVAL_MS 100
+
+// A heart becomes master when it did not receive a sync frame for this many milliseconds
+// Default: 1000
+#define SYNC_TIMEOUT_MS 1000
+
+// Number of sync frames over which the time offset is filtered: the frame which was processed with the least delay is
+// used for the correction
+// Default: 4
+#define SYNC_FILTER_FRAMES 4
+
+// When the time offset is off by more than this many us, it is corrected at once instead of gradually
+// Default: 10000
+#define SYNC_STEP_US 10000
+
+// ------------------------- Serial Settings ----------------------------
+
+// Baud rate for the serial port; telemetry and streaming need a high rate to keep the time spent in the serial
+// interrupt short and to carry the frames (23 bytes per frame, 2300 bytes per second at 100 fps).
+// Sync uses the high rate to keep the transmission delay per heart short (14 bytes take 280 us).
+// Note: at 16 MHz, 500000 and 1000000 baud have no rate error
+#if defined(SUPPORT_TELEMETRY) || defined(SUPPORT_STREAM) || defined(SUPPORT_SYNC)
+#define SERIAL_BAUD 500000
+#else
+#define SERIAL_BAUD 9600
+#endif
+
 // ------------------------- LED Settings ----------------------------
 
 // When fading in up to a new lower bound on the LED brightness, use this speed for all animations.
@@ -29,30 +111,92 @@
 // Default: 5
 #define SETUP_FADE_SPEED_MAJOR 5
 
+// Number of global brightness levels selectable with the brightness button; the levels are spaced evenly in perceived
+// brightness (CIE lightness), see BRIGHTNESS_THR_INC in heart_isr.cpp
+#define NUM_BRIGHTNESS_LEVELS 6
+
 // GPIO pin to LED mapping; by default LED0 is connected to pin 2, LED1 to pin 3 etc.
 // !!!WARNING!!!: DO NOT CHANGE THESE SETTINGS AS THE INTERRUPT LOGIC IS HARDCODED TO THE ORIGINAL SETTINGS
 #define PIN_LED_START 2
-#define NUM_LEDS 10
 #define PIN_LED_END (PIN_LED_START+NUM_LEDS)
 
+// ------------------------- Shift Register Settings ----------------------------
+// Define to drive the LEDs through a chain of 74HC595 shift registers on the hardware SPI port instead of the pins, for
+// hearts with more LEDs: SER on MOSI (pin 11), SRCLK on SCK (pin 13), RCLK on pin 10 and OE tied low. Channel 0 is
+// output QA of the first register in the chain. Bit-plane modulation replaces the PWM, see heart_shift.h.
+// Can not be combined with SUPPORT_PWM_TAIL, SUPPORT_LOAD_BAR, SUPPORT_TELEMETRY and SUPPORT_STREAM.
+//#define SUPPORT_SHIFT_OUT
+
+// Number of channels in the chain, a multiple of 8 from 16 to 64. Default: 32
+#ifndef SHIFT_CHANNELS
+#define SHIFT_CHANNELS 32
+#endif
+
+// Define when a high output turns the LED on; by default the outputs sink the LED current like the pins on the original
+// board (active low)
+//#define SHIFT_ACTIVE_HIGH
+
+// Number of LEDs (channels) the animations and faders drive
+#ifdef SUPPORT_SHIFT_OUT
+#define NUM_LEDS SHIFT_CHANNELS
+#else
+#define NUM_LEDS 10
+#endif
+
 // ---------------------------- Demo Settings --------------------------------
 // Set this to the number of seconds before automatically switching effects (only when demo mode is on)
 #define EFFECT_DURATION_S 20
 
+// ---------------------------- Wave Settings --------------------------------
+// Interval in ms between two frames of the wave animations. Default: 20
+#define WAVE_FRAME_MS 20
+
+// Number of seconds every wave effect is shown before the next one. Default: 10
+#define WAVE_EFFECT_S 10
+
+// ---------------------------- Frame Sequence Settings --------------------------------
+// Number of seconds every recorded sequence (heart_frames_data.h) is played, looping when it is shorter. Default: 12
+#define FRAMES_SEQUENCE_S 12
+
 // ---------------------------- Button Settings --------------------------------
+// Both buttons have to be on pin 8 to 13; the shift registers use pin 10, 11 and 13
+#ifdef SUPPORT_SHIFT_OUT
+#define PIN_BTN0 9
+#else
 #define PIN_BTN0 13
+#endif
 #define PIN_BTN1 12
 
+// Time in ms a button has to be held down before it counts as a hold instead of a click. Default: 1000
+#define BUTTON_HOLD_MS 1000
+
+// While a button stays held down, the hold level goes up every this many ms (button 0 uses it to step through the demo
+// mode settings). Default: 2500
+#define BUTTON_HOLD_STEP_MS 2500
+
+// A second press within this many ms of the first counts as a double click. Default: 400
+#define BUTTON_DOUBLE_MS 400
+
+// Number of entries in the queue of events from the ISR to the main loop, must be a power of 2. Default: 8
+#define EVENT_QUEUE_SIZE 8
+
 // ------------------------- PWM and fader Settings ----------------------------
 
+// Note: TIMER_FREQ and FADER_UPDATE_FREQ can be set on the compiler command line, tools/pwm_sweep.py uses this to try
+// many combinations
+
 // PWM frequency, setting this to 100 means PWM_STEPS * 100 calls per second to callback() to update the PWM, and LEDs will turn off and on 100 times a second
 // More is better (prevents flicker), but too high will eat up CPU without leaving time for the animation resulting in choppy animations
 // Default: 75 Hz
+#ifndef TIMER_FREQ
 #define TIMER_FREQ 100
+#endif
 
 // Fader update frequency, setting this to 10 means a fade in or out is updated 10 times per second. Note that changing this setting changes the speed of a fade.
 // Note: since the PWM frequency and length dictates the timer interval, this setting will be converted in a derrived frequency.
+#ifndef FADER_UPDATE_FREQ
 #define FADER_UPDATE_FREQ 15
+#endif
 
 // DO NOT CHANGE - PWM length - note: should be a power of 2 and matching of the type of _pwm_step
 #define PWM_STEPS 255
@@ -69,12 +213,167 @@
 // needed to prevent nested interrupts from occuring. Note that only when SUPPORT_NESTED_ISR is defined, is it possible to get nested interrupts, without it ticks of the timer will simply be skipped.
 #define ISR_MINIMUM_INTERVAL_US 34
 
+// Define to shorten the number of interrupts per PWM period when the global brightness is dimmed: once all LEDs are off
+// for the rest of the period, the remaining ticks are done in a few long timer intervals of up to PWM_TAIL_MAX_TICKS ticks.
+// The threshold saturates after 65536 / BRIGHTNESS_THR_INC steps (heart_isr.cpp), the rest of the 256 ticks takes
+// (256 - steps) / PWM_TAIL_MAX_TICKS long ticks, rounded up: 52 + 4, 24 + 4 and 8 + 4 interrupts per period at the three
+// dimmest levels instead of 256 (once per fader interval one more, as a long tick ends on the button tick at the latest),
+// leaving more CPU time for the animations.
+//#define SUPPORT_PWM_TAIL
+
+// Maximum number of ticks covered by one long interval; the timer TOP (8 counts per us) times this has to fit in 16 bits
+// Default: 64
+#define PWM_TAIL_MAX_TICKS 64
+
 // This define is only needed during development and benchmarking of the ISR (interrupt routine) to enable nested interrupts; after development it should be disabled
 //#define SUPPORT_NESTED_ISR
 
-// Compute how many ISR fader ticks (which happen once every 255 ISR calls) make up the duration of the demo mode delay between effects
-// FIXME also this is off by a factor 6
-#define TIMER_DEMO_CNT_MAX (uint32_t)(((uint64_t)EFFECT_DURATION_S * 1000000 * 6) / ((uint64_t)FADER_UPDATE_INTERVAL_US))
+// Compute how many ISR fader ticks (the demo timer counts once per fader interval) make up the duration of the demo mode delay between effects
+// The fader interval is a third of FADER_UPDATE_INTERVAL_US, see the FIXME of FADER_UPDATE_TICKS
+#define TIMER_DEMO_CNT_MAX (uint32_t)(((uint64_t)EFFECT_DURATION_S * 1000000 * 3) / ((uint64_t)FADER_UPDATE_INTERVAL_US))
+
+// ------------------------- Time Settings ----------------------------
+
+// Define to keep time by counting the PWM ticks of Timer1 instead of using millis() and micros(): Timer0 and its
+// interrupt (every 1024 us) are stopped so they can no longer delay a PWM tick, which shows as shimmer on dim LEDs.
+// The resolution of heart_millis() stays 1 ms and heart_micros() reads the position of Timer1 within the tick.
+// Can not be combined with the governor, which changes the length of a tick.
+//#define SUPPORT_TICK_TIME
+
+// Define to keep Timer0 running with SUPPORT_TICK_TIME, for code which still uses millis(), micros() or delay()
+//#define TIME_KEEP_TIMER0
+
+// ------------------------- PWM Governor Settings ----------------------------
+
+// Define to adapt the timer interval (and thereby the PWM frequency) at run-time: the ISR load is measured and the interval
+// is shortened as long as there is enough CPU time left for the animations, and lengthened when ISR ticks are missed.
+// The fader update interval is adjusted along with it so fades keep the same speed.
+//#define SUPPORT_GOVERNOR
+
+// Bounds for the timer interval in us; the governor starts at TIMER_INTERVAL_US. The lower bound can not be below
+// ISR_MINIMUM_INTERVAL_US, a shorter interval is shorter than the ISR itself takes with a fader update.
+// Default: ISR_MINIMUM_INTERVAL_US (34, 115 Hz) and 65 (60 Hz)
+#define GOVERNOR_MIN_INTERVAL_US ISR_MINIMUM_INTERVAL_US
+#define GOVERNOR_MAX_INTERVAL_US 65
+
+// Percentage of the CPU time to keep free for the main loop; the ISR may use the rest
+// Default: 40
+#define GOVERNOR_RESERVE_PCT 40
+
+// The interval is only shortened when the predicted ISR load stays this many percent below the limit, to prevent hunting
+// Default: 5
+#define GOVERNOR_HYSTERESIS_PCT 5
+
+// When the main loop does not get to run for this long (the time between two calls to yield()), the interval is lengthened
+// Default: 30
+#define GOVERNOR_MAX_GAP_MS 30
+
+// Interval in ms between two governor decisions, each decision changes the timer interval by at most 1 us
+// Default: 250
+#define GOVERNOR_UPDATE_MS 250
+
+// ------------------------- Clock Settings ----------------------------
+
+// Define to lower the CPU clock when the work allows it, to save power on battery packs: the ISR load and the longest
+// ISR tick are measured and the clock is halved (down to F_CPU / CLOCK_MAX_DIVIDER) as long as they would stay within
+// the limits below at the lower clock. The timer, the time keeping, the baud rate and the ADC are adjusted along with
+// the clock so the LEDs and the animations look the same. Can not be combined with the governor or the measurements.
+//#define SUPPORT_CLOCK_SCALING
+
+// Lowest clock as a divider of F_CPU: 2 (8 MHz) or 4 (4 MHz); 4 MHz still supports 500000 baud
+// Default: 4
+#define CLOCK_MAX_DIVIDER 4
+
+// Maximum ISR load in percent of the CPU time, and maximum length of an ISR tick in percent of the timer interval,
+// predicted for the lower clock before it is selected; above either the clock is raised again
+// Default: 50 and 70
+#define CLOCK_MAX_LOAD_PCT 50
+#define CLOCK_MAX_PEAK_PCT 70
+
+// When the main loop does not get to run for this long (the time between two calls to yield()), the clock is raised
+// Default: 30
+#define CLOCK_MAX_GAP_MS 30
+
+// Interval in ms between two clock decisions
+// Default: 500
+#define CLOCK_UPDATE_MS 500
+
+// Current drawn by the CPU in mA at F_CPU, F_CPU / 2 and F_CPU / 4 (ATmega328P at 5 V, from the datasheet), used to
+// estimate the supply current in each mode; the rest of the board is in POWER_BASE_MA
+#define CLOCK_MCU_MA { 9, 5, 3 }
+
+// ------------------------- Power Settings ----------------------------
+
+// Define to estimate the supply current from the LED brightness and dim all LEDs when it would exceed POWER_BUDGET_MA
+//#define SUPPORT_POWER_LIMIT
+
+// Current per LED channel in mA when fully on: the groups of 2 LEDs in series with 47 Ohm draw about 21 mA, the single
+// LEDs with 150 Ohm (the bottom and top center, LED 0 and 5) about 20 mA. With SUPPORT_SHIFT_OUT list every channel,
+// missing ones count as 0 mA
+#define LED_CURRENT_MA { 20, 21, 21, 21, 21, 20, 21, 21, 21, 21 }
+
+// Current drawn by the rest of the board (Arduino Pro Mini, power LED) in mA, including the CPU running at F_CPU
+#define POWER_BASE_MA 15
+
+// Maximum supply current in mA; all LEDs are dimmed smoothly when the estimate exceeds this
+// Default: 150
+#define POWER_BUDGET_MA 150
+
+// Interval in ms at which the current estimate and the dimming factor are updated
+#define POWER_UPDATE_MS 10
+
+// ------------------------- Audio Settings ----------------------------
+
+// Define to let the beating heart animation pulse with music: a microphone module (with amplifier, biased at half the
+// supply like a MAX4466 or MAX9814 board) on a spare analog input is sampled in the background by the ADC. Every detected
+// bass drum beat starts a beat of the heart, the loudness sets how bright it gets. See tools/audio_host.cpp to run the
+// detector on recorded sound on a PC.
+//#define SUPPORT_AUDIO
+
+// ADC channel of the microphone (0 is A0)
+// Default: 0
+#define AUDIO_ADC_CHANNEL 0
+
+// The ADC runs freely at 16 MHz / 128 / 13 = 9615 Hz; this many readings are summed into one sample, which filters the
+// high frequencies and gives a sample rate of 1202 Hz
+// Default: 8
+#define AUDIO_DECIMATION 8
+
+// Samples per detection block (26.6 ms) and the Goertzel bin within the block which is checked for beats: bin k covers
+// k * 1202 / AUDIO_BLOCK_SAMPLES Hz, bin 2 is 75 Hz (about 40 to 110 Hz) where the bass drum is
+// Default: 32 and 2
+#define AUDIO_BLOCK_SAMPLES 32
+#define AUDIO_BEAT_BIN 2
+
+// A beat is detected when the power in the beat bin exceeds its average by this factor, in 1/16 (24 is 1.5 times as high)
+// Default: 24
+#define AUDIO_BEAT_RATIO_Q4 24
+
+// Minimum power in the beat bin for a beat, filters out the noise when it is quiet; a tone with an amplitude of A ADC
+// steps gives a power of about 256 * A^2
+// Default: 2048
+#define AUDIO_BEAT_FLOOR 2048
+
+// Minimum time between two beats in ms
+// Default: 200
+#define AUDIO_BEAT_HOLDOFF_MS 200
+
+// Minimum loudness (sum of the absolute deviation over a block, about 20 * A for a tone of A ADC steps) to consider
+// the music playing; below it the animations use their own timing
+// Default: 64
+#define AUDIO_LEVEL_FLOOR 64
+
+// Number of samples buffered between the ADC interrupt and the detector in the main loop (power of 2)
+// Default: 16
+#define AUDIO_BUFFER_SAMPLES 16
+
+// DO NOT CHANGE - Rate of the ADC readings in Hz: prescaler 128 and 13 ADC clocks per conversion (clock scaling keeps it)
+#define AUDIO_ADC_HZ (F_CPU / 128 / 13)
+
+// DO NOT CHANGE - Length of a detection block in ms and the number of blocks for the beat hold-off and to detect silence (1 s)
+#define AUDIO_BLOCK_MS ((uint32_t)AUDIO_BLOCK_SAMPLES * AUDIO_DECIMATION * 1000 / AUDIO_ADC_HZ)
+#define AUDIO_BEAT_HOLDOFF_BLOCKS (AUDIO_BEAT_HOLDOFF_MS / AUDIO_BLOCK_MS)
+#define AUDIO_ACTIVE_BLOCKS (1000 / AUDIO_BLOCK_MS)
 
 // ------------------------- Error Mode Settings ----------------------------
 
@@ -99,12 +398,72 @@
 #define ERR_ISR_ERROR 3
 // Code 4 - The PWM frequency is set too high resulting in an ISR interval which is lower than the known working limit
 #define ERR_ISR_INTERVAL_TOO_SMALL 4
+// Code 5 - The board was reset by the watchdog; only written to the error log, it does not switch to error mode
+#define ERR_WATCHDOG 5
+// Code 6 - The free stack margin fell below STACK_RESERVE; only written to the error log (once per boot)
+#define ERR_STACK_LOW 6
+
+// ------------------------- Watchdog Settings ----------------------------
+
+// Define to enable the hardware watchdog: it is fed from the main loop, but only while the PWM ISR keeps running, so a
+// stuck main loop or a stalled timer resets the board. A watchdog reset is written to the error log.
+// Note: old bootloaders (before Optiboot) do not disable the watchdog after a reset and keep resetting the board
+//#define SUPPORT_WATCHDOG
+
+// Watchdog timeout, one of the WDTO_* constants from avr/wdt.h; has to be longer than the longest blocking section in
+// the main loop (printing at 9600 baud for example)
+// Default: WDTO_2S
+#define WATCHDOG_TIMEOUT WDTO_2S
+
+// ------------------------- Memory Settings ----------------------------
+
+// Define to paint the free SRAM at boot and track the smallest margin the stack left above the static variables; the
+// 'c' command shows it and a margin below STACK_RESERVE is written to the error log. Costs 9 bytes of SRAM.
+//#define SUPPORT_STACK_CHECK
+
+// Smallest acceptable free stack margin in bytes; interrupts nest on top of the deepest call chain. Default: 64
+#define STACK_RESERVE 64
+
+// Interval in ms between two scans of the paint (about 0.2 ms each with 800 free bytes). Default: 1000
+#define STACK_CHECK_MS 1000
+
+// ------------------------- Load Meter Settings ----------------------------
+
+// Define to measure the share of the CPU time spent in the LED interrupt, in the animations and waiting for the next
+// step; the 'c' command shows the shares. See heart_load.h.
+//#define SUPPORT_LOAD_METER
+
+// Define to show the busy share (interrupt and animations) on the LEDs as a bar instead of the animation, 10% per LED
+// from the bottom tip; the 'l' command switches between the bar and the animation. Needs SUPPORT_LOAD_METER.
+//#define SUPPORT_LOAD_BAR
+
+// Length of a measurement slot in ms and the number of slots the shares are averaged over. Default: 125 and 8
+#define LOAD_SLOT_MS 125
+#define LOAD_SLOTS 8
+
+// ------------------------- Trace Settings ----------------------------
+
+// Define to record what the ISR, the animations, the faders, the EEPROM writer and the buttons do, with the ISR tick
+// it happened at, in a ring buffer; the 't' command prints it for tools/trace_chrome.py. See heart_trace.h.
+//#define SUPPORT_TRACE
+
+// Number of records in the ring, 5 bytes of SRAM each; must be a power of 2. Default: 32
+#define TRACE_RECORDS 32
 
 // ------------------------- EEPROM Settings ----------------------------
 
 // Define to enable storing of settings in EEPROM - when not defined, the entire EEPROM library is excluded and all eeprom functions become stubs
 #define SUPPORT_EEPROM
 
+// Settings are only written to EEPROM once they did not change for this many milliseconds; changes made in the meantime
+// are combined into a single write. The write itself is done in the background by the EEPROM ready interrupt.
+// Default: 5000
+#define EEPROM_COMMIT_DELAY_MS 5000
+
+// Number of entries in the error log at the end of the EEPROM; the newest errors are kept, the oldest are overwritten
+// Note: changing this changes the EEPROM layout, change EEPROM_MAGIC in heart_eeprom.cpp as well
+// Default: 8
+#define ERROR_LOG_ENTRIES 8
 
 
 
@@ -124,6 +483,95 @@
 #error "FADER_UPDATE_FREQ is less than 3 times TIMER_FREQ (this means the fader will update way too often)"
 #endif
 
+#if defined(SUPPORT_STREAM) && !defined(SUPPORT_COMMANDS)
+#error "SUPPORT_STREAM needs SUPPORT_COMMANDS as the frames are received by the command interface"
+#endif
+
+#if defined(SUPPORT_SYNC) && (defined(SUPPORT_TELEMETRY) || defined(SUPPORT_COMMANDS) || defined(SUPPORT_MEASUREMENTS))
+#error "SUPPORT_SYNC uses the serial port for the sync frames, it can not be combined with telemetry, commands or measurements"
+#endif
+
+#if defined(SUPPORT_STREAM) && defined(SUPPORT_GOVERNOR)
+#error "SUPPORT_STREAM shows frames every fixed number of PWM periods, it can not be combined with SUPPORT_GOVERNOR"
+#endif
+
+#if defined(SUPPORT_CLOCK_SCALING) && (defined(SUPPORT_GOVERNOR) || defined(SUPPORT_MEASUREMENTS))
+#error "SUPPORT_CLOCK_SCALING changes the timer and the clock, it can not be combined with the governor or the measurements"
+#endif
+
+#if defined(SUPPORT_CLOCK_SCALING) && CLOCK_MAX_DIVIDER != 2 && CLOCK_MAX_DIVIDER != 4
+#error "CLOCK_MAX_DIVIDER should be 2 or 4"
+#endif
+
+#if defined(SUPPORT_TICK_TIME) && defined(SUPPORT_GOVERNOR)
+#error "SUPPORT_TICK_TIME needs ticks of a fixed length, it can not be combined with SUPPORT_GOVERNOR"
+#endif
+
+// Note: TIMER_INTERVAL_US contains casts which the preprocessor does not accept, so it is computed again here
+#if defined(SUPPORT_GOVERNOR) && (1000000 / (TIMER_FREQ * PWM_STEPS) < GOVERNOR_MIN_INTERVAL_US || 1000000 / (TIMER_FREQ * PWM_STEPS) > GOVERNOR_MAX_INTERVAL_US)
+#error "TIMER_FREQ results in a timer interval outside of GOVERNOR_MIN_INTERVAL_US and GOVERNOR_MAX_INTERVAL_US"
+#endif
+
+#if defined(SUPPORT_GOVERNOR) && GOVERNOR_MIN_INTERVAL_US < ISR_MINIMUM_INTERVAL_US
+#error "GOVERNOR_MIN_INTERVAL_US is below ISR_MINIMUM_INTERVAL_US, the ISR would not finish within its own interval"
+#endif
+
+#if defined(SUPPORT_TICK_TIME) && 1000000 / (TIMER_FREQ * PWM_STEPS) < ISR_MINIMUM_INTERVAL_US
+#error "TIMER_FREQ results in a timer interval below ISR_MINIMUM_INTERVAL_US, SUPPORT_TICK_TIME can not keep time in that error state"
+#endif
+
+#if defined(SUPPORT_PWM_TAIL) && PWM_TAIL_MAX_TICKS * 8 * (1000000 / (TIMER_FREQ * PWM_STEPS)) > 65535
+#error "PWM_TAIL_MAX_TICKS is too large for the timer interval, the long interval does not fit in Timer1"
+#endif
+
+#if defined(SUPPORT_PWM_TAIL) && defined(SUPPORT_GOVERNOR) && PWM_TAIL_MAX_TICKS * 8 * GOVERNOR_MAX_INTERVAL_US > 65535
+#error "PWM_TAIL_MAX_TICKS is too large for GOVERNOR_MAX_INTERVAL_US, the long interval does not fit in Timer1"
+#endif
+
+#if defined(SUPPORT_AUDIO) && AUDIO_BLOCK_SAMPLES * AUDIO_DECIMATION > 257
+#error "AUDIO_BLOCK_SAMPLES * AUDIO_DECIMATION is too large, the sum of a block does not fit in 16 bits"
+#endif
+
+#if defined(SUPPORT_AUDIO) && AUDIO_DECIMATION != 1 && AUDIO_DECIMATION != 2 && AUDIO_DECIMATION != 4 && AUDIO_DECIMATION != 8
+#error "AUDIO_DECIMATION must be 1, 2, 4 or 8, the samples are scaled back to 8 bits with a shift"
+#endif
+
+#if defined(SUPPORT_STREAM) && TIMER_FREQ % STREAM_FPS != 0
+#error "STREAM_FPS should divide TIMER_FREQ, frames are shown at the start of a PWM period"
+#endif
+
+#if defined(SUPPORT_SHIFT_OUT) && (SHIFT_CHANNELS % 8 != 0 || SHIFT_CHANNELS < 16 || SHIFT_CHANNELS > 64)
+#error "SHIFT_CHANNELS must be a multiple of 8 from 16 to 64"
+#endif
+
+#if defined(SUPPORT_SHIFT_OUT) && defined(SUPPORT_PWM_TAIL)
+#error "SUPPORT_SHIFT_OUT uses bit-plane modulation which has no idle tail, it can not be combined with SUPPORT_PWM_TAIL"
+#endif
+
+#if defined(SUPPORT_SHIFT_OUT) && (PIN_BTN0 == 10 || PIN_BTN0 == 11 || PIN_BTN0 == 13 || PIN_BTN1 == 10 || PIN_BTN1 == 11 || PIN_BTN1 == 13)
+#error "The buttons can not be on pin 10, 11 or 13 when these drive the shift registers"
+#endif
+
+#if (EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)) != 0 || EVENT_QUEUE_SIZE > 128
+#error "EVENT_QUEUE_SIZE must be a power of 2 and at most 128"
+#endif
+
+#if defined(SUPPORT_LOAD_BAR) && !defined(SUPPORT_LOAD_METER)
+#error "SUPPORT_LOAD_BAR shows the load meter, it needs SUPPORT_LOAD_METER"
+#endif
+
+#if defined(SUPPORT_LOAD_BAR) && defined(SUPPORT_SHIFT_OUT)
+#error "SUPPORT_LOAD_BAR drives the LED pins directly, it can not be combined with SUPPORT_SHIFT_OUT"
+#endif
+
+#if defined(SUPPORT_SHIFT_OUT) && (defined(SUPPORT_TELEMETRY) || defined(SUPPORT_STREAM))
+#error "The telemetry and stream frames carry the 10 LEDs of the board, they can not be combined with SUPPORT_SHIFT_OUT"
+#endif
+
+#if (TRACE_RECORDS & (TRACE_RECORDS - 1)) != 0 || TRACE_RECORDS > 128
+#error "TRACE_RECORDS must be a power of 2 and at most 128"
+#endif
+
 #define barrier() asm volatile("": : :"memory")
 
 typedef enum {
@@ -135,14 +583,6 @@ typedef enum {
   SETUP_LOWER     // Special fade: when a LED has brightness below the lower boundary (due to animations changing), this mode will fade up to the lower boundary
 } effect_enum_t;
 
-typedef struct {
-  volatile int16_t       delta;   // step size for the animation, note that this is a 16-bit value in order to do smooth sub-step fades
-  volatile int8_t        active;  // if the fader for this LED is active
-  volatile effect_enum_t reload;  // what to do when the end of the fade (up or down) is reached
-  volatile uint8_t       upper;   // upper bound for the fader - default is 255
-  volatile uint8_t       lower;   // lower bound for the fader - default is 0
-} fader_struct_t;
-
 typedef union {
   struct {
     uint8_t minor;
@@ -151,28 +591,7 @@ typedef union {
   uint16_t raw;
 } duint8_t; // double uint8_t
 
-/**
- * Utility function to quickly configure a fader to fade to the lower bound
- */
-static inline void setup_fade_to_lower(fader_struct_t *f, duint8_t *val) {
-  if(f->lower == val->major) {
-    // Nothing to do, fader and LED have same value, disable fader
-    f->active = 0;
-    val->minor = 0;
-  } else if(f->lower < val->major) {
-    // LED is brighter, fade down
-    f->reload = NONE;
-    if(f->delta > 0) f->delta = -f->delta; // Reverse fade direction to fade out
-    f->active = 1;
-  } else {
-    // LED is dimmer, fade in
-    f->reload = SETUP_LOWER;
-    f->delta = SETUP_FADE_SPEED_MAJOR << 8;
-    f->active = 1;
-  }
-}
-
 // Number of animations in total - used in the main loop and the EEPROM sanity check
-#define NUM_ANIMATIONS 9
+#define NUM_ANIMATIONS 11
 
 #endif
\ No newline at end of file
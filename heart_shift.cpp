@@ -0,0 +1,54 @@
+/**
+ * heart_shift.cpp - Heart PCB Project - LED output through a chain of shift registers with bit-plane modulation
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.10
+ * @license GNUGPLv3
+ */
+
+#include "heart_shift.h"
+
+#ifdef SUPPORT_SHIFT_OUT
+
+uint8_t  _shift_planes [8][SHIFT_BYTES];
+uint8_t  _shift_plane = 0;
+uint8_t  _shift_group = 0;
+uint16_t _shift_scale = 256;
+
+/**
+ * Set up the SPI port and the latch pin, and turn all LEDs off
+ */
+void shift_init() {
+  // MOSI (PB3), SCK (PB5) and the latch (PB2) are outputs
+  DDRB |= _BV(3) | _BV(5) | SHIFT_LATCH_MASK;
+  PORTB &= ~SHIFT_LATCH_MASK;
+  // SPI master, MSB first, mode 0, F_CPU / 2
+  SPCR = _BV(SPE) | _BV(MSTR);
+  SPSR = _BV(SPI2X);
+
+  for(uint8_t k = 0; k < 8; k++) {
+    for(uint8_t g = 0; g < SHIFT_BYTES; g++) _shift_planes[k][g] = SHIFT_OUTPUT(0);
+  }
+  shift_fill(SHIFT_OUTPUT(0));
+}
+
+/**
+ * Show an error code: the LED of the code and, when phase is 1, the indicator LEDs are on
+ */
+void shift_error(uint8_t err, uint8_t phase) {
+  const uint8_t err0 = PIN_LED_ERR0 - PIN_LED_START;
+  const uint8_t err1 = PIN_LED_ERR1 - PIN_LED_START;
+  uint8_t bytes [SHIFT_BYTES];
+  for(uint8_t g = 0; g < SHIFT_BYTES; g++) {
+    uint8_t on = 0;
+    for(uint8_t i = 0; i < 8; i++) {
+      const uint8_t c = g * 8 + i;
+      if(c == err || (phase && (c == err0 || c == err1))) on |= 1 << i;
+    }
+    bytes[g] = SHIFT_OUTPUT(on);
+  }
+  shift_out(bytes);
+}
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * heart_shift.h - Heart PCB Project - LED output through a chain of shift registers with bit-plane modulation
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.10
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_SHIFT_H_
+#define _HEART_SHIFT_H_
+
+#include "heart_settings.h"
+
+/**
+ * Clocking all channels into the shift registers on every PWM step would take too long, so the brightness is shown with
+ * bit-plane modulation instead: plane k holds bit k of the brightness of every channel and is shown for 2^k ticks. The
+ * planes start at PWM step 2^k - 1 (0, 1, 3, 7, ... 127) and at step 255 all LEDs are off, so a LED with brightness b
+ * is on for b of the 256 ticks, like with the PWM. The registers are only written 9 times per PWM period.
+ *
+ * The planes are computed from the brightness of the LEDs during plane 7 (steps 128 to 254, which need no output): one
+ * group of 8 channels per tick, skipping the ticks which update a fader. They are shown in the next period. The global
+ * brightness level scales the brightness while computing the planes, as the threshold increment does for the PWM.
+ *
+ * SPI runs at F_CPU / 2, so a byte takes 16 cycles; the latch (RCLK, pin 10) copies the chain to the outputs at once.
+ */
+
+#ifdef SUPPORT_SHIFT_OUT
+#include "heart_isr.h"
+#include <avr/io.h>
+
+// Number of bytes (shift registers) in the chain
+#define SHIFT_BYTES (SHIFT_CHANNELS / 8)
+
+// Latch clock on pin 10 (PB2), which is also SS: as an output it keeps the SPI in master mode
+#define SHIFT_LATCH_MASK _BV(2)
+
+// Value to shift out for a group of channels, a set bit is a LED which is on
+#ifdef SHIFT_ACTIVE_HIGH
+  #define SHIFT_OUTPUT(__on) (__on)
+#else
+  #define SHIFT_OUTPUT(__on) ((uint8_t)~(__on))
+#endif
+
+// Bit planes for the next PWM period as shifted out: plane k, byte g holds channel 8 * g + i in bit i
+extern uint8_t _shift_planes [8][SHIFT_BYTES];
+// Next plane to show
+extern uint8_t _shift_plane;
+// Next group of 8 channels to compute the planes for
+extern uint8_t _shift_group;
+// Brightness scale for the global brightness level in 1/256, from the threshold increment of the PWM
+extern uint16_t _shift_scale;
+
+/**
+ * Set up the SPI port and the latch pin, and turn all LEDs off
+ */
+void shift_init();
+
+/**
+ * Show an error code: the LED of the code and, when phase is 1, the indicator LEDs are on
+ */
+void shift_error(uint8_t err, uint8_t phase);
+
+/**
+ * Clock one set of bytes into the chain and latch them; the last byte goes out first as it ends up furthest down the
+ * chain
+ */
+static inline void shift_out(const uint8_t *bytes) {
+  for(int8_t g = SHIFT_BYTES - 1; g >= 0; g--) {
+    SPDR = bytes[g];
+    while(!(SPSR & _BV(SPIF)));
+  }
+  PORTB |= SHIFT_LATCH_MASK;
+  PORTB &= ~SHIFT_LATCH_MASK;
+}
+
+/**
+ * Clock the same byte into every register of the chain and latch it
+ */
+static inline void shift_fill(uint8_t value) {
+  for(uint8_t g = 0; g < SHIFT_BYTES; g++) {
+    SPDR = value;
+    while(!(SPSR & _BV(SPIF)));
+  }
+  PORTB |= SHIFT_LATCH_MASK;
+  PORTB &= ~SHIFT_LATCH_MASK;
+}
+
+/**
+ * Compute the 8 planes of one group of channels; the planes are kept in registers while going over the channels
+ */
+static inline void shift_prepare(uint8_t g) {
+  const uint16_t scale = _shift_scale;
+  const uint8_t first = g * 8;
+  uint8_t p0 = 0, p1 = 0, p2 = 0, p3 = 0, p4 = 0, p5 = 0, p6 = 0, p7 = 0;
+  // Highest channel first, it ends up in bit 7
+  for(int8_t i = 7; i >= 0; i--) {
+    const uint8_t v = ((uint16_t)_led_brightness[first + i].major * scale) >> 8;
+    p0 = (p0 << 1) | (v & 0x01);
+    p1 = (p1 << 1) | ((v >> 1) & 0x01);
+    p2 = (p2 << 1) | ((v >> 2) & 0x01);
+    p3 = (p3 << 1) | ((v >> 3) & 0x01);
+    p4 = (p4 << 1) | ((v >> 4) & 0x01);
+    p5 = (p5 << 1) | ((v >> 5) & 0x01);
+    p6 = (p6 << 1) | ((v >> 6) & 0x01);
+    p7 = (p7 << 1) | (v >> 7);
+  }
+  _shift_planes[0][g] = SHIFT_OUTPUT(p0);
+  _shift_planes[1][g] = SHIFT_OUTPUT(p1);
+  _shift_planes[2][g] = SHIFT_OUTPUT(p2);
+  _shift_planes[3][g] = SHIFT_OUTPUT(p3);
+  _shift_planes[4][g] = SHIFT_OUTPUT(p4);
+  _shift_planes[5][g] = SHIFT_OUTPUT(p5);
+  _shift_planes[6][g] = SHIFT_OUTPUT(p6);
+  _shift_planes[7][g] = SHIFT_OUTPUT(p7);
+}
+
+/**
+ * Output for one PWM step; called by the ISR instead of the software PWM
+ * @param step PWM step of this tick
+ * @param inc  Threshold increment of the PWM in this period (brightness level and current limit)
+ * @param idle 1 when the tick has time to compute planes (no fader update pending)
+ */
+static inline void shift_tick(uint8_t step, uint16_t inc, uint8_t idle) {
+  if((step & (step + 1)) == 0) {
+    if(step == 255) {
+      // End of the period: all off, and the scale for the planes computed in the next period
+      shift_fill(SHIFT_OUTPUT(0));
+      _shift_scale = (inc <= 256) ? 256 : 65535U / inc;
+      _shift_plane = 0;
+      _shift_group = 0;
+    } else {
+      // Step 2^k - 1: show plane k (the mask only matters for the first period after boot, which starts at step 1)
+      shift_out(_shift_planes[_shift_plane & 7]);
+      _shift_plane++;
+    }
+  } else if(step >= 128 && idle && _shift_group < SHIFT_BYTES) {
+    shift_prepare(_shift_group);
+    _shift_group++;
+  }
+}
+
+#endif
+
+#endif
\ No newline at end of file
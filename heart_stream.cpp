@@ -0,0 +1,210 @@
+/**
+ * heart_stream.cpp - Heart PCB Project - Playback of LED frames streamed by the host over the serial port
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.11
+ * @license GNUGPLv3
+ */
+
+#include "heart_stream.h"
+#include "heart_isr.h"
+#include "heart_time.h"
+#include "heart_delay.h"
+#include "heart_command.h"
+
+#ifdef SUPPORT_STREAM
+#include "Arduino.h"
+
+// Number of PWM periods between two frames
+#define STREAM_PERIODS_PER_FRAME (TIMER_FREQ / STREAM_FPS)
+#define STREAM_BUFFER_MASK       (STREAM_BUFFER_FRAMES - 1)
+
+#if (STREAM_BUFFER_FRAMES & STREAM_BUFFER_MASK) != 0
+#error "STREAM_BUFFER_FRAMES should be a power of 2"
+#endif
+
+// Jitter buffer: received frames are added at the head by the main loop, the ISR shows them from the tail
+uint16_t          stream_buf [STREAM_BUFFER_FRAMES][NUM_LEDS]; // Raw brightness (major and minor) per LED
+uint8_t           stream_seq [STREAM_BUFFER_FRAMES];           // Sequence number per frame
+volatile uint8_t  stream_head = 0;
+volatile uint8_t  stream_tail = 0;
+
+volatile uint8_t  _stream_active  = 0;   // Set while animate_stream() runs; the ISR only shows frames when set
+volatile uint8_t  _stream_playing = 0;   // Cleared when the buffer ran empty, playback restarts when it is filled again
+uint8_t           _stream_period_cnt = 0;// PWM periods since the last frame was shown
+volatile uint8_t  _stream_shown_seq;     // Sequence number of the frame shown last
+volatile uint8_t  _stream_shown = 0;     // Set by the ISR when a frame is shown, cleared when it is acknowledged
+
+volatile uint16_t stream_dropped   = 0;
+volatile uint16_t stream_late      = 0;
+volatile uint16_t stream_duplicate = 0;
+
+// Receive state
+uint8_t  stream_rx_type = 0;  // Type of the frame being received, 0 when not receiving a frame
+uint8_t  stream_rx_pos;       // Number of bytes received after the type byte
+uint8_t  stream_rx_check;     // Running checksum
+uint8_t  stream_rx_full;      // Set when the jitter buffer was full at the start of the frame, the frame is dropped
+uint16_t stream_rx_last_seq = 0xFFFF; // Sequence number of the last frame received, to detect duplicates
+uint8_t  stream_rx_seq;       // Sequence number of the frame being received
+uint32_t stream_rx_ms = 0;    // Time the last valid frame was received
+
+/**
+ * Feed a received byte to the stream frame parser.
+ * @return 1 when the byte is part of a stream frame, 0 when it should be handled as a command
+ */
+uint8_t stream_rx(uint8_t c) {
+  const uint8_t head = stream_head;
+  uint8_t len;
+
+  if(stream_rx_type == 0) {
+    // Not in a frame, only start one on a type byte
+    if(c != STREAM_TYPE_MAJOR && c != STREAM_TYPE_RAW) return 0;
+    stream_rx_type  = c;
+    stream_rx_pos   = 0;
+    stream_rx_check = 0;
+    stream_rx_full  = ((head + 1) & STREAM_BUFFER_MASK) == stream_tail;
+    return 1;
+  }
+
+  len = (stream_rx_type == STREAM_TYPE_MAJOR) ? NUM_LEDS : 2 * NUM_LEDS;
+  if(stream_rx_pos == 0) {
+    stream_rx_seq = c;
+  } else if(stream_rx_pos <= len) {
+    // Payload; written straight into the free slot at the head, it only becomes visible when the head moves
+    if(!stream_rx_full) {
+      uint8_t i = stream_rx_pos - 1;
+      if(stream_rx_type == STREAM_TYPE_MAJOR) {
+        stream_buf[head][i] = c << 8;
+      } else if(i & 0x1) {
+        stream_buf[head][i >> 1] |= c;
+      } else {
+        stream_buf[head][i >> 1] = c << 8;
+      }
+    }
+  } else {
+    // Checksum byte, frame complete
+    stream_rx_type = 0;
+    if(c != stream_rx_check) {
+      stream_dropped++;
+    } else if(stream_rx_seq == stream_rx_last_seq) {
+      stream_duplicate++;
+    } else {
+      stream_rx_last_seq = stream_rx_seq;
+      stream_rx_ms = heart_millis();
+      if(stream_rx_full) {
+        stream_dropped++;
+      } else {
+        stream_seq[head] = stream_rx_seq;
+        barrier();
+        stream_head = (head + 1) & STREAM_BUFFER_MASK;
+      }
+      // Switch to streaming mode when a stream starts
+      if(!_stream_active && command_animation != ANIMATION_STREAM) {
+        command_animation = ANIMATION_STREAM;
+        disable_heart_delay();
+      }
+    }
+    return 1;
+  }
+  stream_rx_check ^= c;
+  stream_rx_pos++;
+  return 1;
+}
+
+/**
+ * Background task for the main loop: acknowledges the frames that were shown.
+ */
+void stream_service() {
+  if(!_stream_shown || Serial.availableForWrite() < 2) return;
+  _stream_shown = 0;
+  Serial.write(STREAM_ACK);
+  Serial.write(_stream_shown_seq);
+}
+
+/**
+ * Called by the ISR at the start of every PWM period: shows the next frame from the jitter buffer when it is due.
+ */
+void stream_period() {
+  uint8_t tail = stream_tail;
+
+  if(!_stream_active) return;
+  if(++_stream_period_cnt < STREAM_PERIODS_PER_FRAME) return;
+  _stream_period_cnt = 0;
+
+  if(tail == stream_head) {
+    // Nothing to show; the next frame is late. Wait for the buffer to fill up again before continuing
+    if(_stream_playing) stream_late++;
+    _stream_playing = 0;
+    return;
+  }
+  if(!_stream_playing) {
+    if(((stream_head - tail) & STREAM_BUFFER_MASK) < STREAM_PREFILL_FRAMES) return;
+    _stream_playing = 1;
+  }
+
+  for(uint8_t l=0; l<NUM_LEDS; l++) {
+    SET_LED_BRIGHTNESS_RAW(l, stream_buf[tail][l]);
+  }
+  _stream_shown_seq = stream_seq[tail];
+  _stream_shown = 1;
+  stream_tail = (tail + 1) & STREAM_BUFFER_MASK;
+}
+
+/**
+ * Streaming mode: show the frames sent by the host until the stream stops or the animation is aborted.
+ */
+void animate_stream() {
+  const uint8_t demo = demo_mode;
+
+  // Enable the delay function if it was turned off by button press to abort the previous animation
+  enable_heart_delay();
+  // The host decides what is shown, so no automatic switching
+  demo_mode = 0;
+
+  // The frames drive the LEDs directly, stop all faders
+  for(int8_t l=0; l < NUM_LEDS; l++) {
+    FADER_STOP(l);
+  }
+  _stream_playing = 0;
+  _stream_period_cnt = 0;
+  barrier();
+  _stream_active = 1;
+
+  while(heart_millis() - stream_rx_ms < STREAM_TIMEOUT_MS) {
+    if(heart_delay(10))
+      break; // Abort when requested
+  }
+
+  _stream_active = 0;
+  demo_mode = demo;
+}
+
+#else
+// *** No stream support ***
+
+volatile uint16_t stream_dropped   = 0;
+volatile uint16_t stream_late      = 0;
+volatile uint16_t stream_duplicate = 0;
+
+/**
+ * Feed a received byte to the stream frame parser.
+ */
+uint8_t stream_rx(uint8_t /* c */) { return 0; }
+
+/**
+ * Background task for the main loop: acknowledges the frames that were shown.
+ */
+void stream_service() {}
+
+/**
+ * Called by the ISR at the start of every PWM period.
+ */
+void stream_period() {}
+
+/**
+ * Streaming mode: show the frames sent by the host until the stream stops or the animation is aborted.
+ */
+void animate_stream() {}
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * heart_stream.h - Heart PCB Project - Playback of LED frames streamed by the host over the serial port
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.11
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_STREAM_H_
+#define _HEART_STREAM_H_
+
+#include "heart_settings.h"
+
+/**
+ * Stream frame layout, sent by the host:
+ *   0       1     2..N                                                    N+1
+ * | TYPE  | seq | 10 bytes brightness (TYPE_MAJOR) or 10 x major, minor  | checksum |
+ *
+ * The checksum is the XOR of the sequence number and the payload. For every frame that is shown, the firmware
+ * answers with STREAM_ACK followed by the sequence number, which the host uses to measure the latency.
+ * None of these bytes are valid ASCII so the frames can be mixed with text commands.
+ */
+#define STREAM_TYPE_MAJOR 0xA6
+#define STREAM_TYPE_RAW   0xA7
+#define STREAM_ACK        0xA8
+
+// Animation ID of the streaming mode; it is not part of the normal animation sequence
+#define ANIMATION_STREAM NUM_ANIMATIONS
+
+// Frame counters: frames dropped because the jitter buffer was full or the checksum was wrong, frames which were not
+// received in time to be shown and frames received twice
+extern volatile uint16_t stream_dropped;
+extern volatile uint16_t stream_late;
+extern volatile uint16_t stream_duplicate;
+
+/**
+ * Feed a received byte to the stream frame parser.
+ * @return 1 when the byte is part of a stream frame, 0 when it should be handled as a command
+ */
+uint8_t stream_rx(uint8_t c);
+
+/**
+ * Background task for the main loop: acknowledges the frames that were shown.
+ */
+void stream_service();
+
+/**
+ * Called by the ISR at the start of every PWM period: shows the next frame from the jitter buffer when it is due.
+ */
+void stream_period();
+
+/**
+ * Streaming mode: show the frames sent by the host until the stream stops or the animation is aborted.
+ */
+void animate_stream();
+
+#ifdef SUPPORT_STREAM
+  #define STREAM_PERIOD() stream_period()
+#else
+  #define STREAM_PERIOD() {}
+#endif
+
+#endif
\ No newline at end of file
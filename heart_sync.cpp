@@ -0,0 +1,211 @@
+/**
+ * heart_sync.cpp - Heart PCB Project - Synchronisation of multiple hearts over a serial daisy chain
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.08
+ * @license GNUGPLv3
+ */
+
+#include "heart_sync.h"
+
+uint8_t sync_slave    = 0;
+uint8_t sync_hops     = 0;
+int32_t sync_error_us = 0;
+
+#ifdef SUPPORT_SYNC
+#include "Arduino.h"
+#include "heart_isr.h"
+#include "heart_time.h"
+#include "heart_delay.h"
+#include "heart_command.h"
+
+int32_t  sync_offset_us  = 0;    // Offset between heart_micros() and the sync time
+uint32_t sync_last_rx_ms = 0;    // Time of the last valid frame
+uint32_t sync_last_tx_ms = 0;    // Time of the last frame sent as master
+uint8_t  sync_tx_now     = 0;    // Set to send a frame as master right away
+uint8_t  sync_animation  = 0xFF; // Animation, seed and start of the running animation
+uint16_t sync_seed       = 0;
+uint32_t sync_start_us   = 0;
+uint8_t  sync_master_animation = 0xFF; // Animation, seed and start in the last frame of the master
+uint16_t sync_master_seed = 0;
+uint32_t sync_master_start_us = 0;
+int32_t  sync_filter_max = 0;    // Largest error in the current filter window: the frame processed with the least delay
+uint8_t  sync_filter_cnt = 0;    // Frames in the current filter window
+
+uint8_t  sync_rx [SYNC_FRAME_LEN]; // Frame being received
+uint8_t  sync_rx_len = 0;
+
+/**
+ * Start the serial port for the sync frames
+ */
+void sync_init() {
+  Serial.begin(SERIAL_BAUD);
+}
+
+/**
+ * Sync time in us: heart_micros() corrected by the offset to the master, used by heart_delay()
+ */
+uint32_t sync_micros() {
+  return heart_micros() + sync_offset_us;
+}
+
+/**
+ * Queue a sync frame when it fits in the transmit buffer; a frame which does not fit is skipped, the next one follows soon
+ */
+static void sync_send(uint8_t hops) {
+  uint8_t frame [SYNC_FRAME_LEN];
+  uint8_t check = 0;
+  uint32_t t, start;
+
+  if(Serial.availableForWrite() < SYNC_FRAME_LEN) return;
+
+  t = sync_micros();
+  start = sync_slave ? sync_master_start_us : sync_start_us;
+  frame[0] = SYNC_MAGIC;
+  frame[1] = hops;
+  frame[2] = sync_slave ? sync_master_animation : sync_animation;
+  frame[3] = t & 0xFF;
+  frame[4] = (t >> 8) & 0xFF;
+  frame[5] = (t >> 16) & 0xFF;
+  frame[6] = t >> 24;
+  frame[7] = (sync_slave ? sync_master_seed : sync_seed) & 0xFF;
+  frame[8] = (sync_slave ? sync_master_seed : sync_seed) >> 8;
+  frame[9] = start & 0xFF;
+  frame[10] = (start >> 8) & 0xFF;
+  frame[11] = (start >> 16) & 0xFF;
+  frame[12] = start >> 24;
+  for(uint8_t i=1; i<SYNC_FRAME_LEN-1; i++) check ^= frame[i];
+  frame[SYNC_FRAME_LEN-1] = check;
+  Serial.write(frame, SYNC_FRAME_LEN);
+}
+
+/**
+ * Handle a complete and valid frame
+ */
+static void sync_frame() {
+  const uint32_t now = sync_micros();
+  const uint32_t t = (uint32_t)sync_rx[3] | (uint32_t)sync_rx[4] << 8 | (uint32_t)sync_rx[5] << 16 | (uint32_t)sync_rx[6] << 24;
+  const int32_t  err = (int32_t)(t + SYNC_LINK_US - now);
+
+  sync_error_us = err;
+  sync_hops = sync_rx[1] + 1;
+
+  if(!sync_slave || err > SYNC_STEP_US || err < -SYNC_STEP_US) {
+    // First frame or far off: jump to the sync time
+    sync_offset_us += err;
+    sync_filter_cnt = 0;
+  } else {
+    // A frame can only be processed late (the main loop was busy), never early: the largest error in a window is the
+    // most accurate one. Correct half of it to damp the noise.
+    if(sync_filter_cnt == 0 || err > sync_filter_max) sync_filter_max = err;
+    if(++sync_filter_cnt >= SYNC_FILTER_FRAMES) {
+      sync_offset_us += sync_filter_max / 2;
+      sync_filter_cnt = 0;
+    }
+  }
+  sync_slave = 1;
+  sync_last_rx_ms = heart_millis();
+
+  // Follow the animation of the master: restart when it started an animation we are not running
+  sync_master_animation = sync_rx[2];
+  sync_master_seed = (uint16_t)sync_rx[7] | (uint16_t)sync_rx[8] << 8;
+  sync_master_start_us = (uint32_t)sync_rx[9] | (uint32_t)sync_rx[10] << 8 | (uint32_t)sync_rx[11] << 16 |
+                         (uint32_t)sync_rx[12] << 24;
+  if(sync_master_animation < NUM_ANIMATIONS && command_animation < 0 &&
+     (sync_master_animation != sync_animation || sync_master_seed != sync_seed)) {
+    command_animation = sync_master_animation;
+    disable_heart_delay();
+  }
+  // The master decides when to switch animations, keep the demo timer of this heart from switching
+  DEMO_RESTART();
+
+  // Relay to the next heart with the corrected time
+  sync_send(sync_hops);
+}
+
+/**
+ * Called by the main loop when an animation starts, right after heart_delay_start(): seeds random() with the seed of
+ * the master and aligns the deadlines to its start (or picks a new seed on the master, which is sent to the slaves
+ * right away).
+ */
+void sync_animation_start(uint8_t animation_id) {
+  if(sync_slave && animation_id == sync_master_animation) {
+    // Step at the deadlines of the master, counted from its start; a slave which starts later catches up
+    sync_seed = sync_master_seed;
+    sync_start_us = sync_master_start_us;
+    heart_delay_align(sync_start_us);
+  } else {
+    sync_seed = heart_micros();
+    sync_start_us = heart_deadline_us;
+    sync_tx_now = 1;
+  }
+  sync_animation = animation_id;
+  randomSeed(sync_seed);
+}
+
+/**
+ * Background task for the main loop: processes received sync frames, relays them and sends frames when master.
+ */
+void sync_service() {
+  int c;
+
+  // Process all received bytes; frames are short and only arrive every SYNC_INTERVAL_MS
+  while((c = Serial.read()) >= 0) {
+    if(sync_rx_len == 0 && c != SYNC_MAGIC) continue;
+    sync_rx[sync_rx_len++] = c;
+    if(sync_rx_len < SYNC_FRAME_LEN) continue;
+
+    uint8_t check = 0;
+    for(uint8_t i=1; i<SYNC_FRAME_LEN-1; i++) check ^= sync_rx[i];
+    if(check == sync_rx[SYNC_FRAME_LEN-1]) {
+      sync_frame();
+      sync_rx_len = 0;
+    } else {
+      // Not a frame, search for the next magic byte in the received bytes
+      uint8_t i = 1;
+      while(i < SYNC_FRAME_LEN && sync_rx[i] != SYNC_MAGIC) i++;
+      memmove(sync_rx, &sync_rx[i], SYNC_FRAME_LEN - i);
+      sync_rx_len = SYNC_FRAME_LEN - i;
+    }
+  }
+
+  // Without frames from upstream this heart is the master (again)
+  if(sync_slave && heart_millis() - sync_last_rx_ms >= SYNC_TIMEOUT_MS) {
+    sync_slave = 0;
+    sync_hops = 0;
+  }
+
+  if(!sync_slave && (sync_tx_now || heart_millis() - sync_last_tx_ms >= SYNC_INTERVAL_MS)) {
+    sync_last_tx_ms = heart_millis();
+    sync_tx_now = 0;
+    sync_send(0);
+  }
+}
+
+#else
+// *** No sync support ***
+#include "Arduino.h"
+#include "heart_time.h"
+
+/**
+ * Start the serial port for the sync frames
+ */
+void sync_init() {}
+
+/**
+ * Sync time in us: without sync support this is heart_micros()
+ */
+uint32_t sync_micros() { return heart_micros(); }
+
+/**
+ * Called by the main loop when an animation starts.
+ */
+void sync_animation_start(uint8_t /* animation_id */) {}
+
+/**
+ * Background task for the main loop: processes received sync frames, relays them and sends frames when master.
+ */
+void sync_service() {}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * heart_sync.h - Heart PCB Project - Synchronisation of multiple hearts over a serial daisy chain
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.08
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_SYNC_H_
+#define _HEART_SYNC_H_
+
+#include "heart_settings.h"
+#include "heart_time.h"
+
+/**
+ * Sync frame layout (all multi-byte values are little endian):
+ *   0       1      2           3..6        7..8    9..12        13
+ * | MAGIC | hops | animation | time (us) | seed  | start (us) | checksum |
+ *
+ * The time is the sync time of the sender when the frame was queued. The seed identifies the run of the animation: it
+ * changes every time the master starts an animation and is used to seed random(), so animations which use random
+ * numbers look the same on every heart. The start is the sync time at which the master started that run. The checksum
+ * is the XOR of byte 1 up to and including byte 12.
+ *
+ * A slave adjusts the offset between its own clock and the sync time with every frame, restarts the animation when the
+ * animation or the seed differ from the ones it runs, and relays the frame with hops + 1 and its own (corrected) time.
+ * heart_delay() runs on the sync time and a slave starts the deadlines of the animation at the start of the master
+ * (heart_delay_align()), so the steps of all hearts stay in phase, also on a heart which joins halfway an animation.
+ */
+#define SYNC_MAGIC     0xA9
+#define SYNC_FRAME_LEN 14
+
+// Time for one frame on the wire in us, added to the received time as the frame was sent that long ago
+#define SYNC_LINK_US   ((uint32_t)SYNC_FRAME_LEN * 10 * 1000000 / SERIAL_BAUD)
+
+// Set while sync frames are received, 0 when this heart is the master
+extern uint8_t sync_slave;
+
+// Number of hearts between the master and this heart
+extern uint8_t sync_hops;
+
+// Difference between the sync time in the last frame and the local sync time when it was processed, in us
+extern int32_t sync_error_us;
+
+/**
+ * Start the serial port for the sync frames
+ */
+void sync_init();
+
+/**
+ * Sync time in us: heart_micros() corrected by the offset to the master, used by heart_delay()
+ */
+uint32_t sync_micros();
+
+/**
+ * Called by the main loop when an animation starts, right after heart_delay_start(): seeds random() with the seed of
+ * the master and aligns the deadlines to its start (or picks a new seed on the master, which is sent to the slaves
+ * right away).
+ * @param animation_id Animation which starts
+ */
+void sync_animation_start(uint8_t animation_id);
+
+/**
+ * Background task for the main loop: processes received sync frames, relays them and sends frames when master.
+ */
+void sync_service();
+
+#ifdef SUPPORT_SYNC
+  #define HEART_MICROS() sync_micros()
+#else
+  #define HEART_MICROS() heart_micros()
+#endif
+
+#endif
\ No newline at end of file
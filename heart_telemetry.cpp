@@ -0,0 +1,94 @@
+/**
+ * heart_telemetry.cpp - Heart PCB Project - Binary telemetry stream of the LED and animation state
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.04
+ * @license GNUGPLv3
+ */
+
+#include "heart_telemetry.h"
+#include "heart_isr.h"
+#include "heart_time.h"
+
+#ifdef SUPPORT_TELEMETRY
+#include "Arduino.h"
+
+// Interval between frames in ms
+#define TELEMETRY_INTERVAL_MS (1000 / (TELEMETRY_FREQ))
+
+uint16_t telemetry_dropped = 0;        // Number of frames skipped because the transmit buffer was full
+uint16_t telemetry_counter = 0;        // Frame counter, allows the host to detect lost frames
+uint32_t telemetry_last_ms = 0;        // Time the last frame was queued
+
+/**
+ * Start the serial port for the telemetry stream
+ */
+void telemetry_init() {
+  Serial.begin(SERIAL_BAUD);
+}
+
+/**
+ * Background task for the main loop: queues a telemetry frame every 1/TELEMETRY_FREQ seconds.
+ * The frame is only queued when it fits in the transmit buffer so this never blocks; the serial interrupt sends it.
+ * @param animation_id Animation which is currently running
+ */
+void telemetry_service(uint8_t animation_id) {
+  uint8_t  frame [TELEMETRY_FRAME_LEN];
+  uint8_t  p = 0;
+  uint16_t active;
+  uint16_t missed;
+  uint8_t  sreg;
+  uint8_t  check = 0;
+  uint32_t now = heart_millis();
+
+  if(now - telemetry_last_ms < TELEMETRY_INTERVAL_MS) return;
+  telemetry_last_ms = now;
+
+  // The counter is increased for dropped frames as well so the host sees the gap
+  telemetry_counter++;
+  if(Serial.availableForWrite() < TELEMETRY_FRAME_LEN) {
+    telemetry_dropped++;
+    return;
+  }
+
+  frame[p++] = TELEMETRY_SYNC0;
+  frame[p++] = TELEMETRY_SYNC1;
+  frame[p++] = telemetry_counter & 0xFF;
+  frame[p++] = telemetry_counter >> 8;
+  for(uint8_t l=0; l<NUM_LEDS; l++) {
+    frame[p++] = GET_LED_BRIGHTNESS(l).major;
+  }
+  active = fader_active; // Only the ISR clears bits, a torn read still gives a valid mask (LEDs 0 to 15)
+  frame[p++] = active & 0xFF;
+  frame[p++] = active >> 8;
+  frame[p++] = animation_id;
+  frame[p++] = _err;
+  sreg = SREG;
+  cli();
+  missed = _isr_missed;
+  SREG = sreg;
+  frame[p++] = missed & 0xFF;
+  frame[p++] = missed >> 8;
+  for(uint8_t i=2; i<p; i++) check ^= frame[i];
+  frame[p++] = check;
+
+  Serial.write(frame, p);
+}
+
+#else
+// *** No telemetry support ***
+
+uint16_t telemetry_dropped = 0;
+
+/**
+ * Start the serial port for the telemetry stream
+ */
+void telemetry_init() {}
+
+/**
+ * Background task for the main loop: queues a telemetry frame every 1/TELEMETRY_FREQ seconds.
+ */
+void telemetry_service(uint8_t /* animation_id */) {}
+
+#endif
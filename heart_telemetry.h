@@ -0,0 +1,41 @@
+/**
+ * heart_telemetry.h - Heart PCB Project - Binary telemetry stream of the LED and animation state
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.04
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_TELEMETRY_H_
+#define _HEART_TELEMETRY_H_
+
+#include "heart_settings.h"
+
+/**
+ * Telemetry frame layout (all multi-byte values are little endian):
+ *   0     1     2..3       4..13        14..15          16         17      18..19          20
+ * | SYNC0 SYNC1 | counter | brightness | active faders | animation | error | missed ticks | checksum |
+ *
+ * The checksum is the XOR of byte 2 up to and including byte 19. Missed ticks is the (saturating) number of ISR ticks
+ * which did not finish before the next tick was due.
+ */
+#define TELEMETRY_SYNC0     0xA5
+#define TELEMETRY_SYNC1     0x5A
+#define TELEMETRY_FRAME_LEN (2 + 2 + NUM_LEDS + 2 + 1 + 1 + 2 + 1)
+
+// Number of frames that were skipped because the serial transmit buffer was full
+extern uint16_t telemetry_dropped;
+
+/**
+ * Start the serial port for the telemetry stream
+ */
+void telemetry_init();
+
+/**
+ * Background task for the main loop: queues a telemetry frame every 1/TELEMETRY_FREQ seconds.
+ * The frame is only queued when it fits in the transmit buffer so this never blocks; the serial interrupt sends it.
+ * @param animation_id Animation which is currently running
+ */
+void telemetry_service(uint8_t animation_id);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+/**
+ * heart_time.cpp - Heart PCB Project - Time base for the animations and the background tasks
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.29
+ * @license GNUGPLv3
+ */
+
+#include "heart_time.h"
+#include "heart_clock.h"
+#include "Arduino.h"
+
+#ifdef SUPPORT_TICK_TIME
+
+volatile uint32_t _time_ticks   = 0;
+volatile uint8_t  _time_skipped = 0;
+
+uint32_t time_ms         = 0; // Result of the last heart_millis() call
+uint32_t time_rem_us     = 0; // us which were not added to time_ms yet
+uint32_t time_last_us    = 0; // Result of heart_micros() at the last heart_millis() call
+
+/**
+ * Number of PWM ticks since the timer started; a tick lasts TIMER_INTERVAL_US
+ */
+uint32_t heart_ticks() {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint32_t ticks = _time_ticks;
+  SREG = sreg;
+  return ticks;
+}
+
+/**
+ * Time in us since boot
+ */
+uint32_t heart_micros() {
+  uint32_t ticks;
+  uint16_t cnt0, cnt1, top, elapsed;
+  uint8_t  tov, sreg = SREG;
+
+  cli();
+  ticks = _time_ticks;
+  cnt0 = TCNT1;
+  cnt1 = TCNT1;
+  top = ICR1;
+  tov = TIFR1 & _BV(TOV1);
+  // A tick ended but the ISR did not run yet (interrupts are off): when the timer is counting up again it is not counted
+  if(tov && cnt1 >= cnt0) ticks += 1 + _time_skipped;
+  SREG = sreg;
+
+  // Timer1 runs up and down in a tick (phase correct PWM), when it is going down the time is the period minus the count
+  elapsed = (cnt1 >= cnt0) ? cnt1 : 2 * top - cnt1;
+  #ifdef SUPPORT_CLOCK_SCALING
+    elapsed /= (F_CPU / 1000000) >> clock_shift;
+  #else
+    elapsed /= F_CPU / 1000000;
+  #endif
+  return ticks * TIMER_INTERVAL_US + elapsed;
+}
+
+/**
+ * Time in ms since boot; only call this from the main loop
+ */
+uint32_t heart_millis() {
+  const uint32_t us = heart_micros();
+
+  // Add the us since the last call; a 32 bit division is slow, so only use it after a long time without calls
+  time_rem_us += us - time_last_us;
+  time_last_us = us;
+  if(time_rem_us >= 0x10000) {
+    time_ms += time_rem_us / 1000;
+    time_rem_us %= 1000;
+  }
+  while(time_rem_us >= 1000) {
+    time_ms++;
+    time_rem_us -= 1000;
+  }
+  return time_ms;
+}
+
+/**
+ * Switch to the time base of the PWM ticks (when enabled); call this after the PWM timer is running
+ */
+void time_init() {
+  #ifndef TIME_KEEP_TIMER0
+    // Stop Timer0 and its overflow interrupt (millis() and micros())
+    TIMSK0 = 0;
+    TCCR0B = 0;
+  #endif
+}
+
+#else
+// *** No tick time support ***
+
+/**
+ * Time in us since boot
+ */
+uint32_t heart_micros() { return clock_micros(); }
+
+/**
+ * Time in ms since boot; only call this from the main loop
+ */
+uint32_t heart_millis() { return clock_millis(); }
+
+/**
+ * Switch to the time base of the PWM ticks (when enabled); call this after the PWM timer is running
+ */
+void time_init() {}
+
+#endif
+
+// Calls of the function to measure, and of an empty one; the fastest of each is used
+#define TIME_CYCLES_RUNS 32
+
+/**
+ * Position of Timer1 in the current tick in CPU cycles; call with interrupts off
+ */
+static uint16_t time_tick_cycles() {
+  const uint16_t cnt0 = TCNT1;
+  const uint16_t cnt1 = TCNT1;
+  // Timer1 runs up and down in a tick (phase correct PWM), when it is going down the time is the period minus the count
+  return (cnt1 >= cnt0) ? cnt1 : 2 * ICR1 - cnt1;
+}
+
+/**
+ * Run the function once with interrupts off
+ * @return Cycles from before to after the call, 0xFFFF when a tick ended in between or already before
+ */
+static uint16_t time_cycles_run(void (*fn)()) {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint8_t  tov   = TIFR1 & _BV(TOV1);
+  const uint16_t start = time_tick_cycles();
+  fn();
+  const uint16_t end   = time_tick_cycles();
+  // The overflow flag is only cleared by the ISR, which can not run now: when it got set the call crossed a tick
+  const uint8_t  ended = TIFR1 & _BV(TOV1);
+  SREG = sreg;
+  return (tov || ended || end < start) ? 0xFFFF : end - start;
+}
+
+static void time_cycles_nothing() {}
+
+/**
+ * Measure the CPU cycles a short piece of code takes, on the board itself
+ * @param fn Code to measure, at most one PWM tick long (2 * ICR1 cycles)
+ * @return Cycles of one call, 0 when no call fitted in a tick
+ */
+uint16_t time_cycles(void (*fn)()) {
+  uint16_t cycles = 0xFFFF, overhead = 0xFFFF;
+  for(uint8_t n = 0; n < TIME_CYCLES_RUNS; n++) {
+    const uint16_t c = time_cycles_run(fn);
+    if(c < cycles) cycles = c;
+    const uint16_t o = time_cycles_run(time_cycles_nothing);
+    if(o < overhead) overhead = o;
+  }
+  return (cycles == 0xFFFF || overhead > cycles) ? 0 : cycles - overhead;
+}
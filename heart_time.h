@@ -0,0 +1,73 @@
+/**
+ * heart_time.h - Heart PCB Project - Time base for the animations and the background tasks
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.29
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_TIME_H_
+#define _HEART_TIME_H_
+
+#include "heart_settings.h"
+
+/**
+ * All time keeping goes through heart_micros() and heart_millis(). By default these are micros() and millis() of the
+ * Arduino core (Timer0), corrected for the clock when the clock scaling is enabled.
+ *
+ * With SUPPORT_TICK_TIME the PWM ISR counts its ticks instead: every tick lasts exactly TIMER_INTERVAL_US, so the ticks
+ * are the time base and the position of Timer1 within the tick adds the us. Timer0 and its overflow interrupt are then
+ * stopped, so they no longer delay the PWM ticks. Note that millis(), micros() and delay() of the Arduino core do not
+ * work after time_init().
+ */
+
+#ifdef SUPPORT_TICK_TIME
+// Number of completed ticks; read with heart_ticks()
+extern volatile uint32_t _time_ticks;
+// Extra ticks covered by the long tick which is running (see SUPPORT_PWM_TAIL), added to _time_ticks when it ends
+extern volatile uint8_t  _time_skipped;
+
+/**
+ * Number of PWM ticks since the timer started; a tick lasts TIMER_INTERVAL_US
+ */
+uint32_t heart_ticks();
+#endif
+
+/**
+ * Time in us since boot
+ */
+uint32_t heart_micros();
+
+/**
+ * Time in ms since boot; only call this from the main loop
+ */
+uint32_t heart_millis();
+
+/**
+ * Switch to the time base of the PWM ticks (when enabled); call this after the PWM timer is running
+ */
+void time_init();
+
+/**
+ * Measure the CPU cycles a short piece of code takes, on the board itself: Timer1 counts at the CPU clock, so the
+ * difference of its position before and after a call is the time in cycles. The function runs TIME_CYCLES_RUNS times
+ * with interrupts off and only calls which stay within one PWM tick count; the fastest one is returned, minus the cost
+ * of calling an empty function. Only for setup code: every call delays the PWM interrupt by its length.
+ * @param fn Code to measure, at most one PWM tick long (2 * ICR1 cycles)
+ * @return Cycles of one call, 0 when no call fitted in a tick
+ */
+uint16_t time_cycles(void (*fn)());
+
+#ifdef SUPPORT_TICK_TIME
+  // Count a tick; at the start of every ISR call
+  #define TIME_TICK() { _time_ticks++; }
+  // The tick which starts covers __ticks ticks, the rest are counted when it ends
+  #define TIME_LONG_TICK(__ticks) { _time_skipped = (__ticks) - 1; }
+  #define TIME_LONG_TICK_END() { _time_ticks += _time_skipped; _time_skipped = 0; }
+#else
+  #define TIME_TICK() {}
+  #define TIME_LONG_TICK(__ticks) {}
+  #define TIME_LONG_TICK_END() {}
+#endif
+
+#endif
\ No newline at end of file
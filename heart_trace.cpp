@@ -0,0 +1,117 @@
+/**
+ * heart_trace.cpp - Heart PCB Project - Binary event trace in a ring buffer, written from the ISR and the main loop
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.14
+ * @license GNUGPLv3
+ */
+
+#include "heart_trace.h"
+#include "heart_governor.h"
+#include "heart_time.h"
+#include "Arduino.h"
+
+uint16_t trace_cycles_record = 0;
+
+#ifdef SUPPORT_TRACE
+volatile trace_t  _trace_buf [TRACE_RECORDS];
+volatile uint8_t  _trace_head = 0;
+volatile uint8_t  _trace_tail = 0;
+volatile uint16_t _trace_ticks = 0;
+volatile uint8_t  _trace_skipped = 0;
+volatile uint16_t _trace_lost = 0;
+
+uint8_t trace_dump_left = 0; // Records left to print in the running dump
+uint8_t trace_dumping = 0;   // Set while a dump runs
+
+/**
+ * Write a record and remove it again, to measure the cost of a record; only while the ring has room
+ */
+static void trace_measure_record() {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint8_t head = _trace_head;
+  trace(TRACE_MARK, 0);
+  _trace_head = head;
+  SREG = sreg;
+}
+
+/**
+ * Print the next line of a dump: the records which were in the ring when the dump started, oldest first, as
+ * "<ticks> <event> <arg>" lines, and a closing "trace <tick us> <lost>" line; prints only the closing line without
+ * SUPPORT_TRACE. Each record is removed from the ring when it is printed, records written meanwhile wait for the next
+ * dump.
+ * @return 1 when more lines follow, 0 after the closing line
+ */
+uint8_t trace_dump_line() {
+  uint8_t sreg;
+
+  if(!trace_dumping) {
+    // Only the records which are there now belong to this dump; the ISR keeps writing behind them
+    sreg = SREG;
+    cli();
+    trace_dump_left = (_trace_head - _trace_tail) & (TRACE_RECORDS - 1);
+    SREG = sreg;
+    trace_dumping = 1;
+  }
+
+  if(trace_dump_left) {
+    // Copy the oldest record and free it before printing, so the writers can use it again
+    trace_t rec;
+    sreg = SREG;
+    cli();
+    const uint8_t tail = _trace_tail;
+    rec.ticks = _trace_buf[tail].ticks;
+    rec.id = _trace_buf[tail].id;
+    rec.arg = _trace_buf[tail].arg;
+    _trace_tail = (tail + 1) & (TRACE_RECORDS - 1);
+    SREG = sreg;
+    trace_dump_left--;
+
+    Serial.print(rec.ticks);
+    Serial.print(' ');
+    Serial.print(rec.id);
+    Serial.print(' ');
+    Serial.println(rec.arg);
+    return 1;
+  }
+
+  // Measure the cost of a record once, when the ring has room for the record it writes and removes again
+  if(trace_cycles_record == 0 && ((_trace_head + 1) & (TRACE_RECORDS - 1)) != _trace_tail) {
+    trace_cycles_record = time_cycles(trace_measure_record);
+  }
+
+  // The lost records are reported once
+  sreg = SREG;
+  cli();
+  const uint16_t lost = _trace_lost;
+  _trace_lost = 0;
+  SREG = sreg;
+  trace_dumping = 0;
+
+  Serial.print(F("trace "));
+  Serial.print(governor_interval_us);
+  Serial.print(' ');
+  Serial.println(lost);
+  return 0;
+}
+
+#else
+// *** No trace support ***
+
+/**
+ * Print the next line of a dump: the records which were in the ring when the dump started, oldest first, as
+ * "<ticks> <event> <arg>" lines, and a closing "trace <tick us> <lost>" line; prints only the closing line without
+ * SUPPORT_TRACE. Each record is removed from the ring when it is printed, records written meanwhile wait for the next
+ * dump.
+ * @return 1 when more lines follow, 0 after the closing line
+ */
+uint8_t trace_dump_line() {
+  Serial.print(F("trace "));
+  Serial.print(governor_interval_us);
+  Serial.println(F(" 0"));
+  return 0;
+}
+
+#endif
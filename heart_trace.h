@@ -0,0 +1,116 @@
+/**
+ * heart_trace.h - Heart PCB Project - Binary event trace in a ring buffer, written from the ISR and the main loop
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.14
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_TRACE_H_
+#define _HEART_TRACE_H_
+
+#include "heart_settings.h"
+
+/**
+ * Trace points all over the firmware write a record of 5 bytes into a ring of TRACE_RECORDS records: the ISR tick at
+ * which it happened (16 bits, see _trace_ticks), the event and a 16 bit argument. Records are written from the ISR as
+ * well as from the main loop; the first dump measures the cost of one with Timer1 (trace_cycles_record). The ring is a
+ * FIFO: when it is full, new records are dropped and counted in _trace_lost instead of overwriting the oldest ones.
+ * The ticks count the PWM ticks including those skipped by a long tick (SUPPORT_PWM_TAIL), so one tick always lasts
+ * the timer interval; when the PWM governor changes the interval it writes a TRACE_INTERVAL record. When the tick
+ * counter wraps (every 65536 ticks, 2.56 s at 39 us) the ISR writes a TRACE_WRAP record, so the host can reconstruct
+ * the full time line as long as no records are lost.
+ *
+ * The 't' command (SUPPORT_COMMANDS) prints the records, oldest first, and removes them from the ring; tracing goes on
+ * while they are printed. tools/trace_chrome.py reads them, from a capture or by polling a live board, and writes a
+ * Chrome trace (chrome://tracing or ui.perfetto.dev). Add TRACE(TRACE_MARK, value) anywhere to mark a moment while
+ * debugging.
+ */
+
+// Events. Keep tools/trace_chrome.py in sync.
+#define TRACE_WRAP          1  // The tick counter wrapped
+#define TRACE_ANIMATION     2  // Animation started; arg: animation number
+#define TRACE_WAIT          3  // The main loop starts to wait; arg: the wait in ms, 0 when already late
+#define TRACE_RESUME        4  // The wait ended and the animation continues; arg: 1 when the delay was aborted
+#define TRACE_OVERRUN       5  // A step missed its deadline; arg: the overrun in us, saturated
+#define TRACE_FADER_START   6  // Faders started from the main loop; arg: mask of the first 16 LEDs
+#define TRACE_FADER_BOUND   7  // A fader reached a bound; arg: LED, reload effect << 8, 0x8000 for the upper bound
+#define TRACE_EEPROM_START  8  // A background EEPROM write started; arg: EEPROM address
+#define TRACE_EEPROM_BYTE   9  // A byte is erased and written (3.3 ms); arg: EEPROM address
+#define TRACE_EEPROM_DONE   10 // The background write finished; arg: EEPROM address of the record
+#define TRACE_BUTTON        11 // The ISR queued an event; arg: event type << 8 | button
+#define TRACE_EVENT         12 // The main loop handles a queued event; arg: event type << 8 | button
+#define TRACE_MARK          13 // Free for debugging; arg: anything
+#define TRACE_INTERVAL      14 // The PWM governor changed the timer interval; arg: the new interval in us
+
+#ifdef SUPPORT_TRACE
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+typedef struct {
+  uint16_t ticks; // _trace_ticks when the event happened
+  uint8_t  id;    // TRACE_*
+  uint16_t arg;
+} __attribute__ ((packed)) trace_t;
+
+extern volatile trace_t  _trace_buf [TRACE_RECORDS];
+extern volatile uint8_t  _trace_head;    // Next record to write
+extern volatile uint8_t  _trace_tail;    // Oldest record; the ring is empty when it equals _trace_head
+extern volatile uint16_t _trace_ticks;   // Counts the ISR ticks
+extern volatile uint8_t  _trace_skipped; // Ticks skipped by the running long tick, added when it ends
+extern volatile uint16_t _trace_lost;    // Records dropped because the ring was full
+
+/**
+ * Write a record; from the ISR or the main loop
+ */
+static inline void trace(uint8_t id, uint16_t arg) {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint8_t head = _trace_head;
+  const uint8_t next = (head + 1) & (TRACE_RECORDS - 1);
+  if(next != _trace_tail) {
+    _trace_buf[head].ticks = _trace_ticks;
+    _trace_buf[head].id = id;
+    _trace_buf[head].arg = arg;
+    _trace_head = next;
+  } else if(_trace_lost != 0xFFFF) {
+    _trace_lost++;
+  }
+  SREG = sreg;
+}
+
+#define TRACE(__id, __arg) trace((__id), (__arg))
+
+// Count the ISR ticks; called from the ISR
+#define TRACE_TICK() { if(++_trace_ticks == 0) trace(TRACE_WRAP, 0); }
+// A long tick lasting __ticks ticks started; the skipped ticks are counted when it ends, so the records written
+// meanwhile carry the tick at which it started
+#define TRACE_LONG_TICK(__ticks) { _trace_skipped = (__ticks) - 1; }
+#define TRACE_LONG_TICK_END() {                                                \
+  const uint16_t __t = _trace_ticks + _trace_skipped;                          \
+  const uint8_t __wrapped = __t < _trace_ticks;                                \
+  _trace_ticks = __t;                                                          \
+  _trace_skipped = 0;                                                          \
+  if(__wrapped) trace(TRACE_WRAP, 0);                                          \
+}
+#else
+#define TRACE(__id, __arg) {}
+#define TRACE_TICK() {}
+#define TRACE_LONG_TICK(__ticks) {}
+#define TRACE_LONG_TICK_END() {}
+#endif
+
+// CPU cycles to write a record, including saving and restoring the head around it; measured with Timer1 by the first
+// dump which finds room in the ring and printed by the 'c' command as trace_cyc_record. 0 before.
+extern uint16_t trace_cycles_record;
+
+/**
+ * Print the next line of a dump: the records which were in the ring when the dump started, oldest first, as
+ * "<ticks> <event> <arg>" lines, and a closing "trace <tick us> <lost>" line; prints only the closing line without
+ * SUPPORT_TRACE. Each record is removed from the ring when it is printed, records written meanwhile wait for the next
+ * dump.
+ * @return 1 when more lines follow, 0 after the closing line
+ */
+uint8_t trace_dump_line();
+
+#endif
\ No newline at end of file
@@ -2,23 +2,53 @@
 #include "heart_isr.h"
 #include "heart_profiling.h"
 #include "heart_eeprom.h"
+#include "heart_telemetry.h"
+#include "heart_command.h"
+#include "heart_stream.h"
+#include "heart_watchdog.h"
+#include "heart_memory.h"
+#include "heart_load.h"
+#include "heart_trace.h"
+#include "heart_governor.h"
+#include "heart_clock.h"
+#include "heart_time.h"
+#include "heart_event.h"
+#include "heart_delay.h"
+#include "heart_shift.h"
+#include "heart_sync.h"
+#include "heart_audio.h"
 #include "heart_ani_run_around.h"
 #include "heart_ani_dropfill.h"
 #include "heart_ani_twinkle.h"
 #include "heart_ani_beat.h"
 #include "heart_ani_setdemodelay.h"
+#include "heart_ani_wave.h"
+#include "heart_ani_frames.h"
 #include "TimerOne.h"
 
 int start_animation = 0;
+uint8_t current_animation = 0; // Animation which is currently running
 
 void setup() {
-  // configure relevant pins as outputs
+  // Stop the watchdog when it caused this reset (when enabled), before anything else
+  watchdog_init();
+
+  // configure relevant pins as outputs, or the SPI port driving the shift registers (when enabled)
+#ifdef SUPPORT_SHIFT_OUT
+  shift_init();
+#else
   for(uint8_t l=0; l<NUM_LEDS; l++) pinMode(PIN_LED_START+l, OUTPUT);
+#endif
   pinMode(PIN_BTN0, INPUT);
   pinMode(PIN_BTN1, INPUT);
 
   // Initialize measurement support for profiling (when enabled) - also inits Serial
   MEASUREMENT_INIT;
+  // Start the telemetry stream and command interface (when enabled)
+  telemetry_init();
+  command_init();
+  // Start the sync chain (when enabled)
+  sync_init();
   // Some debug stats; only visible when measurements are enabled
   SERPRINT(TIMER_INTERVAL_US);
   SERPRINT(" us ISR interval (");
@@ -52,17 +82,17 @@ void setup() {
   //SET_LED_BRIGHTNESS_MAJOR(4, 180);
   //SET_LED_BRIGHTNESS_MAJOR(5, 255);
 
-  //fader[6].delta = 256 * 5;
-  //fader[6].active = 1;
-  //fader[6].reload = JUMP;
-  //fader[6].upper  = 255;
-  //fader[6].lower  = 0;
-
-  //fader[7].delta = 20;
-  //fader[7].active = 1;
-  //fader[7].reload = INVERT;
-  //fader[7].upper  = 255;
-  //fader[7].lower  = 0;
+  //fader_delta[6] = 256 * 5;
+  //FADER_START(6);
+  //fader_reload[6] = JUMP;
+  //fader_upper[6]  = 255;
+  //fader_lower[6]  = 0;
+
+  //fader_delta[7] = 20;
+  //FADER_START(7);
+  //fader_reload[7] = INVERT;
+  //fader_upper[7]  = 255;
+  //fader_lower[7]  = 0;
   SERPRINTLN("OK:0");
   
   // Use timer1 for the intervals for the software PWM and faders
@@ -78,6 +108,15 @@ void setup() {
   // Set the ISR for Timer 1
   Timer1.attachInterrupt(heart_isr);
 
+  // Keep time with the PWM ticks from now on (when enabled)
+  time_init();
+
+  // Start sampling the microphone (when enabled); after the timer, which measures the cost of the detector
+  audio_init();
+
+  // Supervise the main loop and the ISR (when enabled)
+  watchdog_start();
+
   // Second debug print; when the ISR is set way too high, the serial port dies - this canary will show this issue
 //  SERPRINTLN("OK:1");
 }
@@ -127,8 +166,69 @@ void setup() {
     //.delay_current_ms = 0
   };
 
+  // Timing of the beating heart
+  uint16_t beat_interval_ms = 400;
+  uint16_t beat_gap_ms      = 1200;
+
+#ifdef SUPPORT_COMMANDS
+// Parameters which can be tuned using the serial command interface
+const command_param_t command_params [] PROGMEM = {
+  { "beat.ivl", &beat_interval_ms,                           2 },
+  { "beat.gap", &beat_gap_ms,                                2 },
+  { "ra.speed", &run_around_default.fade_speed_major,        1 },
+  { "ra.base",  &run_around_default.delay_base_ms,           2 },
+  { "ra.tgt",   &run_around_default.delay_tgt_ms,            2 },
+  { "ra.step",  &run_around_default.delay_step_ms,           2 },
+  { "pp.speed", &run_around_pingpong.fade_speed_major,       1 },
+  { "pp.base",  &run_around_pingpong.delay_base_ms,          2 },
+  { "pp.tgt",   &run_around_pingpong.delay_tgt_ms,           2 },
+  { "up.base",  &run_around_erasing_speedup.delay_base_ms,   2 },
+  { "up.tgt",   &run_around_erasing_speedup.delay_tgt_ms,    2 },
+  { "up.step",  &run_around_erasing_speedup.delay_step_ms,   2 },
+  { "dn.base",  &run_around_erasing_speeddown.delay_base_ms, 2 },
+  { "dn.tgt",   &run_around_erasing_speeddown.delay_tgt_ms,  2 },
+  { "dn.step",  &run_around_erasing_speeddown.delay_step_ms, 2 },
+};
+const uint8_t command_num_params = sizeof(command_params) / sizeof(command_param_t);
+#endif
+
 int first_run = 1; // Flag to skip storing settings in the first run
 
+/**
+ * Called by heart_delay() while an animation waits for its next step; runs the background tasks of the main loop.
+ * Note: this overrides the empty yield() provided by the Arduino core, keep it short as it delays the animations.
+ */
+void yield() {
+  // Act on the buttons and the demo mode timer
+  event_service();
+  // Commit settings to EEPROM once they are stable
+  eeprom_service();
+  // Send the LED state to the host
+  telemetry_service(current_animation);
+  // Handle commands from the host
+  command_service(current_animation);
+  // Acknowledge streamed frames
+  stream_service();
+  // Update the supply current estimate and limit
+  power_service();
+  // Log raised errors to EEPROM
+  eeprom_error_service(current_animation);
+  // Feed the watchdog while the ISR is running
+  watchdog_service();
+  // Check how close the stack came to the static variables
+  memory_service();
+  // Measure the CPU load
+  load_service();
+  // Adapt the PWM frequency to the measured load
+  governor_service();
+  // Follow or lead the other hearts in the chain
+  sync_service();
+  // Detect beats in the music
+  audio_service();
+  // Lower the CPU clock when the load allows it
+  clock_service();
+}
+
 void loop() {
   int aborted = 0;
 
@@ -136,12 +236,24 @@ void loop() {
   SERPRINTLN("OK:1");
   
   while(1) {
+    // Frames streamed from the host take over until the stream stops, then the interrupted animation continues
+    while(start_animation == ANIMATION_STREAM) {
+      animate_stream();
+      start_animation = (command_animation >= 0) ? command_animation : current_animation;
+      command_animation = -1;
+    }
 
     for(int i=0,j=start_animation; i<NUM_ANIMATIONS; i++, j=(i+start_animation)%NUM_ANIMATIONS) {
       MEASUREMENT_PRINT;
+      current_animation = j;
+      TRACE(TRACE_ANIMATION, j);
+      // Time the steps of the animation from here
+      heart_delay_start(j);
+      // Seed random() so synchronised hearts show the same animation (when enabled)
+      sync_animation_start(j);
       
       if(!first_run) {
-        // Save animation switch plus all other settings to EEPROM to resume when power is lost
+        // Save animation switch plus all other settings to EEPROM to resume when power is lost (written in the background)
         eeprom_settings.animation_id = j;
         eeprom_settings.demo_mode = demo_mode;
         eeprom_settings.brightness = GET_BRIGHTNESS_SCALE;
@@ -152,7 +264,7 @@ void loop() {
       switch(j) {
         case 0:
           // Show a beating heart
-          animate_beat();
+          animate_beat(2, beat_interval_ms, beat_gap_ms);
           break;
         case 1:
           // Animation of 1 runner going around the heart, reversing after 5 rounds
@@ -212,13 +324,39 @@ void loop() {
           // Starry twinkle
           animate_twinkle();
           break;
+        case 9:
+          // Waves over the heart: filling up, rippling from the centre and rotating along the outline
+          aborted = 0;
+          while(!aborted) {
+            for(int x = 0; x < WAVE_NUM_EFFECTS; x++) {
+              aborted = animate_wave(x, WAVE_EFFECT_S * 1000UL / WAVE_FRAME_MS);
+              if(aborted) break;
+            }
+          }
+          break;
+        case 10:
+          // Recorded sequences from flash, one after the other
+          aborted = 0;
+          while(!aborted) {
+            for(int x = 0; x < frames_sequences(); x++) {
+              aborted = animate_frames(x, FRAMES_SEQUENCE_S);
+              if(aborted) break;
+            }
+          }
+          break;
       } 
       // If tbtn0 was held down, show the delay configuration panel
       if(btn0_hold) {
         animate_setdemodelay();
         i--; // Return to the current animation
       }
-      
+
+      // Switch to the animation requested over the command interface by restarting the sequence from there
+      if(command_animation >= 0) {
+        start_animation = command_animation;
+        command_animation = -1;
+        break;
+      }
     }
   }
   
@@ -0,0 +1,68 @@
+/**
+ * heart_watchdog.cpp - Heart PCB Project - Hardware watchdog supervision of the main loop and the PWM ISR
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.25
+ * @license GNUGPLv3
+ */
+
+#include "heart_watchdog.h"
+
+#ifdef SUPPORT_WATCHDOG
+#include "Arduino.h"
+#include <avr/wdt.h>
+#include "heart_isr.h"
+#include "heart_eeprom.h"
+
+uint8_t watchdog_ticks = 0; // ISR tick counter at the last time the watchdog was fed
+
+/**
+ * Check the reset cause and stop the watchdog which is still running after a watchdog reset; call first thing in setup()
+ */
+void watchdog_init() {
+  const uint8_t cause = MCUSR;
+  // The watchdog stays enabled (with the shortest timeout) as long as the reset flag is set
+  MCUSR = 0;
+  wdt_disable();
+
+  if(cause & _BV(WDRF)) eeprom_error_log(ERR_WATCHDOG);
+}
+
+/**
+ * Start the watchdog; call at the end of setup() once the ISR is running
+ */
+void watchdog_start() {
+  watchdog_ticks = _isr_ticks;
+  wdt_enable(WATCHDOG_TIMEOUT);
+}
+
+/**
+ * Background task for the main loop: feeds the watchdog when the ISR made progress since the last call
+ */
+void watchdog_service() {
+  const uint8_t ticks = _isr_ticks;
+  if(ticks == watchdog_ticks) return;
+  watchdog_ticks = ticks;
+  wdt_reset();
+}
+
+#else
+// *** No watchdog support ***
+
+/**
+ * Check the reset cause and stop the watchdog which is still running after a watchdog reset; call first thing in setup()
+ */
+void watchdog_init() {}
+
+/**
+ * Start the watchdog; call at the end of setup() once the ISR is running
+ */
+void watchdog_start() {}
+
+/**
+ * Background task for the main loop: feeds the watchdog when the ISR made progress since the last call
+ */
+void watchdog_service() {}
+
+#endif
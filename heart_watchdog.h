@@ -0,0 +1,29 @@
+/**
+ * heart_watchdog.h - Heart PCB Project - Hardware watchdog supervision of the main loop and the PWM ISR
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.08.25
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_WATCHDOG_H_
+#define _HEART_WATCHDOG_H_
+
+#include "heart_settings.h"
+
+/**
+ * Check the reset cause and stop the watchdog which is still running after a watchdog reset; call first thing in setup()
+ */
+void watchdog_init();
+
+/**
+ * Start the watchdog; call at the end of setup() once the ISR is running
+ */
+void watchdog_start();
+
+/**
+ * Background task for the main loop: feeds the watchdog when the ISR made progress since the last call
+ */
+void watchdog_service();
+
+#endif
\ No newline at end of file
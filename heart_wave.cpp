@@ -0,0 +1,86 @@
+/**
+ * heart_wave.cpp - Heart PCB Project - Waves over the geometry of the heart with a phase accumulator and a sine table
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.08
+ * @license GNUGPLv3
+ */
+
+#include "heart_wave.h"
+#include "heart_geometry.h"
+#include "heart_isr.h"
+#include "heart_time.h"
+
+// First quarter of a sine period (65 entries including the top), 127 * sin(i * pi / 128)
+static const uint8_t WAVE_SINE_QUARTER [65] PROGMEM = {
+    0,   3,   6,   9,  12,  16,  19,  22,  25,  28,  31,  34,  37,  40,  43,  46,
+   49,  51,  54,  57,  60,  63,  65,  68,  71,  73,  76,  78,  81,  83,  85,  88,
+   90,  92,  94,  96,  98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+  117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+  127
+};
+
+uint16_t wave_render_us_max = 0;
+uint16_t wave_cycles_frame = 0;
+
+uint16_t wave_phase = 0;             // Oscillator phase, the major byte is the phase of the sine
+uint16_t wave_step = 0;              // Phase step per frame
+uint8_t  wave_offset [NUM_LEDS];     // Phase offset per LED group
+uint8_t  wave_lower = 0;             // Brightness range
+uint8_t  wave_range = 0;
+
+/**
+ * Sine of a phase of 256 steps per period, 1 to 255 with 128 at phase 0
+ */
+uint8_t wave_sin8(uint8_t phase) {
+  const uint8_t i = phase & 0x3F;
+  // Second and fourth quarter run back down the table
+  const uint8_t v = pgm_read_byte(&WAVE_SINE_QUARTER[(phase & 0x40) ? 64 - i : i]);
+  return (phase & 0x80) ? 128 - v : 128 + v;
+}
+
+/**
+ * Set the brightness of every LED group for the current phase of the oscillator
+ */
+static void wave_render_leds() {
+  const uint8_t phase = wave_phase >> 8;
+  for(uint8_t l=0; l < NUM_LEDS; l++) {
+    const uint8_t s = wave_sin8(phase + wave_offset[l]);
+    SET_LED_BRIGHTNESS_MAJOR(l, wave_lower + (((uint16_t)wave_range * s) >> 8));
+  }
+}
+
+/**
+ * Start a wave: compute the phase offset of every LED group and restart the oscillator
+ */
+void wave_start(const wave_t *w) {
+  for(uint8_t l=0; l < NUM_LEDS; l++) {
+    // The sum may wrap around in 16 bits, which leaves the phase (the sum / 64 modulo 256) intact
+    const uint16_t sum = (int16_t)w->kx * GEOMETRY_X(l) + (int16_t)w->ky * GEOMETRY_Y(l) +
+                         (int16_t)w->kr * GEOMETRY_R(l) + (int16_t)w->kring * GEOMETRY_RING(l);
+    wave_offset[l] = sum >> 6;
+  }
+  wave_phase = 0;
+  wave_step = w->step;
+  wave_lower = w->lower;
+  wave_range = w->upper - w->lower;
+
+  // Measure the cost of a frame once, on the first wave; this shows the first frame already
+  static uint8_t measured = 0;
+  if(!measured) {
+    wave_cycles_frame = time_cycles(wave_render_leds);
+    measured = 1;
+  }
+}
+
+/**
+ * Advance the oscillator by one frame and set the brightness of every LED group
+ */
+void wave_render() {
+  const uint32_t start = heart_micros();
+  wave_phase += wave_step;
+  wave_render_leds();
+  const uint32_t dur = heart_micros() - start;
+  if(dur > wave_render_us_max) wave_render_us_max = dur;
+}
@@ -0,0 +1,60 @@
+/**
+ * heart_wave.h - Heart PCB Project - Waves over the geometry of the heart with a phase accumulator and a sine table
+ * 
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.08
+ * @license GNUGPLv3
+ */
+#ifndef _HEART_WAVE_H_
+#define _HEART_WAVE_H_
+
+#include "heart_settings.h"
+
+/**
+ * A wave is a sine running over the heart: an oscillator (a 16 bit phase accumulator) moves it in time and every LED
+ * group adds a phase offset which depends on its place in the heart (see heart_geometry.h):
+ *   offset = (kx * x + ky * y + kr * r + kring * ring) / 64
+ * so kx or ky give a wave front moving across the heart, kr a ripple from the centre and kring a gradient running along
+ * the outline. With a k of 64 the wave spans one period per 256 units of its coordinate.
+ *
+ * The offsets only depend on the wave, wave_start() computes them once; a frame then costs one addition, a table lookup
+ * and a multiplication per LED group.
+ */
+
+// Phase step per frame of WAVE_FRAME_MS for a wave of __mhz periods per 1000 s
+#define WAVE_STEP(__mhz) ((uint16_t)((__mhz) * 65536ULL * WAVE_FRAME_MS / 1000000UL))
+
+typedef struct {
+  uint16_t step;   // Phase step per frame, see WAVE_STEP()
+  int8_t   kx;     // Phase per unit of x, y, distance from the centre and position along the outline, in 1/64
+  int8_t   ky;
+  int8_t   kr;
+  int8_t   kring;
+  uint8_t  lower;  // Brightness at the bottom of the wave
+  uint8_t  upper;  // Brightness at the top of the wave
+} wave_t;
+
+// Longest time in us wave_render() took to update all LEDs
+extern uint16_t wave_render_us_max;
+
+// CPU cycles to set all LEDs for one frame, without interrupts; measured with Timer1 by the first wave_start() and
+// printed by the 'c' command, also per LED. 0 when a frame takes longer than a PWM tick.
+extern uint16_t wave_cycles_frame;
+
+/**
+ * Sine of a phase of 256 steps per period, 1 to 255 with 128 at phase 0
+ */
+uint8_t wave_sin8(uint8_t phase);
+
+/**
+ * Start a wave: compute the phase offset of every LED group and restart the oscillator
+ */
+void wave_start(const wave_t *w);
+
+/**
+ * Advance the oscillator by one frame and set the brightness of every LED group
+ */
+void wave_render();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+/**
+ * audio_host.cpp - Heart PCB Project - Run the beat detector of the firmware on recorded sound on a PC
+ *
+ * Reads a WAV file (PCM, 8 or 16 bit, any rate and number of channels), converts it into the samples the ADC
+ * interrupt produces (9615 Hz, 8 bits around half scale, summed per AUDIO_DECIMATION readings) and feeds them to the
+ * detector in heart_audio_detect.cpp, with the settings from heart_settings.h. Prints every detected beat and a summary,
+ * or one line per block with --blocks.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -DSUPPORT_AUDIO -DF_CPU=16000000UL -I. tools/audio_host.cpp heart_audio_detect.cpp -o audio_host
+ *   ./audio_host music.wav              # list the beats
+ *   ./audio_host music.wav 0.5          # microphone gain: full scale in the file is half the ADC range
+ *   ./audio_host music.wav 1 --blocks   # time, power, average, loudness, intensity and beat per block
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.09.15
+ * @license GNUGPLv3
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "heart_audio_detect.h"
+
+// ADC conversion rate in free running mode with a prescaler of 128
+#define ADC_RATE (F_CPU / 128.0 / 13)
+
+static uint32_t rd32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t rd16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+/**
+ * Load a PCM WAV file and mix it down to mono in the range -1 to 1
+ */
+static bool load_wav(const char *name, std::vector<float> &out, double &rate) {
+  FILE *f = fopen(name, "rb");
+  if(!f) return false;
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  size_t n;
+  while((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+  fclose(f);
+  if(data.size() < 12 || memcmp(&data[0], "RIFF", 4) || memcmp(&data[8], "WAVE", 4)) return false;
+
+  uint16_t channels = 0, bits = 0;
+  for(size_t p = 12; p + 8 <= data.size(); ) {
+    const uint32_t len = rd32(&data[p + 4]);
+    const uint8_t *c = &data[p + 8];
+    if(!memcmp(&data[p], "fmt ", 4)) {
+      if(rd16(c) != 1) return false; // PCM only
+      channels = rd16(c + 2);
+      rate = rd32(c + 4);
+      bits = rd16(c + 14);
+    } else if(!memcmp(&data[p], "data", 4) && channels && (bits == 8 || bits == 16)) {
+      const size_t frame = channels * bits / 8;
+      const size_t frames = (len < data.size() - p - 8 ? len : data.size() - p - 8) / frame;
+      for(size_t i = 0; i < frames; i++) {
+        float v = 0;
+        for(uint16_t ch = 0; ch < channels; ch++) {
+          const uint8_t *s = c + i * frame + ch * bits / 8;
+          v += (bits == 8) ? (s[0] - 128) / 128.0f : (int16_t)rd16(s) / 32768.0f;
+        }
+        out.push_back(v / channels);
+      }
+      return true;
+    }
+    p += 8 + len + (len & 1);
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s <file.wav> [gain] [--blocks]\n", argv[0]);
+    return 1;
+  }
+  const double gain = (argc > 2) ? atof(argv[2]) : 1.0;
+  const bool blocks = (argc > 3) && !strcmp(argv[3], "--blocks");
+
+  std::vector<float> pcm;
+  double rate = 0;
+  if(!load_wav(argv[1], pcm, rate)) {
+    fprintf(stderr, "%s: not a PCM WAV file with 8 or 16 bit samples\n", argv[1]);
+    return 1;
+  }
+
+  audio_detect_t d;
+  audio_detect_init(&d);
+
+  uint32_t beats = 0, nblocks = 0, active = 0;
+  uint32_t acc = 0, dec = 0;
+  const double dur = pcm.size() / rate;
+  // Sample the recording like the ADC: nearest input sample at every conversion, 8 bits around half scale
+  for(uint64_t k = 0; k / ADC_RATE < dur; k++) {
+    const size_t i = (size_t)(k / ADC_RATE * rate);
+    int v = 128 + (int)(pcm[i < pcm.size() ? i : pcm.size() - 1] * gain * 127);
+    acc += (v < 0) ? 0 : (v > 255) ? 255 : v;
+    if(++dec < AUDIO_DECIMATION) continue;
+    const uint8_t done = audio_detect_sample(&d, acc);
+    acc = 0;
+    dec = 0;
+    if(!done) continue;
+
+    const double t = (double)k / ADC_RATE;
+    nblocks++;
+    if(d.active) active++;
+    if(d.beat) beats++;
+    if(blocks) {
+      printf("%.3f %u %u %u %u %u\n", t, (unsigned)d.power, (unsigned)d.power_avg, d.level, d.intensity, d.beat);
+    } else if(d.beat) {
+      printf("beat %.3f s intensity %u\n", t, d.intensity);
+    }
+  }
+  if(!blocks) {
+    printf("%u beats in %.1f s (%.1f per minute), music detected in %u%% of %u blocks\n", beats, dur,
+           beats * 60 / dur, nblocks ? active * 100 / nblocks : 0, nblocks);
+  }
+  return 0;
+}
\ No newline at end of file
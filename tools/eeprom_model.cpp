@@ -0,0 +1,241 @@
+/**
+ * eeprom_model.cpp - Heart PCB Project - Run the EEPROM settings log on a PC against a model of the EEPROM
+ *
+ * Compiled together with heart_eeprom.cpp. The Arduino EEPROM library works on a byte array (tools/host/EEPROM.h) and
+ * EECR reports every write (HOST_REGISTER_MODEL in tools/host/avr/io.h), which drives a model of the EEPROM controller:
+ * setting EERE reads the byte at EEAR into EEDR and setting EEPE writes EEDR to it. The program plays the part of the
+ * EEPROM ready interrupt (it calls the ISR until EERIE is cleared) and of the clock, and reboots the board by forgetting
+ * the state of heart_eeprom.cpp.
+ *
+ * The program checks:
+ *   - a blank EEPROM only gets the magic number written on the first boot
+ *   - booting reads a handful of records (binary search), never the whole log
+ *   - a store writes at most one record, only the bytes which differ, and nothing when the settings did not change;
+ *     stores within EEPROM_COMMIT_DELAY_MS are combined
+ *   - the records rotate over every slot of the log (wear levelling): after whole laps every slot is written once per lap
+ *   - the newest settings are loaded after every store, across the wrap of the log and after a torn write
+ *
+ * Build and run from the repository root (the flags match those of tools/pwm_sweep.py):
+ *   g++ -O2 -std=gnu++11 -fpermissive -Wall -Wno-narrowing -Itools/host -I. -DHOST_REGISTER_MODEL \
+ *       tools/eeprom_model.cpp heart_eeprom.cpp -o eeprom_model
+ *   ./eeprom_model [laps]
+ *
+ * Prints the measurements and exits with 1 when a check failed.
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.16
+ * @license GNUGPLv3
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "heart_eeprom.h"
+#include "heart_isr.h"
+
+#ifndef SUPPORT_EEPROM
+#error "Build the EEPROM model with SUPPORT_EEPROM"
+#endif
+
+host_register     PORTB, SPDR, EECR;
+volatile uint8_t  PORTD, PIND, PINB, TIFR1, SREG, DDRB, SPCR, SPSR, EEDR;
+volatile uint16_t TCNT1, ICR1, EEAR;
+
+uint8_t  host_eeprom [E2END + 1];
+uint32_t host_eeprom_reads;
+uint32_t host_eeprom_writes;
+EEPROMClass EEPROM;
+
+// Normally in heart_isr.cpp and heart_time.cpp, which are not part of this build
+volatile uint8_t _err = 0;
+
+static uint32_t sim_ms;
+
+uint32_t heart_millis() {
+  return sim_ms;
+}
+
+// State of heart_eeprom.cpp which a reboot clears
+extern volatile int16_t eeprom_pos;
+extern int              eeprom_ok;
+extern int8_t           eeprom_err_pos;
+extern volatile uint8_t eeprom_wr_len;
+extern volatile uint8_t eeprom_wr_idx;
+
+extern "C" void EE_READY_vect(void);
+
+// Layout of heart_eeprom.cpp
+#define LOG_START   4
+#define RECORD_SIZE sizeof(eeprom_record_t)
+#define NUM_SLOTS   ((E2END + 1 - ERROR_LOG_ENTRIES * sizeof(eeprom_error_t) - LOG_START) / RECORD_SIZE)
+
+// Writes to the first byte of every slot: the low byte of the sequence number, which changes with every record
+static uint32_t slot_writes [NUM_SLOTS];
+
+static uint32_t failures;
+
+#define CHECK(__cond, ...) { if(!(__cond)) { printf("  FAIL: " __VA_ARGS__); printf("\n"); failures++; } }
+
+/**
+ * Hardware model: the EEPROM controller
+ */
+void host_register_write(host_register *reg, uint8_t old) {
+  if(reg != &EECR) return;
+  if(EECR.value & _BV(EERE)) {
+    host_eeprom_reads++;
+    EEDR = host_eeprom[EEAR];
+    EECR.value &= ~_BV(EERE);
+  }
+  if(EECR.value & _BV(EEPE)) {
+    // A write without EEMPE set in the write before is ignored by the hardware
+    if(old & _BV(EEMPE)) {
+      host_eeprom_writes++;
+      host_eeprom[EEAR] = EEDR;
+      if(EEAR >= LOG_START && EEAR < LOG_START + NUM_SLOTS * RECORD_SIZE && (EEAR - LOG_START) % RECORD_SIZE == 0) {
+        slot_writes[(EEAR - LOG_START) / RECORD_SIZE]++;
+      }
+    }
+    EECR.value &= ~(_BV(EEPE) | _BV(EEMPE));
+  }
+}
+
+/**
+ * Run the EEPROM ready interrupt until the record is written, or for at most max_bytes writes
+ */
+static void run_isr(uint32_t max_bytes) {
+  const uint32_t start = host_eeprom_writes;
+  while((EECR.value & _BV(EERIE)) && host_eeprom_writes - start < max_bytes) EE_READY_vect();
+}
+
+/**
+ * Power cycle: forget everything heart_eeprom.cpp knows and load the settings again
+ */
+static void reboot() {
+  EECR.value = 0;
+  eeprom_pos = -1;
+  eeprom_ok = 0;
+  eeprom_err_pos = -1;
+  eeprom_wr_len = 0;
+  eeprom_wr_idx = 0;
+  memset(&eeprom_settings, 0, sizeof(eeprom_settings));
+  eeprom_load();
+}
+
+/**
+ * Store the settings the way the main loop does and let the write finish; checks that only the bytes which differ are
+ * written
+ * @return bytes written
+ */
+static uint32_t store(uint8_t animation_id, uint8_t demo_mode, uint8_t brightness) {
+  static uint8_t before [E2END + 1];
+  memcpy(before, host_eeprom, sizeof(before));
+  const uint32_t start = host_eeprom_writes;
+  eeprom_settings.animation_id = animation_id;
+  eeprom_settings.demo_mode = demo_mode;
+  eeprom_settings.brightness = brightness;
+  eeprom_store();
+  sim_ms += EEPROM_COMMIT_DELAY_MS;
+  eeprom_service();
+  run_isr(0xFFFFFFFF);
+  uint32_t changed = 0;
+  for(uint16_t a = 0; a <= E2END; a++) changed += (before[a] != host_eeprom[a]);
+  CHECK(host_eeprom_writes - start == changed, "a store wrote %lu bytes to change %lu",
+        (unsigned long)(host_eeprom_writes - start), (unsigned long)changed);
+  return host_eeprom_writes - start;
+}
+
+static uint8_t settings_are(uint8_t animation_id, uint8_t demo_mode, uint8_t brightness) {
+  return eeprom_settings.animation_id == animation_id && eeprom_settings.demo_mode == demo_mode &&
+         eeprom_settings.brightness == brightness;
+}
+
+int main(int argc, char **argv) {
+  const uint32_t laps = (argc > 1) ? atoi(argv[1]) : 3;
+  // Records read by the binary search: the first slot, log2 of the slots and the newest again
+  uint32_t search = 2;
+  while((1UL << (search - 2)) < NUM_SLOTS) search++;
+  const uint32_t boot_reads_max = 4 + search * RECORD_SIZE;
+
+  // First boot on a blank EEPROM: only the magic number is written
+  memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+  host_eeprom_reads = host_eeprom_writes = 0;
+  reboot();
+  printf("blank boot: reads=%lu writes=%lu\n", (unsigned long)host_eeprom_reads, (unsigned long)host_eeprom_writes);
+  CHECK(host_eeprom_writes == 4, "blank boot wrote %lu bytes, expected the 4 of the magic number",
+        (unsigned long)host_eeprom_writes);
+  CHECK(settings_are(0, 0, 0), "blank boot did not load the defaults");
+
+  // Unchanged settings are not written, stores within the commit delay are combined into one record
+  CHECK(store(0, 0, 0) == RECORD_SIZE, "the first store did not write a whole record");
+  CHECK(store(0, 0, 0) == 0, "a store of unchanged settings wrote to the EEPROM");
+  const uint32_t before = host_eeprom_writes;
+  const uint16_t avoided = eeprom_writes_avoided;
+  for(uint8_t b = 1; b < NUM_BRIGHTNESS_LEVELS; b++) {
+    eeprom_settings.brightness = b;
+    eeprom_store();
+    sim_ms += EEPROM_COMMIT_DELAY_MS / 4;
+    eeprom_service();
+  }
+  sim_ms += EEPROM_COMMIT_DELAY_MS;
+  eeprom_service();
+  run_isr(0xFFFFFFFF);
+  CHECK(host_eeprom_writes - before <= RECORD_SIZE, "stores within the commit delay wrote %lu bytes",
+        (unsigned long)(host_eeprom_writes - before));
+  CHECK(eeprom_writes_avoided == avoided + NUM_BRIGHTNESS_LEVELS - 2, "combined stores counted %u avoided writes",
+        eeprom_writes_avoided - avoided);
+
+  // Rotation: start over from slot 0 and store whole laps; reboot after most stores to check the search, but also keep
+  // running for a while to check the position the writer keeps itself
+  memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+  reboot();
+  memset(slot_writes, 0, sizeof(slot_writes));
+  uint32_t stores = 0, bytes = 0, bytes_max = 0, reads_max = 0, expect_pos = 0;
+  for(uint32_t n = 0; n < laps * NUM_SLOTS; n++) {
+    // The animation changes with every store, so every store writes a record
+    const uint8_t a = n % NUM_ANIMATIONS, d = (n / NUM_ANIMATIONS) % 6, b = (n / 7) % NUM_BRIGHTNESS_LEVELS;
+    const uint32_t w = store(a, d, b);
+    stores++;
+    bytes += w;
+    if(w > bytes_max) bytes_max = w;
+    expect_pos = (expect_pos + 1) % NUM_SLOTS;
+    CHECK(eeprom_pos == (int16_t)expect_pos, "store %lu: the writer moved to slot %d instead of %lu",
+          (unsigned long)n, eeprom_pos, (unsigned long)expect_pos);
+    if(n % 64 >= 48) continue;
+
+    host_eeprom_reads = 0;
+    reboot();
+    if(host_eeprom_reads > reads_max) reads_max = host_eeprom_reads;
+    CHECK(settings_are(a, d, b), "store %lu: loaded %u %u %u instead of %u %u %u", (unsigned long)n,
+          eeprom_settings.animation_id, eeprom_settings.demo_mode, eeprom_settings.brightness, a, d, b);
+    CHECK(eeprom_pos == (int16_t)expect_pos, "store %lu: after a reboot the next record goes to slot %d instead of %lu",
+          (unsigned long)n, eeprom_pos, (unsigned long)expect_pos);
+  }
+  uint32_t wear_min = 0xFFFFFFFF, wear_max = 0;
+  for(uint16_t s = 0; s < NUM_SLOTS; s++) {
+    if(slot_writes[s] < wear_min) wear_min = slot_writes[s];
+    if(slot_writes[s] > wear_max) wear_max = slot_writes[s];
+  }
+  printf("slots=%u stores=%lu bytes_per_store=%.2f bytes_per_store_max=%lu boot_reads_max=%lu (limit %lu) "
+         "slot_writes=%lu..%lu\n", (unsigned)NUM_SLOTS, (unsigned long)stores, (double)bytes / stores,
+         (unsigned long)bytes_max, (unsigned long)reads_max, (unsigned long)boot_reads_max, (unsigned long)wear_min,
+         (unsigned long)wear_max);
+  CHECK(bytes_max <= RECORD_SIZE, "a store wrote %lu bytes, more than one record", (unsigned long)bytes_max);
+  CHECK(reads_max <= boot_reads_max, "a boot read %lu bytes", (unsigned long)reads_max);
+  CHECK(wear_min == laps && wear_max == laps, "the slots wear unevenly: %lu to %lu writes in %lu laps",
+        (unsigned long)wear_min, (unsigned long)wear_max, (unsigned long)laps);
+
+  // Torn write: the power fails after 3 bytes of the record, the previous settings are loaded
+  const eeprom_settings_t last = eeprom_settings;
+  eeprom_settings.animation_id = (last.animation_id + 1) % NUM_ANIMATIONS;
+  eeprom_store();
+  sim_ms += EEPROM_COMMIT_DELAY_MS;
+  eeprom_service();
+  run_isr(3);
+  reboot();
+  CHECK(memcmp(&last, &eeprom_settings, sizeof(eeprom_settings_t)) == 0, "a torn write lost the previous settings");
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
\ No newline at end of file
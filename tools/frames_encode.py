@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+frames_encode.py - Heart PCB Project - Encode recorded frame sequences for playback from flash
+
+Reads one or more CSV files with one frame per line (the brightness 0-255 of every channel, comma separated; empty lines
+and lines starting with # are skipped) and writes heart_frames_data.h with every sequence coded against the previous
+frame as described in heart_frames.h. Every frame gets the shortest coding (dynamic programming over the channels),
+optionally allowing a small brightness error; the error never adds up as each frame is coded against what the previous
+one decodes to. Every sequence is decoded again to check it, and the sizes are reported.
+
+Examples:
+  tools/frames_encode.py tools/frames/*.csv                  # writes heart_frames_data.h
+  tools/frames_encode.py --frame-ms 40 my.csv -o other.h     # other frame interval and output
+  tools/frames_encode.py --tolerance 2 tools/frames/*.csv    # allow an error of 2 steps for a smaller sequence
+
+@author  Berend Dekens <berend@cyberwizzard.nl>
+@license GNUGPLv3
+"""
+import argparse
+import os
+import re
+import sys
+
+OP_SKIP = 0x00
+OP_DELTA = 0x40
+OP_RUN = 0x80
+OP_LITERAL = 0xC0
+OP_NIBBLES = 0xE0
+MAX_COUNT = 64  # Channels per code for skips and runs
+MAX_COUNT_5 = 32  # Channels per code for literals and nibble deltas
+
+
+def read_csv(path):
+    """Read the frames of a CSV file as lists of ints"""
+    frames = []
+    with open(path) as f:
+        for n, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            values = [int(v) for v in line.split(",")]
+            if any(v < 0 or v > 255 for v in values):
+                sys.exit("%s:%d: brightness out of range" % (path, n))
+            if frames and len(values) != len(frames[0]):
+                sys.exit("%s:%d: %d channels, expected %d" % (path, n, len(values), len(frames[0])))
+            frames.append(values)
+    if not frames:
+        sys.exit("%s: no frames" % path)
+    return frames
+
+
+def step(prev, target, lo, hi, tolerance):
+    """Delta from prev towards target within lo to hi, or None when that does not get within tolerance"""
+    d = min(max(target - prev, lo), hi)
+    return d if abs(prev + d - target) <= tolerance else None
+
+
+def candidates(prev, cur, i, tolerance):
+    """All codes which can start at channel i: (channels covered, bytes, brightness after decoding)"""
+    n = len(cur)
+    if prev is not None:
+        k = 0
+        while i + k < n and k < MAX_COUNT and abs(cur[i + k] - prev[i + k]) <= tolerance:
+            k += 1
+        if k:
+            yield k, [OP_SKIP | (k - 1)], prev[i:i + k]
+        d = step(prev[i], cur[i], -32, 31, tolerance)
+        if d is not None:
+            yield 1, [OP_DELTA | (d & 0x3F)], [prev[i] + d]
+        nibbles = []
+        while i + len(nibbles) < n and len(nibbles) < MAX_COUNT_5:
+            d = step(prev[i + len(nibbles)], cur[i + len(nibbles)], -8, 7, tolerance)
+            if d is None:
+                break
+            nibbles.append(d)
+            packed = [((nibbles[k] & 0x0F) << 4) | (nibbles[k + 1] & 0x0F if k + 1 < len(nibbles) else 0)
+                      for k in range(0, len(nibbles), 2)]
+            yield (len(nibbles), [OP_NIBBLES | (len(nibbles) - 1)] + packed,
+                   [prev[i + k] + nibbles[k] for k in range(len(nibbles))])
+    k = 1
+    while i + k < n and k < MAX_COUNT and abs(cur[i + k] - cur[i]) <= tolerance:
+        k += 1
+    for j in range(1, k + 1):
+        yield j, [OP_RUN | (j - 1), cur[i]], [cur[i]] * j
+    for j in range(1, min(MAX_COUNT_5, n - i) + 1):
+        yield j, [OP_LITERAL | (j - 1)] + cur[i:i + j], cur[i:i + j]
+
+
+def encode_frame(prev, cur, tolerance):
+    """Shortest list of codes for one frame and the brightness it decodes to; prev is None for the key frame"""
+    n = len(cur)
+    # best[i]: shortest coding of channels i to the end and the brightness it gives
+    best = [None] * n + [([], [])]
+    for i in range(n - 1, -1, -1):
+        for k, code, values in candidates(prev, cur, i, tolerance):
+            rest = best[i + k]
+            if best[i] is None or len(code) + len(rest[0]) < len(best[i][0]):
+                best[i] = (code + rest[0], values + rest[1])
+    return best[0]
+
+
+def encode(frames, frame_ms, tolerance):
+    """Header and codes of a whole sequence; every frame is coded against what the previous one decodes to"""
+    data = [len(frames[0]), frame_ms, len(frames) & 0xFF, len(frames) >> 8]
+    prev = None
+    for cur in frames:
+        codes, prev = encode_frame(prev, cur, tolerance)
+        data += codes
+    return data
+
+
+def decode(data):
+    """Decode a sequence the way frames_next() does, starting from dark LEDs"""
+    channels, count = data[0], data[2] | data[3] << 8
+    leds = [0] * channels
+    frames = []
+    p = 4
+    for _ in range(count):
+        l = 0
+        while l < channels:
+            code = data[p]
+            p += 1
+            n = (code & 0x3F) + 1
+            op = code & 0xC0
+            if op == OP_SKIP:
+                l += n
+            elif op == OP_DELTA:
+                d = (code & 0x3F) - (64 if code & 0x20 else 0)
+                leds[l] = (leds[l] + d) & 0xFF
+                l += 1
+            elif op == OP_RUN:
+                leds[l:l + n] = [data[p]] * n
+                p += 1
+                l += n
+            elif code & 0xE0 == OP_NIBBLES:
+                n = (code & 0x1F) + 1
+                for k in range(n):
+                    d = (data[p + k // 2] >> (0 if k & 1 else 4)) & 0x0F
+                    leds[l + k] = (leds[l + k] + d - (16 if d & 0x08 else 0)) & 0xFF
+                p += (n + 1) // 2
+                l += n
+            else:
+                n = (code & 0x1F) + 1
+                leds[l:l + n] = data[p:p + n]
+                p += n
+                l += n
+        frames.append(list(leds))
+    return frames, p
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Encode frame sequences for heart_frames.h")
+    parser.add_argument("csv", nargs="+", help="sequences, one frame per line")
+    parser.add_argument("--frame-ms", type=int, default=25, help="frame interval in ms (default: 25)")
+    parser.add_argument("--tolerance", type=int, default=0,
+                        help="largest brightness error allowed to make the sequence smaller (default: 0, exact)")
+    parser.add_argument("-o", default="heart_frames_data.h", help="output header (default: heart_frames_data.h)")
+    args = parser.parse_args()
+    if not 1 <= args.frame_ms <= 255:
+        sys.exit("--frame-ms must be 1 to 255")
+
+    names = []
+    body = []
+    for path in args.csv:
+        frames = read_csv(path)
+        if len(frames) > 0xFFFF or len(frames[0]) > 64:
+            sys.exit("%s: at most 65535 frames of 64 channels" % path)
+        data = encode(frames, args.frame_ms, args.tolerance)
+        decoded, size = decode(data)
+        error = max(abs(a - b) for fd, fo in zip(decoded, frames) for a, b in zip(fd, fo))
+        if error > args.tolerance or size != len(data):
+            sys.exit("%s: the coded sequence does not decode to the original" % path)
+        name = "FRAMES_" + re.sub(r"\W", "_", os.path.splitext(os.path.basename(path))[0]).upper()
+        raw = len(frames) * len(frames[0])
+        print("%-24s %4d frames of %2d channels: %6d bytes raw, %5d coded (%.1f bytes per frame, error %d)" %
+              (name, len(frames), len(frames[0]), raw, len(data), (len(data) - 4) / len(frames), error))
+        body.append("// %s: %d frames of %d channels at %d ms, %d bytes instead of %d" %
+                    (os.path.basename(path), len(frames), len(frames[0]), args.frame_ms, len(data), raw))
+        body.append("static const uint8_t %s [%d] PROGMEM = {" % (name, len(data)))
+        for i in range(0, len(data), 24):
+            body.append("  " + ", ".join("0x%02X" % b for b in data[i:i + 24]) + ",")
+        body.append("};")
+        body.append("")
+        names.append(name)
+
+    guard = "_" + re.sub(r"\W", "_", os.path.basename(args.o)).upper() + "_"
+    with open(args.o, "w") as f:
+        f.write("/**\n")
+        f.write(" * %s - Heart PCB Project - Recorded frame sequences, see heart_frames.h\n" % os.path.basename(args.o))
+        f.write(" * \n")
+        f.write(" * Generated by tools/frames_encode.py from %s; do not edit\n" %
+                ", ".join(os.path.basename(p) for p in args.csv))
+        f.write(" *\n * @license GNUGPLv3\n */\n")
+        f.write("#ifndef %s\n#define %s\n\n#include <avr/pgmspace.h>\n\n" % (guard, guard))
+        f.write("\n".join(body))
+        f.write("\n#define FRAMES_NUM_SEQUENCES %d\n" % len(names))
+        f.write("#define FRAMES_SEQUENCES { %s }\n\n#endif" % ", ".join(names))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,131 @@
+/**
+ * governor_sim.cpp - Heart PCB Project - Run the PWM governor on a PC against a model of the ISR and animation load
+ *
+ * Compiled together with heart_governor.cpp with SUPPORT_GOVERNOR. The ISR is not run; it is modelled by the CPU time
+ * of an average tick and of the longest tick (a fader update), and the animation by the CPU time it needs between two
+ * calls to yield(). The program feeds governor_service() what the ISR would measure at the current interval: the busy
+ * time, the time between two calls and a missed tick for every fader update which takes longer than the interval.
+ *
+ * Four loads are run for 100 s each:
+ *   light - a simple animation and a short ISR
+ *   heavy - an animation which computes a lot between two steps and an ISR with many active faders
+ *   peaky - a short average tick with a fader update longer than ISR_MINIMUM_INTERVAL_US
+ *   full  - an ISR which would take more than 100 - GOVERNOR_RESERVE_PCT of the CPU at the shortest interval
+ * The program checks that the interval stays within GOVERNOR_MIN_INTERVAL_US and GOVERNOR_MAX_INTERVAL_US, that no tick
+ * is missed at the interval it settles at (apart from a try of a shorter one after every hold) and that the faders keep
+ * their speed.
+ *
+ * Build and run from the repository root (the flags match those of tools/pwm_sweep.py):
+ *   g++ -O2 -std=gnu++11 -fpermissive -Wall -Wno-narrowing -Itools/host -I. -DSUPPORT_GOVERNOR \
+ *       tools/governor_sim.cpp heart_governor.cpp -o governor_sim
+ *   ./governor_sim
+ *
+ * Prints the interval the governor picked every 20 s and exits with 1 when a check failed.
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.16
+ * @license GNUGPLv3
+ */
+#include <stdio.h>
+#include <math.h>
+#include "Arduino.h"
+#include "TimerOne.h"
+#include "heart_isr.h"
+#include "heart_governor.h"
+#include "heart_time.h"
+
+#ifndef SUPPORT_GOVERNOR
+#error "Build the governor simulation with -DSUPPORT_GOVERNOR"
+#endif
+
+volatile uint8_t  PORTD, PORTB, PIND, PINB, TIFR1, SREG;
+volatile uint16_t TCNT1, ICR1;
+TimerOne Timer1;
+
+// Normally in heart_isr.cpp, which is not part of this build
+volatile uint8_t  _err = 0;
+volatile uint16_t _isr_missed = 0;
+volatile uint8_t  _pwm_tail_long = 0;
+
+static double sim_ms;
+
+unsigned long millis() {
+  return (unsigned long)sim_ms;
+}
+
+// Normally in heart_time.cpp
+uint32_t heart_millis() {
+  return millis();
+}
+
+static uint8_t failures;
+
+/**
+ * Run one load for 100 s
+ * @param isr_us  CPU time of an average tick in us
+ * @param peak_us CPU time of a tick with a fader update in us
+ * @param work_ms CPU time the animation needs between two calls to yield() in ms
+ */
+static void run(const char *name, double isr_us, double peak_us, double work_ms) {
+  governor_interval_us = TIMER_INTERVAL_US;
+  _fader_update_ticks = FADER_UPDATE_TICKS;
+  Timer1.setPeriod(TIMER_INTERVAL_US);
+  _isr_missed = 0;
+  governor_service();
+
+  uint8_t us_min = 255, us_max = 0;
+  uint16_t probes = 0;
+  uint8_t missing = 0;
+  for(uint16_t w = 1; w <= 400; w++) {
+    const uint16_t missed = _isr_missed;
+    // One decision window, with many calls to yield()
+    for(double t = 0; t < GOVERNOR_UPDATE_MS; ) {
+      const double us = governor_interval_us;
+      const double load = (isr_us / us < 0.99) ? isr_us / us : 0.99;
+      const double gap_ms = work_ms / (1 - load);
+      const double ticks = gap_ms * 1000 / us;
+      sim_ms += gap_ms;
+      t += gap_ms;
+      _governor_busy += (uint32_t)(ticks * isr_us * (F_CPU / 1000000UL));
+      if(peak_us > us) _isr_missed += (uint16_t)ceil(ticks / _fader_update_ticks);
+      governor_service();
+    }
+    if(governor_interval_us < us_min) us_min = governor_interval_us;
+    if(governor_interval_us > us_max) us_max = governor_interval_us;
+    // Times ticks started to get missed in the last 50 s: only the tries of a shorter interval after each hold
+    if(w > 200 && _isr_missed != missed && !missing) probes++;
+    missing = (_isr_missed != missed);
+
+    if(w % 80 == 0) {
+      const double us = governor_interval_us;
+      const double fader_us = (double)_fader_update_ticks * us * 3;
+      printf("%-6s t=%3.0fs interval=%2u us (%3.0f Hz PWM) isr_load=%2.0f%% loop_gap=%4.1f ms fader_period=%5.0f us "
+             "(nominal %lu, %+.2f%%)\n", name, w * GOVERNOR_UPDATE_MS / 1000.0, governor_interval_us,
+             1e6 / (us * PWM_STEPS), 100 * isr_us / us, work_ms / (1 - isr_us / us), fader_us,
+             (unsigned long)FADER_UPDATE_INTERVAL_US, 100 * (fader_us - FADER_UPDATE_INTERVAL_US) / FADER_UPDATE_INTERVAL_US);
+      if(fabs(fader_us - FADER_UPDATE_INTERVAL_US) > FADER_UPDATE_INTERVAL_US / 100) {
+        printf("  FAIL: the faders run more than 1%% off\n");
+        failures++;
+      }
+    }
+  }
+  if(us_min < GOVERNOR_MIN_INTERVAL_US || us_max > GOVERNOR_MAX_INTERVAL_US) {
+    printf("  FAIL: interval %u to %u us, outside of the bounds\n", us_min, us_max);
+    failures++;
+  }
+  printf("%-6s interval %u to %u us, ticks missed %u times in the last 50 s\n", name, us_min, us_max, probes);
+  if(probes > 200 / 40 + 1 && peak_us <= GOVERNOR_MAX_INTERVAL_US) {
+    printf("  FAIL: the governor keeps missing ticks\n");
+    failures++;
+  }
+}
+
+int main() {
+  run("light", 8, 14, 2);
+  run("heavy", 13, 24, 12);
+  run("peaky", 9, 40, 4);
+  run("full", 24, 30, 10);
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/**
+ * Arduino.h - Heart PCB Project - Minimal stand-in for the Arduino core to compile the ISR on a PC
+ *
+ * Only provides what the firmware sources the host programs in tools/ compile need; the AVR registers are plain
+ * variables which the host program defines (see tools/pwm_sweep.cpp).
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @license GNUGPLv3
+ */
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+// Time since boot; the host program defines these to run its simulated clock
+unsigned long millis();
+unsigned long micros();
+
+/**
+ * Serial port; the host program defines Serial and these members to decide what happens to the bytes
+ * (see tools/stream_loopback.cpp)
+ */
+class HardwareSerial {
+public:
+  int availableForWrite();
+  size_t write(uint8_t c);
+};
+extern HardwareSerial Serial;
+
+#endif
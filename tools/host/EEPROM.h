@@ -0,0 +1,41 @@
+/**
+ * EEPROM.h - Heart PCB Project - Minimal stand-in for the Arduino EEPROM library to compile heart_eeprom.cpp on a PC
+ *
+ * Works on a byte array which the host program defines, together with the counters of the bytes read and written and
+ * the EEPROM object itself; update() and put() only write the bytes which differ, like the real library (see
+ * tools/eeprom_model.cpp).
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @license GNUGPLv3
+ */
+#ifndef _HOST_EEPROM_H_
+#define _HOST_EEPROM_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+extern uint8_t  host_eeprom [E2END + 1];
+extern uint32_t host_eeprom_reads;
+extern uint32_t host_eeprom_writes;
+
+class EEPROMClass {
+public:
+  uint8_t read(int addr) { host_eeprom_reads++; return host_eeprom[addr]; }
+  void write(int addr, uint8_t v) { host_eeprom_writes++; host_eeprom[addr] = v; }
+  void update(int addr, uint8_t v) { if(read(addr) != v) write(addr, v); }
+  uint16_t length() { return E2END + 1; }
+
+  template<typename T> T &get(int addr, T &t) {
+    for(unsigned i = 0; i < sizeof(T); i++) ((uint8_t *)&t)[i] = read(addr + i);
+    return t;
+  }
+
+  template<typename T> const T &put(int addr, const T &t) {
+    for(unsigned i = 0; i < sizeof(T); i++) update(addr + i, ((const uint8_t *)&t)[i]);
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+/**
+ * TimerOne.h - Heart PCB Project - Minimal stand-in for the TimerOne library to compile the firmware on a PC
+ *
+ * Setting the period only sets ICR1 the way the library does for the short intervals of the PWM (no prescaler, phase
+ * correct PWM: 8 counts per us of the period); the host program calls the ISR itself.
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @license GNUGPLv3
+ */
+#ifndef _HOST_TIMERONE_H_
+#define _HOST_TIMERONE_H_
+
+#include <avr/io.h>
+
+class TimerOne {
+public:
+  void initialize(long us) { setPeriod(us); }
+  void setPeriod(long us) { ICR1 = 8 * us; }
+  void attachInterrupt(void (* /* isr */)()) {}
+  void start() {}
+  void stop() {}
+};
+
+extern TimerOne Timer1;
+
+#endif
\ No newline at end of file
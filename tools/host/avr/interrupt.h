@@ -0,0 +1,15 @@
+/**
+ * avr/interrupt.h - Heart PCB Project - Interrupt control is a no-op on a PC, the ISR is called by the host program
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @license GNUGPLv3
+ */
+#ifndef _HOST_AVR_INTERRUPT_H_
+#define _HOST_AVR_INTERRUPT_H_
+
+#define cli()
+#define sei()
+#define ISR(__vect, ...) extern "C" void __vect(void)
+#define ISR_NOBLOCK
+
+#endif
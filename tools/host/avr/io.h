@@ -0,0 +1,48 @@
+/**
+ * avr/io.h - Heart PCB Project - AVR registers as plain variables to compile the ISR on a PC
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @license GNUGPLv3
+ */
+#ifndef _HOST_AVR_IO_H_
+#define _HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+#ifdef HOST_REGISTER_MODEL
+/**
+ * A register which tells the model of the hardware about every write (tools/shift_model.cpp); the model defines
+ * host_register_write(), which gets the register and the value it had before the write
+ */
+class host_register;
+void host_register_write(host_register *reg, uint8_t old);
+
+class host_register {
+public:
+  uint8_t value;
+  operator uint8_t() const { return value; }
+  host_register &operator=(uint8_t v) { const uint8_t old = value; value = v; host_register_write(this, old); return *this; }
+  host_register &operator|=(uint8_t v) { return *this = value | v; }
+  host_register &operator&=(uint8_t v) { return *this = value & v; }
+};
+
+extern host_register     PORTB, SPDR, EECR;
+extern volatile uint8_t  PORTD, PIND, PINB, TIFR1, SREG, DDRB, SPCR, SPSR, EEDR;
+#else
+extern volatile uint8_t  PORTD, PORTB, PIND, PINB, TIFR1, SREG, DDRB, SPCR, SPSR, SPDR, EECR, EEDR;
+#endif
+extern volatile uint16_t TCNT1, ICR1, EEAR;
+
+#define TOV1  0
+#define SPIF  7
+#define SPE   6
+#define MSTR  4
+#define SPI2X 0
+#define EERE  0
+#define EEPE  1
+#define EEMPE 2
+#define EERIE 3
+#define E2END 1023
+#define _BV(x) (1 << (x))
+
+#endif
@@ -0,0 +1,16 @@
+/**
+ * avr/pgmspace.h - Heart PCB Project - Program memory is ordinary memory on a PC
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @license GNUGPLv3
+ */
+#ifndef _HOST_AVR_PGMSPACE_H_
+#define _HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(__p) (*(const uint8_t *)(__p))
+#define pgm_read_word(__p) (*(const uint16_t *)(__p))
+
+#endif
@@ -0,0 +1,201 @@
+/**
+ * pwm_sweep.cpp - Heart PCB Project - Run the PWM and fader ISR on a PC and measure one timing configuration
+ *
+ * Compiled together with heart_isr.cpp for one combination of TIMER_FREQ and FADER_UPDATE_FREQ (set with -D) by
+ * tools/pwm_sweep.py, which runs many of these in parallel. The program plays the part of Timer1: it calls heart_isr()
+ * and advances the simulated time by the timer TOP the ISR leaves behind, so long ticks (SUPPORT_PWM_TAIL) count as
+ * well. The LED outputs are read back from the port registers.
+ *
+ * The CPU time of the ISR can not be measured on a PC, it is estimated from the number of ticks with and without a
+ * fader update and the cycle counts given on the command line (by default the 8 us and 24 us the ISR was profiled at).
+ *
+ * Build and run from the repository root (the flags match those of tools/pwm_sweep.py):
+ *   g++ -O2 -std=gnu++11 -fpermissive -Wall -Wno-narrowing -Itools/host -I. -DTIMER_FREQ=100 -DFADER_UPDATE_FREQ=15 \
+ *       tools/pwm_sweep.cpp heart_isr.cpp -o pwm_sweep -lm
+ *   ./pwm_sweep [pwm cycles] [fader cycles] [seconds] [speed ...]
+ *
+ * Prints one line of name=value pairs.
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.06
+ * @license GNUGPLv3
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Arduino.h"
+#include "heart_isr.h"
+#include "heart_governor.h"
+#include "heart_event.h"
+
+volatile uint8_t  PORTD, PORTB, PIND, PINB, TIFR1, SREG;
+volatile uint16_t TCNT1, ICR1;
+
+// Normally in heart_governor.cpp, heart_event.cpp and heart_time.cpp, which are not part of this build; the buttons are
+// never pressed, so only the demo mode timer puts events in the queue (and drops them once it is full)
+volatile uint16_t _fader_update_ticks = FADER_UPDATE_TICKS;
+volatile event_t  _event_queue [EVENT_QUEUE_SIZE];
+volatile uint8_t  _event_head = 0;
+volatile uint8_t  _event_tail = 0;
+volatile uint8_t  event_dropped = 0;
+
+extern uint8_t  _pwm_step;
+extern uint16_t _fader_pending;
+extern volatile uint16_t fader_interval_cnt;
+extern uint16_t demo_tick_cnt;
+
+// LED 0 is on pin 2; the LEDs are active low
+#define LED0_ON() ((PORTD & _BV(2)) == 0)
+
+static double   sim_us;       // Simulated time
+static uint32_t calls;        // ISR calls
+static uint32_t fader_calls;  // ISR calls which updated a fader
+static uint32_t button_calls; // ISR calls which sampled the buttons and counted the demo timer
+static double   on_us;        // Time LED 0 was on in the current PWM period
+static double   period_us;    // Length of the current PWM period
+static double   duty_last;    // Duty cycle of LED 0 in the last complete PWM period
+static double   step_max;     // Largest change in lightness of LED 0 between two PWM periods
+static double   period_min, period_max;
+
+uint32_t heart_micros() {
+  return (uint32_t)sim_us;
+}
+
+/**
+ * CIE lightness (0-100) of a duty cycle (0-1), to express brightness steps the way they are seen
+ */
+static double lightness(double duty) {
+  return (duty > 0.008856) ? 116 * cbrt(duty) - 16 : 903.3 * duty;
+}
+
+/**
+ * One timer tick: run the ISR and let the time pass until the next one
+ */
+static void tick() {
+  const uint16_t pending = _fader_pending;
+  const uint16_t cnt = fader_interval_cnt;
+  const uint16_t active = fader_active;
+  const uint16_t demo = demo_tick_cnt;
+
+  heart_isr();
+  calls++;
+  // The demo timer counts (or wraps) once every time the buttons are sampled
+  if(demo_tick_cnt != demo) button_calls++;
+  // A fader is updated when some were pending, or when the interval restarted with active faders
+  if(pending || (fader_interval_cnt < cnt && active)) fader_calls++;
+
+  // Timer1 counts up to ICR1 and down again at 16 counts per us (phase correct PWM)
+  const double dur = ICR1 / 8.0;
+  if(_pwm_step == 0 && period_us > 0) {
+    // A new PWM period started in this tick: close the previous one
+    const double duty = on_us / period_us;
+    const double step = fabs(lightness(duty) - lightness(duty_last));
+    if(step > step_max) step_max = step;
+    if(period_min == 0 || period_us < period_min) period_min = period_us;
+    if(period_us > period_max) period_max = period_us;
+    duty_last = duty;
+    on_us = 0;
+    period_us = 0;
+  }
+  if(LED0_ON()) on_us += dur;
+  period_us += dur;
+  sim_us += dur;
+}
+
+/**
+ * Start over with all LEDs off, no faders and the given brightness level
+ */
+static void reset(uint8_t level) {
+  for(uint8_t l = 0; l < NUM_LEDS; l++) {
+    FADER_STOP(l);
+    SET_LED_BRIGHTNESS(l, 0, 0);
+  }
+  SET_BRIGHTNESS_SCALE(level);
+  ICR1 = 8 * TIMER_INTERVAL_US;
+  sim_us = 0;
+  calls = 0;
+  fader_calls = 0;
+  button_calls = 0;
+  step_max = 0;
+  // Run into the start of a PWM period so the measurements cover whole periods
+  do { tick(); } while(_pwm_step != 0);
+  sim_us = 0;
+  calls = 0;
+  fader_calls = 0;
+  button_calls = 0;
+  on_us = 0;
+  period_us = 0;
+  duty_last = 0;
+  step_max = 0;
+}
+
+/**
+ * Start a fade on every LED from 0 to 255 with the given speed (in steps of the major byte)
+ */
+static void fade_all(uint8_t speed, uint8_t reload) {
+  for(uint8_t l = 0; l < NUM_LEDS; l++) {
+    fader_delta[l] = speed << 8;
+    fader_upper[l] = 255;
+    fader_lower[l] = 0;
+    fader_reload[l] = reload;
+  }
+  FADER_START_MASK(FADER_ALL);
+}
+
+int main(int argc, char **argv) {
+  const double pwm_cycles   = (argc > 1) ? atof(argv[1]) : 128;
+  const double fader_cycles = (argc > 2) ? atof(argv[2]) : 256;
+  const double seconds      = (argc > 3) ? atof(argv[3]) : 5;
+  uint8_t speeds [16] = { 1, 2, 5, 10 };
+  uint8_t num_speeds = 4;
+  if(argc > 4) {
+    num_speeds = 0;
+    for(int i = 4; i < argc && num_speeds < 16; i++) speeds[num_speeds++] = atoi(argv[i]);
+  }
+  const double cycles_per_us = F_CPU / 1e6;
+
+  // Fade accuracy: time a single fade from 0 to 255 on all LEDs against the time FADER_UPDATE_FREQ promises
+  double ratio_min = 0, ratio_max = 0, fader_hz = 0;
+  for(uint8_t i = 0; i < num_speeds; i++) {
+    reset(0);
+    fade_all(speeds[i], NONE);
+    while(!FADERS_IDLE() && sim_us < 600e6) tick();
+    const double nominal_us = 255.0 / speeds[i] / FADER_UPDATE_FREQ * 1e6;
+    const double ratio = sim_us / nominal_us;
+    if(i == 0 || ratio < ratio_min) ratio_min = ratio;
+    if(i == 0 || ratio > ratio_max) ratio_max = ratio;
+    if(i == 0) fader_hz = (255.0 / speeds[i]) / (sim_us / 1e6);
+  }
+
+  // Load with every LED fading continuously, at full brightness and at the dimmest level; the lightness steps of the
+  // slowest fade at the dimmest level show how smooth a fade looks. The demo mode is on to count how often the buttons
+  // are sampled, which should not depend on the brightness.
+  double load_full = 0, load_dim = 0, calls_per_s = 0, step = 0, button_hz = 0, button_hz_dim = 0;
+  demo_mode = 1;
+  for(uint8_t dim = 0; dim < 2; dim++) {
+    reset(dim ? NUM_BRIGHTNESS_LEVELS - 1 : 0);
+    fade_all(speeds[0], INVERT);
+    while(sim_us < seconds * 1e6) tick();
+    const double busy_us = (calls * pwm_cycles + fader_calls * fader_cycles) / cycles_per_us;
+    if(dim) {
+      load_dim = busy_us / sim_us * 100;
+      calls_per_s = calls / (sim_us / 1e6);
+      step = step_max;
+      button_hz_dim = button_calls / (sim_us / 1e6);
+    } else {
+      load_full = busy_us / sim_us * 100;
+      button_hz = button_calls / (sim_us / 1e6);
+    }
+  }
+
+  // The longest tick (PWM and a fader update) as a share of the timer interval
+  const double worst_pct = (pwm_cycles + fader_cycles) / cycles_per_us / TIMER_INTERVAL_US * 100;
+
+  printf("timer_freq=%d fader_freq=%d interval_us=%lu refresh_hz=%.2f fader_hz=%.2f fade_ratio_min=%.3f "
+         "fade_ratio_max=%.3f load_pct=%.1f load_dim_pct=%.1f calls_dim_per_s=%.0f worst_tick_pct=%.1f "
+         "step_lstar=%.2f button_hz=%.2f button_hz_dim=%.2f\n",
+         TIMER_FREQ, FADER_UPDATE_FREQ, (unsigned long)TIMER_INTERVAL_US, 1e6 / period_max, fader_hz, ratio_min,
+         ratio_max, load_full, load_dim, calls_per_s, worst_pct, step, button_hz, button_hz_dim);
+  return 0;
+}
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+pwm_sweep.py - Heart PCB Project - Try many PWM and fader timing settings on a PC and rank them
+
+For every combination of TIMER_FREQ and FADER_UPDATE_FREQ (and optionally with and without SUPPORT_PWM_TAIL) the ISR in
+heart_isr.cpp is compiled natively together with tools/pwm_sweep.cpp, which runs it against a model of Timer1 and
+measures the configuration. The builds and runs are spread over all CPU cores. Combinations rejected by the sanity
+checks in heart_settings.h fail to compile and are reported with the #error message.
+
+A configuration is safe when:
+  - it passes the sanity checks of heart_settings.h
+  - the timer interval is at least ISR_MINIMUM_INTERVAL_US
+  - the longest tick (PWM and one fader update) takes at most --max-tick percent of the interval
+  - the ISR takes at most --max-load percent of the CPU with all LEDs fading
+  - the LEDs refresh at least --min-refresh times per second
+  - the buttons and the demo timer are sampled as often at the dimmest brightness level as at full brightness
+
+Safe configurations are ranked by a score out of 100: 40 for the refresh rate (full marks from 150 Hz), 30 for the CPU
+time left to the animations and 30 divided by the factor the fades are off from the speed FADER_UPDATE_FREQ promises
+(see the FIXME in heart_settings.h). The CSV report lists all configurations, safe ones first.
+
+Examples:
+  tools/pwm_sweep.py                                   # default grid, report in pwm_sweep.csv
+  tools/pwm_sweep.py --timer 60:200:20 --fader 10:40:5 # other ranges (start:stop:step, stop included)
+  tools/pwm_sweep.py --tail                            # also try every combination with SUPPORT_PWM_TAIL
+  tools/pwm_sweep.py --pwm-cycles 140 --fader-cycles 300  # other ISR cost estimates
+
+@author  Berend Dekens <berend@cyberwizzard.nl>
+@license GNUGPLv3
+"""
+import argparse
+import concurrent.futures
+import csv
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+# Warnings are on so a problem in the ISR shows up in the sweep; the narrowing ones are those of the brace initialised
+# tables, which the AVR compiler accepts
+CXXFLAGS = ["-O2", "-std=gnu++11", "-fpermissive", "-Wall", "-Wno-narrowing",
+            "-I" + os.path.join(ROOT, "tools", "host"), "-I" + ROOT]
+SOURCES = [os.path.join(ROOT, "tools", "pwm_sweep.cpp"), os.path.join(ROOT, "heart_isr.cpp")]
+
+
+def setting(name):
+    """Read a plain numeric #define from heart_settings.h"""
+    with open(os.path.join(ROOT, "heart_settings.h")) as f:
+        m = re.search(r"^#define %s (\d+)" % name, f.read(), re.M)
+    return int(m.group(1))
+
+
+def span(text):
+    """Parse start:stop:step (stop included) or a comma separated list"""
+    if ":" in text:
+        start, stop, step = (int(v) for v in text.split(":"))
+        return list(range(start, stop + 1, step))
+    return [int(v) for v in text.split(",")]
+
+
+def run(cfg, args, tmp):
+    """Build and measure one configuration; returns a dict with the results or the reason it failed"""
+    timer, fader, tail = cfg
+    row = {"timer_freq": timer, "fader_freq": fader, "pwm_tail": int(tail)}
+    exe = os.path.join(tmp, "sweep_%d_%d_%d" % cfg)
+    defines = ["-DTIMER_FREQ=%d" % timer, "-DFADER_UPDATE_FREQ=%d" % fader] + (["-DSUPPORT_PWM_TAIL"] if tail else [])
+    build = subprocess.run([args.cxx] + CXXFLAGS + defines + SOURCES + ["-o", exe, "-lm"],
+                           stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if build.returncode != 0:
+        m = re.search(r'#error "([^"]*)"', build.stdout)
+        row["reason"] = "settings: " + (m.group(1) if m else "does not compile")
+        return row
+    row["warnings"] = set(re.findall(r"^\S+:\d+:\d+: warning: .*$", build.stdout, re.M))
+    out = subprocess.run([exe, str(args.pwm_cycles), str(args.fader_cycles), str(args.seconds)] +
+                         [str(s) for s in args.speeds], stdout=subprocess.PIPE, universal_newlines=True).stdout
+    os.remove(exe)
+    for pair in out.split():
+        key, value = pair.split("=")
+        row[key] = float(value) if "." in value else int(value)
+    return row
+
+
+def judge(row, args, isr_min_us):
+    """Apply the safety limits and compute the score"""
+    if "reason" in row:
+        return
+    reasons = []
+    if row["interval_us"] < isr_min_us:
+        reasons.append("interval below ISR_MINIMUM_INTERVAL_US")
+    if row["worst_tick_pct"] > args.max_tick:
+        reasons.append("longest tick %.0f%% of the interval" % row["worst_tick_pct"])
+    if row["load_pct"] > args.max_load:
+        reasons.append("ISR load %.0f%%" % row["load_pct"])
+    if row["refresh_hz"] < args.min_refresh:
+        reasons.append("refresh %.0f Hz" % row["refresh_hz"])
+    if abs(row["button_hz_dim"] - row["button_hz"]) > row["button_hz"] / 100:
+        reasons.append("buttons sampled at %.0f Hz when dimmed" % row["button_hz_dim"])
+    row["reason"] = "; ".join(reasons)
+    # Fade accuracy: how many times too fast or too slow the worst of the speeds is
+    factor = max(row["fade_ratio_max"], 1 / row["fade_ratio_min"])
+    row["score"] = round(40 * min(row["refresh_hz"] / 150, 1) + 30 * (1 - row["load_pct"] / 100) + 30 / factor, 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sweep the PWM and fader timing settings and rank them")
+    parser.add_argument("--timer", default="50:250:10", help="TIMER_FREQ values (start:stop:step or a list)")
+    parser.add_argument("--fader", default="5:60:5", help="FADER_UPDATE_FREQ values (start:stop:step or a list)")
+    parser.add_argument("--tail", action="store_true", help="also try every combination with SUPPORT_PWM_TAIL")
+    parser.add_argument("--speeds", type=int, nargs="+", default=[1, 2, 5, 10], help="fade speeds (major steps)")
+    parser.add_argument("--seconds", type=float, default=5, help="simulated time per load measurement")
+    parser.add_argument("--pwm-cycles", type=float, default=128, help="CPU cycles of a tick without fader update")
+    parser.add_argument("--fader-cycles", type=float, default=256, help="extra CPU cycles of a fader update")
+    parser.add_argument("--max-tick", type=float, default=80, help="limit for the longest tick in %% of the interval")
+    parser.add_argument("--max-load", type=float, default=50, help="limit for the ISR load in %%")
+    parser.add_argument("--min-refresh", type=float, default=90, help="lowest acceptable refresh rate in Hz")
+    parser.add_argument("-j", type=int, default=os.cpu_count(), help="parallel jobs (default: all cores)")
+    parser.add_argument("--cxx", default="g++", help="host C++ compiler")
+    parser.add_argument("-o", default="pwm_sweep.csv", help="CSV report")
+    args = parser.parse_args()
+
+    configs = [(t, f, tail) for t in span(args.timer) for f in span(args.fader)
+               for tail in ([False, True] if args.tail else [False])]
+    isr_min_us = setting("ISR_MINIMUM_INTERVAL_US")
+    rows = []
+    with tempfile.TemporaryDirectory() as tmp:
+        with concurrent.futures.ThreadPoolExecutor(max_workers=args.j) as pool:
+            for n, row in enumerate(pool.map(lambda c: run(c, args, tmp), configs), 1):
+                judge(row, args, isr_min_us)
+                rows.append(row)
+                if sys.stderr.isatty():
+                    print("\r%d/%d configurations" % (n, len(configs)), end="", file=sys.stderr)
+    if sys.stderr.isatty():
+        print(file=sys.stderr)
+
+    safe = sorted((r for r in rows if not r["reason"]), key=lambda r: -r["score"])
+    unsafe = [r for r in rows if r["reason"]]
+    fields = ["timer_freq", "fader_freq", "pwm_tail", "score", "interval_us", "refresh_hz", "fader_hz",
+              "fade_ratio_min", "fade_ratio_max", "load_pct", "load_dim_pct", "calls_dim_per_s", "worst_tick_pct",
+              "step_lstar", "button_hz", "button_hz_dim", "reason"]
+    with open(args.o, "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=fields, extrasaction="ignore")
+        w.writeheader()
+        for r in safe + unsafe:
+            w.writerow(r)
+
+    warnings = sorted(set().union(*(r.get("warnings", set()) for r in rows)))
+    for w in warnings:
+        print(w, file=sys.stderr)
+    print("%d of %d configurations are safe, report in %s" % (len(safe), len(rows), args.o))
+    for r in safe[:10]:
+        print("  TIMER_FREQ %3d  FADER_UPDATE_FREQ %2d%s  score %5.1f  refresh %6.1f Hz  load %4.1f%%  tick %3.0f%%  "
+              "fades x%.2f" % (r["timer_freq"], r["fader_freq"], "  PWM_TAIL" if r["pwm_tail"] else "", r["score"],
+                              r["refresh_hz"], r["load_pct"], r["worst_tick_pct"], r["fade_ratio_max"]))
+
+
+if __name__ == "__main__":
+    main()
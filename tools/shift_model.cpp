@@ -0,0 +1,207 @@
+/**
+ * shift_model.cpp - Heart PCB Project - Run the ISR with SUPPORT_SHIFT_OUT on a PC against a model of the shift registers
+ *
+ * Compiled together with heart_isr.cpp and heart_shift.cpp for one chain length (SHIFT_CHANNELS, set with -D). PORTB
+ * and SPDR are replaced by registers which report every write (HOST_REGISTER_MODEL in tools/host/avr/io.h), which drive
+ * a model of a chain of 74HC595s: every byte written to SPDR shifts 8 bits into the chain, MSB first, and a rising edge
+ * on the latch pin copies the chain to the outputs. After every ISR call the outputs are sampled, so the time each
+ * channel is on in a PWM period follows from the bitstreams the ISR actually emitted.
+ *
+ * The program checks that every channel is on for (brightness * scale) >> 8 ticks per period (the brightness the
+ * software PWM shows) for every brightness value and level, with random brightness on all channels and with all faders
+ * running, and reports the SPI traffic and an estimate of the CPU time against the software PWM, both for the same number
+ * of channels and for the 10 LEDs the board drives directly.
+ *
+ * Build and run from the repository root (the flags match those of tools/pwm_sweep.py):
+ *   g++ -O2 -std=gnu++11 -fpermissive -Wall -Wno-narrowing -Itools/host -I. -DHOST_REGISTER_MODEL -DSUPPORT_SHIFT_OUT \
+ *       -DSHIFT_CHANNELS=32 tools/shift_model.cpp heart_isr.cpp heart_shift.cpp -o shift_model
+ *   ./shift_model [cycles per SPI byte] [cycles per group] [cycles per LED of the software PWM]
+ *
+ * Prints the measurements and exits with 1 when a channel showed the wrong brightness.
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.10
+ * @license GNUGPLv3
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "heart_isr.h"
+#include "heart_governor.h"
+#include "heart_event.h"
+#include "heart_shift.h"
+
+#ifndef SUPPORT_SHIFT_OUT
+#error "Build the shift register model with -DSUPPORT_SHIFT_OUT"
+#endif
+
+host_register     PORTB, SPDR;
+volatile uint8_t  PORTD, PIND, PINB, TIFR1, SREG, DDRB, SPCR, SPSR;
+volatile uint16_t TCNT1, ICR1;
+
+// Normally in heart_governor.cpp, heart_event.cpp and heart_time.cpp, which are not part of this build; the buttons are
+// never pressed, so only the demo mode timer puts events in the queue
+volatile uint16_t _fader_update_ticks = FADER_UPDATE_TICKS;
+volatile event_t  _event_queue [EVENT_QUEUE_SIZE];
+volatile uint8_t  _event_head = 0;
+volatile uint8_t  _event_tail = 0;
+volatile uint8_t  event_dropped = 0;
+
+extern uint8_t _pwm_step;
+
+static uint32_t sim_us;
+
+uint32_t heart_micros() {
+  return sim_us;
+}
+
+// The chain: bit p is the output p places from the data input, which is channel p once the whole chain is written
+static uint8_t chain [SHIFT_CHANNELS];
+// Outputs of the latches, 1 for a high pin
+static uint8_t latched [SHIFT_CHANNELS];
+
+static uint32_t spi_bytes;   // Bytes written to SPDR
+static uint32_t latches;     // Rising edges on the latch pin
+
+/**
+ * Hardware model: SPI transfers into the chain and the latch clock
+ */
+void host_register_write(host_register *reg, uint8_t old) {
+  if(reg == &SPDR) {
+    for(int8_t b = 7; b >= 0; b--) {
+      memmove(chain + 1, chain, SHIFT_CHANNELS - 1);
+      chain[0] = (SPDR.value >> b) & 1;
+    }
+    spi_bytes++;
+    SPSR |= _BV(SPIF);
+  } else if(reg == &PORTB) {
+    if(!(old & SHIFT_LATCH_MASK) && (PORTB.value & SHIFT_LATCH_MASK)) {
+      memcpy(latched, chain, SHIFT_CHANNELS);
+      latches++;
+    }
+  }
+}
+
+/**
+ * Is a channel on according to the latched outputs
+ */
+static inline uint8_t channel_on(uint8_t c) {
+#ifdef SHIFT_ACTIVE_HIGH
+  return latched[c];
+#else
+  return !latched[c];
+#endif
+}
+
+static uint16_t on_ticks [SHIFT_CHANNELS];  // Ticks each channel was on in the last complete period
+static uint32_t groups_min;                 // Fewest groups of planes computed in a period
+
+/**
+ * Run one whole PWM period (from step 0 to 255) and count the ticks every channel is on
+ */
+static void period() {
+  memset(on_ticks, 0, sizeof(on_ticks));
+  do {
+    if(_pwm_step == 254 && _shift_group < groups_min) groups_min = _shift_group;
+    heart_isr();
+    for(uint8_t c = 0; c < SHIFT_CHANNELS; c++) on_ticks[c] += channel_on(c);
+    sim_us += TIMER_INTERVAL_US;
+  } while(_pwm_step != 255);
+}
+
+/**
+ * Run into the start of a PWM period (the next tick is step 0)
+ */
+static void align() {
+  while(_pwm_step != 255) {
+    heart_isr();
+    sim_us += TIMER_INTERVAL_US;
+  }
+}
+
+/**
+ * Set the brightness and check the channels after the planes went through the pipeline: computed in one period, shown
+ * in the next
+ * @return number of channels with the wrong on time
+ */
+static uint16_t verify(const uint8_t *brightness) {
+  for(uint8_t c = 0; c < NUM_LEDS; c++) SET_LED_BRIGHTNESS(c, brightness[c], 0);
+  align();
+  period();
+  period();
+  period();
+  uint16_t errors = 0;
+  for(uint8_t c = 0; c < NUM_LEDS; c++) {
+    const uint16_t expect = ((uint16_t)brightness[c] * _shift_scale) >> 8;
+    if(on_ticks[c] != expect) {
+      if(errors < 5) printf("  channel %u brightness %u scale %u: on %u ticks, expected %u\n", c, brightness[c],
+                            _shift_scale, on_ticks[c], expect);
+      errors++;
+    }
+  }
+  return errors;
+}
+
+int main(int argc, char **argv) {
+  const double byte_cycles  = (argc > 1) ? atof(argv[1]) : 20;
+  const double group_cycles = (argc > 2) ? atof(argv[2]) : 160;
+  const double led_cycles   = (argc > 3) ? atof(argv[3]) : 10;
+  uint8_t brightness [NUM_LEDS];
+  uint32_t errors = 0, checks = 0;
+
+  ICR1 = 8 * TIMER_INTERVAL_US;
+  PORTB.value = 0;
+  SPDR.value = 0;
+  shift_init();
+
+  // Every brightness value on every channel, at every brightness level
+  for(uint8_t level = 0; level < NUM_BRIGHTNESS_LEVELS; level++) {
+    SET_BRIGHTNESS_SCALE(level);
+    for(uint16_t b = 0; b < 256; b++) {
+      for(uint8_t c = 0; c < NUM_LEDS; c++) brightness[c] = (b + c * 37) & 0xFF;
+      errors += verify(brightness);
+      checks += NUM_LEDS;
+    }
+  }
+
+  // Random brightness
+  SET_BRIGHTNESS_SCALE(0);
+  srand(1);
+  for(uint16_t n = 0; n < 200; n++) {
+    for(uint8_t c = 0; c < NUM_LEDS; c++) brightness[c] = rand() & 0xFF;
+    errors += verify(brightness);
+    checks += NUM_LEDS;
+  }
+
+  // Traffic per period with all faders running: the planes have to be ready in time in spite of the fader updates
+  for(uint8_t c = 0; c < NUM_LEDS; c++) {
+    fader_delta[c] = 3 << 8;
+    fader_upper[c] = 255;
+    fader_lower[c] = 0;
+    fader_reload[c] = INVERT;
+  }
+  FADER_START_MASK(FADER_ALL);
+  align();
+  groups_min = 255;
+  spi_bytes = 0;
+  latches = 0;
+  const uint16_t periods = 100;
+  for(uint16_t n = 0; n < periods; n++) period();
+
+  const double bytes_per_period = (double)spi_bytes / periods;
+  const double latches_per_period = (double)latches / periods;
+  // Each output takes the SPI bytes and a latch pulse (4 cycles); each group the transpose of 8 channels
+  const double shift_cycles = bytes_per_period * byte_cycles + latches_per_period * 4 + SHIFT_BYTES * group_cycles;
+  // The software PWM compares every LED on every one of the 256 steps: for as many channels as the chain has, and for
+  // the 10 LEDs on pins 2 to 11 it drives without the shift registers
+  const double pwm_cycles = 256.0 * NUM_LEDS * led_cycles;
+  const double pwm_direct_cycles = 256.0 * 10 * led_cycles;
+
+  printf("channels=%u checks=%lu errors=%lu spi_bytes_per_period=%.1f latches_per_period=%.1f groups_min=%lu "
+         "shift_cycles_per_period=%.0f pwm_cycles_per_period=%.0f pwm_direct_cycles_per_period=%.0f\n", SHIFT_CHANNELS,
+         (unsigned long)checks, (unsigned long)errors, bytes_per_period, latches_per_period, (unsigned long)groups_min,
+         shift_cycles, pwm_cycles, pwm_direct_cycles);
+  return (errors || groups_min < SHIFT_BYTES) ? 1 : 0;
+}
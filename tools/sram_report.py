@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+sram_report.py - Heart PCB Project - Static SRAM use of a build, per module
+
+Lists the static variables (.data and .bss) in the object files of a build with nm, adds them up per module (one source
+file of the sketch, or one member of the Arduino core library) and shows what is left of the SRAM for the stack. When
+the build directory holds the linked .elf, only the variables which made it into the firmware are counted (the linker
+drops unused ones); otherwise the numbers are an upper bound.
+
+Build with a fixed build directory to find the object files, for example:
+  arduino-cli compile -b arduino:avr:pro --build-path build .
+  tools/sram_report.py build                      # table per module, largest first
+  tools/sram_report.py build --symbols 5          # also the 5 largest variables of every module
+  tools/sram_report.py build --budget 1600        # exit with 1 when the variables take more than 1600 bytes
+
+Run it for every combination of SUPPORT_* defines which matters to see what a feature costs; the firmware itself
+reports the smallest stack margin it saw with SUPPORT_STACK_CHECK (see heart_memory.h).
+
+@author  Berend Dekens <berend@cyberwizzard.nl>
+@license GNUGPLv3
+"""
+import argparse
+import collections
+import glob
+import os
+import subprocess
+import sys
+
+SRAM_SIZE = 2048  # ATmega328
+
+
+def nm(tool, path):
+    """Static variables in an object file or archive: list of (module, name, size)"""
+    out = subprocess.run([tool, "-S", "-C", path], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                         universal_newlines=True).stdout
+    module = os.path.basename(path)
+    found = []
+    for line in out.splitlines():
+        if line.endswith(":"):
+            # Member of an archive
+            module = line[:-1]
+            continue
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in "bBdD":
+            found.append((module, parts[3], int(parts[1], 16)))
+    return found
+
+
+def module_name(name):
+    """heart_isr.cpp.o -> heart_isr.cpp"""
+    for ext in (".o", ".obj"):
+        if name.endswith(ext):
+            name = name[:-len(ext)]
+    return name
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Static SRAM use of a build, per module")
+    parser.add_argument("build", help="build directory with the object files (searched recursively)")
+    parser.add_argument("--nm", default="avr-nm", help="nm of the toolchain (default: avr-nm)")
+    parser.add_argument("--symbols", type=int, default=0, help="also list the largest variables of every module")
+    parser.add_argument("--budget", type=int, help="exit with 1 when the variables take more bytes than this")
+    parser.add_argument("--sram", type=int, default=SRAM_SIZE, help="SRAM size (default: %d)" % SRAM_SIZE)
+    args = parser.parse_args()
+
+    objects = sorted(glob.glob(os.path.join(args.build, "**", "*.o"), recursive=True) +
+                     glob.glob(os.path.join(args.build, "**", "*.a"), recursive=True))
+    if not objects:
+        sys.exit("no object files in %s" % args.build)
+    elfs = glob.glob(os.path.join(args.build, "*.elf"))
+    linked = None
+    if elfs:
+        linked = collections.Counter((name, size) for _, name, size in nm(args.nm, elfs[0]))
+
+    modules = collections.defaultdict(list)
+    # The objects of the core are in its archive as well; count them once
+    seen = set(os.path.basename(p) for p in objects if p.endswith(".o"))
+    for path in objects:
+        for module, name, size in nm(args.nm, path):
+            if path.endswith(".a") and module in seen:
+                continue
+            if linked is not None:
+                if not linked[(name, size)]:
+                    continue
+                linked[(name, size)] -= 1
+            modules[module_name(module)].append((size, name))
+
+    rows = sorted(((sum(s for s, _ in v), k, sorted(v, reverse=True)) for k, v in modules.items() if v), reverse=True)
+    total = sum(r[0] for r in rows)
+    print("%-32s %6s %6s" % ("module", "bytes", "share"))
+    for size, module, symbols in rows:
+        print("%-32s %6d %5.1f%%" % (module, size, 100.0 * size / args.sram))
+        for s, name in symbols[:args.symbols]:
+            print("    %-28s %6d" % (name[:28], s))
+    print("%-32s %6d %5.1f%%" % ("total static", total, 100.0 * total / args.sram))
+    print("%-32s %6d %5.1f%%" % ("left for the stack", args.sram - total, 100.0 * (args.sram - total) / args.sram))
+    if linked is None:
+        print("(no .elf found: variables the linker drops are counted too)")
+    if args.budget is not None and total > args.budget:
+        print("over the budget of %d bytes by %d" % (args.budget, total - args.budget))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+stream.py - Heart PCB Project - Host side sender for the LED frame streaming mode
+
+Sends LED frames to a board built with SUPPORT_STREAM (see heart_stream.h for the frame layout) at a fixed frame
+rate and measures the end-to-end latency from sending a frame until the firmware acknowledges it was shown.
+
+Examples:
+  tools/stream.py /dev/ttyUSB0                          # stream a rotating wave at 100 fps for 10 seconds
+  tools/stream.py /dev/ttyUSB0 --substep --pattern chase
+  tools/stream.py /dev/ttyUSB0 --csv frames.csv         # stream frames from a CSV file (10 or 20 values per line)
+
+@author  Berend Dekens <berend@cyberwizzard.nl>
+@license GNUGPLv3
+"""
+import argparse
+import csv
+import math
+import statistics
+import sys
+import time
+
+NUM_LEDS = 10
+TYPE_MAJOR = 0xA6
+TYPE_RAW = 0xA7
+ACK = 0xA8
+
+
+def encode(seq, values, substep):
+    """Build a frame; values are 16-bit raw brightness values (major in the upper byte)"""
+    if substep:
+        payload = bytearray()
+        for v in values:
+            payload += bytes([v >> 8, v & 0xFF])
+        frame = bytearray([TYPE_RAW, seq])
+    else:
+        payload = bytearray(v >> 8 for v in values)
+        frame = bytearray([TYPE_MAJOR, seq])
+    frame += payload
+    check = seq
+    for b in payload:
+        check ^= b
+    frame.append(check)
+    return bytes(frame)
+
+
+def pattern_wave(n, fps):
+    t = n / fps
+    return [int(32767.5 + 32767.5 * math.sin(2 * math.pi * (t * 0.5 + l / NUM_LEDS))) for l in range(NUM_LEDS)]
+
+
+def pattern_chase(n, fps):
+    pos = (n / fps * 4.0) % NUM_LEDS
+    out = []
+    for l in range(NUM_LEDS):
+        d = min(abs(l - pos), NUM_LEDS - abs(l - pos))
+        out.append(int(max(0.0, 1.0 - d / 2.0) * 65535))
+    return out
+
+
+def frames_from_csv(path):
+    rows = []
+    with open(path, newline="") as f:
+        for row in csv.reader(f):
+            vals = [int(v) for v in row if v.strip()]
+            if len(vals) == NUM_LEDS:
+                rows.append([v << 8 for v in vals])
+            elif len(vals) == 2 * NUM_LEDS:
+                rows.append([vals[2 * l] << 8 | vals[2 * l + 1] for l in range(NUM_LEDS)])
+    return rows
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Stream LED frames to the Heart PCB and measure the latency")
+    ap.add_argument("port", help="serial port")
+    ap.add_argument("--baud", type=int, default=500000, help="baud rate, must match SERIAL_BAUD (default: 500000)")
+    ap.add_argument("--fps", type=float, default=100.0, help="frame rate, must match STREAM_FPS (default: 100)")
+    ap.add_argument("--duration", type=float, default=10.0, help="seconds to stream (default: 10)")
+    ap.add_argument("--substep", action="store_true", help="send 20-byte frames with sub-step brightness")
+    ap.add_argument("--pattern", choices=["wave", "chase"], default="wave", help="generated pattern (default: wave)")
+    ap.add_argument("--csv", help="stream the frames from this CSV file instead of a pattern (loops)")
+    args = ap.parse_args()
+
+    import serial  # pyserial
+    port = serial.Serial(args.port, args.baud, timeout=0)
+    rows = frames_from_csv(args.csv) if args.csv else None
+    gen = pattern_chase if args.pattern == "chase" else pattern_wave
+
+    sent = {}        # seq -> send time
+    latencies = []
+    acks = 0
+    rx = bytearray()
+    period = 1.0 / args.fps
+    start = time.perf_counter()
+    n = 0
+    while True:
+        now = time.perf_counter()
+        if now - start >= args.duration:
+            break
+        due = start + n * period
+        if now >= due:
+            seq = n & 0xFF
+            values = rows[n % len(rows)] if rows else gen(n, args.fps)
+            port.write(encode(seq, values, args.substep))
+            sent[seq] = time.perf_counter()
+            n += 1
+        # Collect acknowledgements; other bytes (command replies, telemetry) are skipped
+        rx += port.read(256)
+        while True:
+            i = rx.find(bytes([ACK]))
+            if i < 0 or i + 1 >= len(rx):
+                if i < 0:
+                    rx.clear()
+                break
+            seq = rx[i + 1]
+            del rx[:i + 2]
+            if seq in sent:
+                latencies.append((time.perf_counter() - sent.pop(seq)) * 1000.0)
+                acks += 1
+        time.sleep(min(0.001, max(0.0, due + period - time.perf_counter())))
+
+    print("frames sent: %d, shown: %d (%.1f%%)" % (n, acks, 100.0 * acks / max(1, n)))
+    if latencies:
+        latencies.sort()
+        print("latency ms: mean %.2f, median %.2f, p99 %.2f, max %.2f" % (
+            statistics.mean(latencies), latencies[len(latencies) // 2],
+            latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))], latencies[-1]))
+    print("send 'c' to read the dropped / late / duplicate counters of the firmware", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,201 @@
+/**
+ * stream_loopback.cpp - Heart PCB Project - Stream frames into the firmware on a PC and measure the latency
+ *
+ * Compiled together with heart_stream.cpp and heart_isr.cpp with SUPPORT_STREAM (and SUPPORT_COMMANDS, which it needs).
+ * The program plays the part of the host (tools/stream.py), the serial link, the main loop and Timer1:
+ *   - the host writes a frame every 1/STREAM_FPS seconds; the USB serial adapter delivers it after a random delay of up
+ *     to the given jitter, and the bytes arrive one by one at SERIAL_BAUD (10 bits per byte)
+ *   - the main loop runs every given interval and hands at most COMMAND_BYTES_PER_CALL received bytes to stream_rx(),
+ *     like command_service(), then calls stream_service() which sends the acknowledgements
+ *   - the ISR runs every timer tick and shows the frames from the jitter buffer at the start of a PWM period
+ *
+ * The latency is measured the way tools/stream.py does: from writing a frame until its acknowledgement arrives. Some
+ * frames are sent twice and some are corrupted on purpose; the program checks that the counters of the firmware catch
+ * exactly these, and that only the gaps of the corrupted frames make the next frame late while the jitter stays within
+ * the prefilled frames.
+ *
+ * Build and run from the repository root (the flags match those of tools/pwm_sweep.py):
+ *   g++ -O2 -std=gnu++11 -fpermissive -Wall -Wno-narrowing -Itools/host -I. -DSUPPORT_COMMANDS -DSUPPORT_STREAM \
+ *       tools/stream_loopback.cpp heart_stream.cpp heart_isr.cpp -o stream_loopback
+ *   ./stream_loopback [seconds] [host jitter ms] [main loop interval us]
+ *
+ * Prints one line of name=value pairs and exits with 1 when a counter is off.
+ *
+ * @author  Berend Dekens <berend@cyberwizzard.nl>
+ * @version 1
+ * @date    2018.10.16
+ * @license GNUGPLv3
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Arduino.h"
+#include "heart_isr.h"
+#include "heart_governor.h"
+#include "heart_event.h"
+#include "heart_stream.h"
+#include "heart_command.h"
+
+#ifndef SUPPORT_STREAM
+#error "Build the stream loopback with -DSUPPORT_STREAM"
+#endif
+
+volatile uint8_t  PORTD, PORTB, PIND, PINB, TIFR1, SREG;
+volatile uint16_t TCNT1, ICR1;
+
+// Normally in heart_governor.cpp, heart_event.cpp, heart_command.cpp and heart_delay.cpp, which are not part of this
+// build; the buttons are never pressed and the demo mode is off
+volatile uint16_t _fader_update_ticks = FADER_UPDATE_TICKS;
+volatile event_t  _event_queue [EVENT_QUEUE_SIZE];
+volatile uint8_t  _event_head = 0;
+volatile uint8_t  _event_tail = 0;
+volatile uint8_t  event_dropped = 0;
+volatile int8_t   command_animation = -1;
+
+volatile uint8_t  _abort_heart_delay = 0;
+
+uint8_t heart_delay(unsigned long /* ms */) { return 0; }
+
+extern volatile uint8_t _stream_active;
+
+// Time of one byte on the serial link in us: start bit, 8 data bits and a stop bit
+#define BYTE_US (10 * 1000000.0 / SERIAL_BAUD)
+#define FRAME_LEN (NUM_LEDS + 3)
+#define FRAME_US (1000000.0 / STREAM_FPS)
+
+static double sim_us;
+
+uint32_t heart_micros() {
+  return (uint32_t)sim_us;
+}
+
+uint32_t heart_millis() {
+  return (uint32_t)(sim_us / 1000);
+}
+
+// Bytes on their way to the board: the time each one is received
+#define RX_SIZE 4096
+static uint8_t  rx_byte [RX_SIZE];
+static double   rx_time [RX_SIZE];
+static uint32_t rx_head, rx_tail;
+static double   rx_free_us;   // The link is busy until then
+
+static double   sent_us [256]; // Time the host wrote the frame with a sequence number
+static uint8_t  ack_state;     // 1 after STREAM_ACK, then the sequence number follows
+static uint32_t acks;
+static double   latency_sum, latency_max, latency_min = 1e9;
+static uint32_t latency_hist [100]; // Per ms
+
+/**
+ * Serial port of the board: only the acknowledgements are sent, they arrive at the host after two byte times
+ */
+int HardwareSerial::availableForWrite() {
+  return 63;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if(ack_state == 0) {
+    ack_state = (c == STREAM_ACK);
+    return 1;
+  }
+  ack_state = 0;
+  const double latency = sim_us + 2 * BYTE_US - sent_us[c];
+  latency_sum += latency;
+  if(latency > latency_max) latency_max = latency;
+  if(latency < latency_min) latency_min = latency;
+  latency_hist[(latency < 99000) ? (int)(latency / 1000) : 99]++;
+  acks++;
+  return 1;
+}
+
+HardwareSerial Serial;
+
+/**
+ * The host writes a frame (like encode() in tools/stream.py); it arrives after the jitter of the adapter
+ */
+static void host_send(uint8_t seq, uint8_t corrupt, double jitter_us) {
+  uint8_t frame [FRAME_LEN];
+  frame[0] = STREAM_TYPE_MAJOR;
+  frame[1] = seq;
+  uint8_t check = seq;
+  for(uint8_t l = 0; l < NUM_LEDS; l++) {
+    frame[2 + l] = (seq * 7 + l * 25) & 0xFF;
+    check ^= frame[2 + l];
+  }
+  frame[FRAME_LEN - 1] = check ^ corrupt;
+
+  sent_us[seq] = sim_us;
+  double t = sim_us + jitter_us * rand() / RAND_MAX;
+  if(t < rx_free_us) t = rx_free_us;
+  for(uint8_t i = 0; i < FRAME_LEN; i++) {
+    t += BYTE_US;
+    rx_byte[rx_head % RX_SIZE] = frame[i];
+    rx_time[rx_head % RX_SIZE] = t;
+    rx_head++;
+  }
+  rx_free_us = t;
+}
+
+/**
+ * One pass of the main loop: the received bytes go to the stream parser, then the acknowledgements go out
+ */
+static void main_loop() {
+  for(uint8_t n = 0; n < COMMAND_BYTES_PER_CALL && rx_tail != rx_head && rx_time[rx_tail % RX_SIZE] <= sim_us; n++) {
+    stream_rx(rx_byte[rx_tail % RX_SIZE]);
+    rx_tail++;
+  }
+  stream_service();
+}
+
+int main(int argc, char **argv) {
+  const double seconds   = (argc > 1) ? atof(argv[1]) : 60;
+  const double jitter_us = ((argc > 2) ? atof(argv[2]) : 4) * 1000;
+  const double main_us   = (argc > 3) ? atof(argv[3]) : 500;
+
+  ICR1 = 8 * TIMER_INTERVAL_US;
+  // The main loop is in animate_stream() from the start
+  _stream_active = 1;
+
+  uint32_t frames = 0, duplicates = 0, corrupted = 0;
+  double next_frame = 0, next_main = 0;
+  uint8_t seq = 0;
+  while(sim_us < seconds * 1e6) {
+    if(sim_us >= next_frame) {
+      // Every 250th frame has a wrong checksum, one in every 100 is sent twice (never a corrupted one)
+      const uint8_t corrupt = (frames % 250 == 249);
+      host_send(seq, corrupt, jitter_us);
+      corrupted += corrupt;
+      if(frames % 100 == 29) {
+        host_send(seq, 0, 0);
+        duplicates++;
+      }
+      seq++;
+      frames++;
+      next_frame += FRAME_US;
+    }
+    if(sim_us >= next_main) {
+      main_loop();
+      next_main += main_us;
+    }
+    heart_isr();
+    sim_us += ICR1 / 8.0;
+  }
+
+  // The latency which 99% of the frames stay below
+  uint32_t p99 = 0, seen = 0;
+  while(p99 < 99 && (seen += latency_hist[p99]) < acks * 0.99) p99++;
+
+  printf("seconds=%.0f fps=%d jitter_ms=%.1f main_us=%.0f frames=%lu acks=%lu latency_ms_min=%.2f latency_ms_avg=%.2f "
+         "latency_ms_p99=%lu latency_ms_max=%.2f dropped=%u late=%u duplicate=%u\n", seconds, STREAM_FPS,
+         jitter_us / 1000, main_us, (unsigned long)frames, (unsigned long)acks, latency_min / 1000,
+         latency_sum / acks / 1000, (unsigned long)p99 + 1, latency_max / 1000, stream_dropped, stream_late,
+         stream_duplicate);
+
+  // A corrupted frame is dropped and leaves a gap which empties the buffer once, a duplicate is counted; while the jitter
+  // fits in the prefill nothing else is late and the buffer never overflows
+  uint8_t ok = (stream_dropped >= corrupted) && (stream_duplicate == duplicates);
+  if(jitter_us < (STREAM_PREFILL_FRAMES - 1) * FRAME_US) {
+    ok = ok && (stream_dropped == corrupted) && (stream_late <= corrupted);
+  }
+  return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+"""
+sync_sim.py - Heart PCB Project - Host simulation of the multi-heart synchronisation (SUPPORT_SYNC)
+
+Starts a chain of simulated hearts as separate processes, each with its own drifting clock, connected by pseudo
+terminals in the same way as the boards are daisy chained (TX of one heart to RX of the next). Every heart runs the
+protocol of heart_sync.cpp: the first heart becomes the master, the others phase lock their time base to the frames and
+relay them. Every heart also steps an animation at fixed deadlines like heart_delay_next(); the master starts a new run
+every --demo seconds and the slaves power up at random moments within --join seconds, halfway a run. Per window, the
+error of the sync time and of the animation steps (the time a slave runs a step minus the time the master runs it) of
+every heart against the master are reported. Exits with 1 when a slave never got in phase.
+
+Examples:
+  tools/sync_sim.py                    # 4 hearts for 20 seconds
+  tools/sync_sim.py -n 8 -t 60         # longer chain
+  tools/sync_sim.py --drift 1000       # clocks off by up to +-1000 ppm
+  tools/sync_sim.py --no-align         # start the steps when the frame arrives instead of at the start of the master
+
+Note that the host scheduler adds much more jitter than a board does; on a machine with a single CPU core expect a
+around a millisecond of error instead of a few hundred us.
+
+@author  Berend Dekens <berend@cyberwizzard.nl>
+@license GNUGPLv3
+"""
+import argparse
+import os
+import random
+import select
+import sys
+import time
+import tty
+
+# Keep in sync with heart_settings.h and heart_sync.h
+SYNC_INTERVAL_MS = 100
+SYNC_TIMEOUT_MS = 1000
+SYNC_FILTER_FRAMES = 4
+SYNC_STEP_US = 10000
+SYNC_MAGIC = 0xA9
+SYNC_FRAME_LEN = 14
+SYNC_LINK_US = SYNC_FRAME_LEN * 10 * 1000000 // 500000
+NUM_ANIMATIONS = 11
+
+
+class Heart:
+    """One heart: a drifting micros() clock and the sync protocol state, like heart_sync.cpp"""
+
+    def __init__(self, rx, tx, drift_ppm, rnd, period_us, align):
+        self.rx = rx
+        self.tx = tx
+        self.rate = 1 + drift_ppm / 1e6
+        self.boot = rnd.uniform(0, 1e6)  # boards are not powered at the same moment
+        self.offset = 0
+        self.slave = 0
+        self.hops = 0
+        self.last_rx_ms = 0
+        self.last_tx_ms = 0
+        self.animation = rnd.randrange(NUM_ANIMATIONS)
+        self.seed = rnd.randrange(0x10000)
+        self.start = 0
+        self.master = None  # Animation, seed and start in the last frame
+        self.period = period_us
+        self.align = align
+        self.deadline = None  # Deadline of the next step, like heart_deadline_us
+        self.step = 0
+        self.catchup = False
+        self.rnd = rnd
+        self.filter_max = 0
+        self.filter_cnt = 0
+        self.buf = bytearray()
+
+    def micros(self):
+        return int(time.monotonic() * 1e6 * self.rate + self.boot) & 0xFFFFFFFF
+
+    def millis(self):
+        return self.micros() // 1000
+
+    def sync_micros(self):
+        return (self.micros() + self.offset) & 0xFFFFFFFF
+
+    def send(self, hops):
+        t = self.sync_micros()
+        animation, seed, start = self.master if self.slave else (self.animation, self.seed, self.start)
+        frame = (bytearray([SYNC_MAGIC, hops, animation]) + t.to_bytes(4, "little") + seed.to_bytes(2, "little") +
+                 start.to_bytes(4, "little"))
+        check = 0
+        for b in frame[1:]:
+            check ^= b
+        frame.append(check)
+        if self.tx is not None:
+            os.write(self.tx, frame)
+
+    def frame(self, f):
+        t = int.from_bytes(f[3:7], "little")
+        err = (t + SYNC_LINK_US - self.sync_micros()) & 0xFFFFFFFF
+        if err >= 0x80000000:
+            err -= 0x100000000
+        self.hops = f[1] + 1
+        if not self.slave or abs(err) > SYNC_STEP_US:
+            self.offset += err
+            self.filter_cnt = 0
+        else:
+            if self.filter_cnt == 0 or err > self.filter_max:
+                self.filter_max = err
+            self.filter_cnt += 1
+            if self.filter_cnt >= SYNC_FILTER_FRAMES:
+                self.offset += int(self.filter_max / 2)
+                self.filter_cnt = 0
+        self.slave = 1
+        self.last_rx_ms = self.millis()
+        self.master = (f[2], f[7] | f[8] << 8, int.from_bytes(f[9:13], "little"))
+        if self.master[:2] != (self.animation, self.seed):
+            self.start_animation()
+        self.send(self.hops)
+
+    def start_animation(self):
+        """heart_delay_start() and sync_animation_start(): a slave takes the run of the master and aligns to its start"""
+        now = self.sync_micros()
+        if self.slave:
+            self.animation, self.seed, start = self.master
+            self.start = start if self.align else now
+        else:
+            self.animation = self.rnd.randrange(NUM_ANIMATIONS)
+            self.seed = self.rnd.randrange(0x10000)
+            self.start = now
+            self.last_tx_ms = self.millis() - SYNC_INTERVAL_MS  # send right away
+        self.deadline = self.start
+        self.step = 0
+        self.catchup = self.slave and self.align
+
+    def animate(self):
+        """heart_delay_next(): run the step when its deadline passed; returns the step and whether it caught up"""
+        if self.deadline is None:
+            return None
+        late = ((self.sync_micros() - self.deadline) & 0xFFFFFFFF)
+        if late >= 0x80000000:
+            self.catchup = False
+            return None
+        step, catchup = self.step, self.catchup
+        self.step += 1
+        self.deadline = (self.deadline + self.period) & 0xFFFFFFFF
+        late = ((self.sync_micros() - self.deadline) & 0xFFFFFFFF)
+        if late < 0x80000000 and not self.catchup:
+            # Overrun: the next deadline starts from now
+            self.deadline = self.sync_micros()
+        return step, catchup
+
+    def service(self):
+        if self.rx is not None:
+            try:
+                self.buf += os.read(self.rx, 256)
+            except BlockingIOError:
+                pass
+            while len(self.buf) >= SYNC_FRAME_LEN:
+                if self.buf[0] != SYNC_MAGIC:
+                    del self.buf[0]
+                    continue
+                f = self.buf[:SYNC_FRAME_LEN]
+                check = 0
+                for b in f[1:-1]:
+                    check ^= b
+                if check == f[-1]:
+                    self.frame(f)
+                    del self.buf[:SYNC_FRAME_LEN]
+                else:
+                    del self.buf[0]
+        if self.slave and self.millis() - self.last_rx_ms >= SYNC_TIMEOUT_MS:
+            self.slave = 0
+            self.hops = 0
+        if not self.slave and self.millis() - self.last_tx_ms >= SYNC_INTERVAL_MS:
+            self.last_tx_ms = self.millis()
+            self.send(0)
+
+
+def run_heart(heart, report, secs, rnd, join, demo):
+    """Main loop of one heart: the animation keeps the loop busy for a random time between services"""
+    end = time.monotonic() + secs
+    time.sleep(join)
+    next_report = 0
+    next_demo = 0
+    while time.monotonic() < end:
+        heart.service()
+        now = time.monotonic()
+        if heart.deadline is None or (not heart.slave and now >= next_demo):
+            # The demo timer of the master starts the next run
+            next_demo = now + demo
+            heart.start_animation()
+        stepped = heart.animate()
+        if stepped is not None:
+            os.write(report, b"s %.7f %d %d %d\n" % (time.monotonic(), heart.seed, stepped[0], stepped[1]))
+        if now >= next_report:
+            next_report = now + 0.01
+            # Sample the sync time at the midpoint of two monotonic readings to report (real, sync) pairs
+            t0 = time.monotonic()
+            s = heart.sync_micros()
+            t1 = time.monotonic()
+            os.write(report, b"t %.7f %d %d %d\n" % ((t0 + t1) / 2, s, heart.slave, heart.hops))
+        select.select([heart.rx] if heart.rx is not None else [], [], [], rnd.uniform(0, 0.002))
+    os._exit(0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulate a daisy chain of synchronised hearts")
+    parser.add_argument("-n", type=int, default=4, help="number of hearts")
+    parser.add_argument("-t", type=float, default=20, help="duration in seconds")
+    parser.add_argument("--drift", type=float, default=500, help="maximum clock error in ppm")
+    parser.add_argument("--window", type=float, default=2, help="report window in seconds")
+    parser.add_argument("--period", type=float, default=20, help="animation step period in ms")
+    parser.add_argument("--demo", type=float, default=6, help="seconds between two runs started by the master")
+    parser.add_argument("--join", type=float, default=3, help="the slaves power up within this many seconds")
+    parser.add_argument("--no-align", action="store_true", help="start the steps when the frame arrives")
+    args = parser.parse_args()
+
+    rnd = random.Random(1)
+    # Pseudo terminal per link: heart i writes to the master side, heart i+1 reads the slave side
+    links = []
+    for _ in range(args.n - 1):
+        m, s = os.openpty()
+        tty.setraw(s)
+        os.set_blocking(s, False)
+        links.append((m, s))
+
+    reports = []
+    for i in range(args.n):
+        r, w = os.pipe()
+        rx = links[i - 1][1] if i > 0 else None
+        tx = links[i][0] if i < args.n - 1 else None
+        heart = Heart(rx, tx, rnd.uniform(-args.drift, args.drift), random.Random(rnd.random()),
+                      int(args.period * 1000), not args.no_align)
+        seed = rnd.random()
+        join = rnd.uniform(0, args.join) if i > 0 else 0
+        if os.fork() == 0:
+            os.close(r)
+            run_heart(heart, w, args.t, random.Random(seed), join, args.demo)
+        os.close(w)
+        reports.append(r)
+
+    # Collect the reports of all hearts
+    samples = [[] for _ in range(args.n)]
+    steps = [[] for _ in range(args.n)]
+    bufs = [b""] * args.n
+    open_fds = set(reports)
+    while open_fds:
+        for fd in select.select(list(open_fds), [], [])[0]:
+            data = os.read(fd, 65536)
+            i = reports.index(fd)
+            if not data:
+                open_fds.discard(fd)
+                continue
+            bufs[i] += data
+            lines = bufs[i].split(b"\n")
+            bufs[i] = lines.pop()
+            for line in lines:
+                kind, real, a, b, c = line.split()
+                if kind == b"t":
+                    samples[i].append((float(real), int(a), int(b), int(c)))
+                else:
+                    steps[i].append((float(real), int(a), int(b), int(c)))
+    while True:
+        try:
+            os.wait()
+        except ChildProcessError:
+            break
+
+    # Phase error against the master: interpolate the master sync time at the sample time
+    master = samples[0]
+    start = master[0][0]
+    master_steps = {(seed, step): real for real, seed, step, _ in steps[0]}
+    failed = False
+    for i in range(1, args.n):
+        windows = {}
+        hops = 0
+        j = 0
+        for real, sync, slave, h in samples[i]:
+            while j < len(master) - 2 and master[j + 1][0] < real:
+                j += 1
+            (r0, s0, _, _), (r1, s1, _, _) = master[j], master[j + 1]
+            ref = s0 + ((s1 - s0) & 0xFFFFFFFF) * (real - r0) / (r1 - r0)
+            err = ((sync - int(ref)) & 0xFFFFFFFF)
+            if err >= 0x80000000:
+                err -= 0x100000000
+            if not slave:
+                continue
+            hops = h
+            w = int((real - start) / args.window)
+            windows[w] = max(windows.get(w, 0), abs(err))
+        print("heart %d (hops %d): max |phase error| per %g s window (us): %s" %
+              (i, hops, args.window, " ".join(str(windows[w]) for w in sorted(windows))))
+
+        # Animation phase: the same step of the same run on the master, leaving out the steps of a slave catching up
+        windows = {}
+        matched = catchup = 0
+        for real, seed, step, caught in steps[i]:
+            ref = master_steps.get((seed, step))
+            if ref is None:
+                continue
+            if caught:
+                catchup += 1
+                continue
+            matched += 1
+            w = int((real - start) / args.window)
+            windows[w] = max(windows.get(w, 0), int(abs(real - ref) * 1e6))
+        print("heart %d (hops %d): max |step error| per %g s window (us): %s (%d steps, %d caught up)" %
+              (i, hops, args.window, " ".join(str(windows[w]) for w in sorted(windows)), matched, catchup))
+        if not matched:
+            failed = True
+    if failed:
+        sys.exit("a slave never stepped in phase with the master")
+
+
+if __name__ == "__main__":
+    main()
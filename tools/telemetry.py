@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+telemetry.py - Heart PCB Project - Host side decoder for the binary telemetry stream
+
+Reads the frames sent by the firmware when SUPPORT_TELEMETRY is defined (see heart_telemetry.h for the layout)
+from a serial port or a raw capture file, and prints, records (CSV) or plots them.
+
+Examples:
+  tools/telemetry.py /dev/ttyUSB0                      # print decoded frames
+  tools/telemetry.py /dev/ttyUSB0 --csv run.csv        # record to CSV
+  tools/telemetry.py /dev/ttyUSB0 --plot               # live plot of the LED brightness
+  tools/telemetry.py capture.bin --file --csv run.csv  # decode a raw capture
+
+@author  Berend Dekens <berend@cyberwizzard.nl>
+@license GNUGPLv3
+"""
+import argparse
+import csv
+import sys
+import time
+
+NUM_LEDS = 10
+SYNC = b"\xA5\x5A"
+FRAME_LEN = 2 + 2 + NUM_LEDS + 2 + 1 + 1 + 2 + 1
+
+
+class Decoder:
+    """Incremental frame decoder; resynchronises on the sync bytes and validates the checksum"""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.last_counter = None
+        self.frames = 0
+        self.lost = 0
+        self.bad = 0
+
+    def feed(self, data):
+        self.buf += data
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                # Keep the last byte, it might be the first sync byte
+                del self.buf[:-1]
+                return
+            if len(self.buf) - start < FRAME_LEN:
+                del self.buf[:start]
+                return
+            frame = self.buf[start:start + FRAME_LEN]
+            check = 0
+            for b in frame[2:-1]:
+                check ^= b
+            if check != frame[-1]:
+                # Not a frame (or corrupted), skip this sync and search again
+                self.bad += 1
+                del self.buf[:start + 1]
+                continue
+            del self.buf[:start + FRAME_LEN]
+            yield self.decode(frame)
+
+    def decode(self, frame):
+        counter = frame[2] | frame[3] << 8
+        if self.last_counter is not None:
+            self.lost += (counter - self.last_counter - 1) & 0xFFFF
+        self.last_counter = counter
+        self.frames += 1
+        p = 4 + NUM_LEDS
+        return {
+            "time": time.time(),
+            "counter": counter,
+            "brightness": list(frame[4:p]),
+            "active": frame[p] | frame[p + 1] << 8,
+            "animation": frame[p + 2],
+            "error": frame[p + 3],
+            "missed": frame[p + 4] | frame[p + 5] << 8,
+        }
+
+
+def open_source(args):
+    if args.file:
+        return open(args.port, "rb")
+    import serial  # pyserial
+    return serial.Serial(args.port, args.baud, timeout=0.05)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Decode the Heart PCB telemetry stream")
+    ap.add_argument("port", help="serial port (or capture file with --file)")
+    ap.add_argument("--baud", type=int, default=500000, help="baud rate, must match SERIAL_BAUD (default: 500000)")
+    ap.add_argument("--file", action="store_true", help="read a raw capture file instead of a serial port")
+    ap.add_argument("--csv", help="record decoded frames to this CSV file")
+    ap.add_argument("--plot", action="store_true", help="live plot of the LED brightness (needs matplotlib)")
+    ap.add_argument("--quiet", action="store_true", help="do not print the frames")
+    args = ap.parse_args()
+
+    src = open_source(args)
+    dec = Decoder()
+    writer = None
+    if args.csv:
+        out = open(args.csv, "w", newline="")
+        writer = csv.writer(out)
+        writer.writerow(["time", "counter"] + ["led%d" % l for l in range(NUM_LEDS)] + ["active", "animation", "error", "missed"])
+
+    plot = None
+    if args.plot:
+        import matplotlib.pyplot as plt
+        from collections import deque
+        history = [deque(maxlen=500) for _ in range(NUM_LEDS)]
+        plt.ion()
+        fig, ax = plt.subplots()
+        lines = [ax.plot([], [], label="LED %d" % l)[0] for l in range(NUM_LEDS)]
+        ax.set_ylim(0, 256)
+        ax.set_xlim(0, 500)
+        ax.legend(loc="upper right", fontsize="small", ncol=2)
+        plot = (plt, history, lines)
+
+    try:
+        while True:
+            data = src.read(256)
+            if not data:
+                if args.file:
+                    break
+                continue
+            for f in dec.feed(data):
+                if writer:
+                    writer.writerow([f"{f['time']:.4f}", f["counter"]] + f["brightness"] + [f["active"], f["animation"], f["error"], f["missed"]])
+                if not args.quiet:
+                    print("%5d ani=%d err=%d missed=%d active=%03x %s" % (f["counter"], f["animation"], f["error"],
+                                                                          f["missed"], f["active"],
+                                                                          " ".join("%3d" % b for b in f["brightness"])))
+                if plot:
+                    for l in range(NUM_LEDS):
+                        plot[1][l].append(f["brightness"][l])
+            if plot:
+                for l, line in enumerate(plot[2]):
+                    line.set_data(range(len(plot[1][l])), plot[1][l])
+                plot[0].pause(0.001)
+    except KeyboardInterrupt:
+        pass
+
+    print("frames: %d, lost: %d, bad: %d" % (dec.frames, dec.lost, dec.bad), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""
+trace_chrome.py - Heart PCB Project - Convert the event trace of the firmware to a Chrome trace
+
+Reads the output of the 't' command (SUPPORT_TRACE and SUPPORT_COMMANDS, see heart_trace.h) from a capture file or by
+polling a board on a serial port, rebuilds the full time line from the 16 bit tick stamps and writes a JSON file for
+chrome://tracing or ui.perfetto.dev: the steps of the animations and the waits in between as slices on the main loop,
+the background EEPROM writes as slices, and the faders, buttons, overruns and marks as instant events.
+
+The ring has to be read before it fills up (TRACE_RECORDS records); the firmware counts the records it had to drop and
+the time line is only complete when none were. The ticks include those skipped by the long ticks of the PWM tail and
+are converted with the timer interval: the one printed with the first dump, then each TRACE_INTERVAL record of the
+PWM governor.
+
+Examples:
+  tools/trace_chrome.py /dev/ttyUSB0 -o heart.json                # poll for 10 seconds
+  tools/trace_chrome.py /dev/ttyUSB0 --duration 60 --interval 0.2 # poll faster for a busy trace
+  tools/trace_chrome.py capture.txt --file -o heart.json          # convert a capture of 't' dumps
+
+@author  Berend Dekens <berend@cyberwizzard.nl>
+@license GNUGPLv3
+"""
+import argparse
+import json
+import sys
+import time
+
+# Events of heart_trace.h
+TRACE_WRAP = 1
+TRACE_ANIMATION = 2
+TRACE_WAIT = 3
+TRACE_RESUME = 4
+TRACE_OVERRUN = 5
+TRACE_FADER_START = 6
+TRACE_FADER_BOUND = 7
+TRACE_EEPROM_START = 8
+TRACE_EEPROM_BYTE = 9
+TRACE_EEPROM_DONE = 10
+TRACE_BUTTON = 11
+TRACE_EVENT = 12
+TRACE_MARK = 13
+TRACE_INTERVAL = 14
+
+# Event types of heart_event.h
+EVENT_NAMES = {0: "press", 1: "release", 2: "demo"}
+# Reload effects of effect_enum_t in heart_settings.h
+EFFECT_NAMES = ["NONE", "UPPER_INVERT", "LOWER_INVERT", "JUMP", "INVERT", "SETUP_LOWER"]
+
+# Threads in the Chrome trace
+TID_MAIN = 1
+TID_FADERS = 2
+TID_EEPROM = 3
+TID_BUTTONS = 4
+TID_MARKS = 5
+THREADS = {TID_MAIN: "main loop", TID_FADERS: "faders", TID_EEPROM: "eeprom", TID_BUTTONS: "buttons",
+           TID_MARKS: "marks"}
+
+
+class Converter:
+    """Collects the dumps line by line and turns the records into Chrome trace events"""
+
+    def __init__(self):
+        self.pending = []       # Records of the dump being read
+        self.tick_us = None     # Timer interval at the previous record
+        self.last_ticks = None  # Tick stamp of the previous record
+        self.time_us = 0.0      # Time of the previous record
+        self.animation = None
+        self.open = None        # Name of the open slice on the main loop
+        self.eeprom = False     # A slice is open on the eeprom thread
+        self.events = [{"name": "thread_name", "ph": "M", "pid": 1, "tid": t, "args": {"name": n}}
+                       for t, n in THREADS.items()]
+        self.dumps = 0
+        self.count = 0
+        self.lost = 0
+
+    def line(self, text):
+        parts = text.split()
+        if len(parts) == 3 and parts[0] == "trace":
+            self.dump(float(parts[1]), int(parts[2]))
+        elif len(parts) == 3 and all(p.isdigit() for p in parts):
+            self.pending.append(tuple(int(p) for p in parts))
+
+    def dump(self, tick_us, lost):
+        self.dumps += 1
+        self.lost += lost
+        if self.tick_us is None:
+            self.tick_us = tick_us
+        for ticks, ident, arg in self.pending:
+            if self.last_ticks is not None:
+                # The ticks only go forward; a wrap always leaves a TRACE_WRAP record, so the gap is below 65536 ticks
+                self.time_us += ((ticks - self.last_ticks) & 0xFFFF) * self.tick_us
+            self.last_ticks = ticks
+            if ident == TRACE_INTERVAL:
+                self.tick_us = arg
+            self.record(ident, arg)
+        self.count += len(self.pending)
+        self.pending = []
+
+    def emit(self, ph, name, tid, args=None):
+        ev = {"name": name, "ph": ph, "pid": 1, "tid": tid, "ts": round(self.time_us, 1)}
+        if ph == "i":
+            ev["s"] = "t"
+        if args:
+            ev["args"] = args
+        self.events.append(ev)
+
+    def slice(self, name, args=None):
+        """End the open slice on the main loop and start the next one; None only ends it"""
+        if self.open is not None:
+            self.emit("E", self.open, TID_MAIN)
+        self.open = name
+        if name is not None:
+            self.emit("B", name, TID_MAIN, args)
+
+    def step_name(self):
+        return "step" if self.animation is None else "animation %d" % self.animation
+
+    def record(self, ident, arg):
+        if ident == TRACE_ANIMATION:
+            self.animation = arg
+            self.slice(self.step_name())
+        elif ident == TRACE_WAIT:
+            self.slice("wait", {"ms": arg})
+        elif ident == TRACE_RESUME:
+            self.slice(self.step_name(), {"aborted": arg} if arg else None)
+        elif ident == TRACE_OVERRUN:
+            self.emit("i", "overrun", TID_MAIN, {"us": arg})
+        elif ident == TRACE_FADER_START:
+            self.emit("i", "start", TID_FADERS, {"mask": "0x%04X" % arg})
+        elif ident == TRACE_FADER_BOUND:
+            effect = (arg >> 8) & 0x7F
+            self.emit("i", "led %d %s" % (arg & 0xFF, "upper" if arg & 0x8000 else "lower"), TID_FADERS,
+                      {"effect": EFFECT_NAMES[effect] if effect < len(EFFECT_NAMES) else effect})
+        elif ident == TRACE_EEPROM_START:
+            if self.eeprom:
+                self.emit("E", "write", TID_EEPROM)
+            self.eeprom = True
+            self.emit("B", "write", TID_EEPROM, {"addr": arg})
+        elif ident == TRACE_EEPROM_BYTE:
+            self.emit("i", "byte", TID_EEPROM, {"addr": arg})
+        elif ident == TRACE_EEPROM_DONE:
+            if self.eeprom:
+                self.emit("E", "write", TID_EEPROM)
+            self.eeprom = False
+        elif ident in (TRACE_BUTTON, TRACE_EVENT):
+            kind = EVENT_NAMES.get(arg >> 8, arg >> 8)
+            self.emit("i", "%s %s" % ("isr" if ident == TRACE_BUTTON else "handle", kind), TID_BUTTONS,
+                      {"button": arg & 0xFF})
+        elif ident == TRACE_MARK:
+            self.emit("i", "mark", TID_MARKS, {"arg": arg})
+        elif ident == TRACE_INTERVAL:
+            self.emit("i", "interval", TID_MAIN, {"us": arg})
+
+    def finish(self):
+        self.slice(None)
+        if self.eeprom:
+            self.emit("E", "write", TID_EEPROM)
+        return {"traceEvents": self.events, "displayTimeUnit": "ms"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Convert the Heart PCB event trace to a Chrome trace")
+    ap.add_argument("port", help="serial port (or capture file with --file)")
+    ap.add_argument("--baud", type=int, default=500000, help="baud rate, must match SERIAL_BAUD (default: 500000)")
+    ap.add_argument("--file", action="store_true", help="read a capture of 't' dumps instead of a serial port")
+    ap.add_argument("--duration", type=float, default=10.0, help="seconds to poll the board (default: 10)")
+    ap.add_argument("--interval", type=float, default=0.5, help="seconds between two dumps (default: 0.5)")
+    ap.add_argument("-o", default="heart_trace.json", help="output file (default: heart_trace.json)")
+    args = ap.parse_args()
+
+    conv = Converter()
+    if args.file:
+        with open(args.port) as f:
+            for text in f:
+                conv.line(text)
+    else:
+        import serial  # pyserial
+        port = serial.Serial(args.port, args.baud, timeout=0.05)
+        buf = b""
+        end = time.time() + args.duration
+        poll = 0.0
+        try:
+            while time.time() < end:
+                if time.time() >= poll:
+                    port.write(b"t\n")
+                    poll = time.time() + args.interval
+                buf += port.read(256)
+                while b"\n" in buf:
+                    text, buf = buf.split(b"\n", 1)
+                    conv.line(text.decode("ascii", "replace"))
+        except KeyboardInterrupt:
+            pass
+
+    with open(args.o, "w") as f:
+        json.dump(conv.finish(), f)
+    print("%d dumps, %d records, %.3f s written to %s" % (conv.dumps, conv.count, conv.time_us / 1e6, args.o))
+    if conv.lost:
+        print("%d records dropped by a full ring, the time line has gaps; poll faster or raise TRACE_RECORDS" % conv.lost)
+    if not conv.dumps:
+        sys.exit("no 't' dumps found")
+
+
+if __name__ == "__main__":
+    main()